@@ -0,0 +1,154 @@
+#!/usr/bin/env python
+"""\
+Stream g-code to Smoothie using the framed protocol
+
+Each line is sent as a frame with a sequence number and a CRC, Smoothie acks each
+frame when it has been processed and says how many frames may be outstanding, so
+lines are sent ahead without waiting for an ok and corrupted lines are resent.
+"""
+
+from __future__ import print_function
+import sys
+import argparse
+import serial
+import threading
+import time
+import signal
+
+errorflg= False
+intrflg= False
+
+def signal_term_handler(signal, frame):
+   global intrflg
+   print('got SIGTERM...')
+   intrflg= True
+
+signal.signal(signal.SIGTERM, signal_term_handler)
+
+# Define command line argument interface
+parser = argparse.ArgumentParser(description='Stream g-code file to Smoothie using framed lines.')
+parser.add_argument('gcode_file', type=argparse.FileType('r'),
+        help='g-code filename to be streamed')
+parser.add_argument('device',
+        help='Smoothie Serial Device')
+parser.add_argument('-b','--baud',type=int, default=115200,
+        help='baud rate')
+parser.add_argument('-q','--quiet',action='store_true', default=False,
+        help='suppress output text')
+args = parser.parse_args()
+
+f = args.gcode_file
+verbose = not args.quiet
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE as used by Smoothie"""
+    crc= 0xFFFF
+    for c in bytearray(data):
+        crc ^= c << 8
+        for i in range(8):
+            crc= ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+def frame(seq, line):
+    body= '{:02X}{}'.format(seq & 0xFF, line).encode('ascii', 'ignore')
+    return b'\x02' + body + b'\x03' + '{:04X}\n'.format(crc16(body)).encode('ascii')
+
+# read in the lines to send, comments and blank lines are not sent
+lines= []
+for line in f:
+    l= line.split(';', 1)[0].strip()
+    if l:
+        lines.append(l)
+f.close()
+
+# Open port
+s = serial.Serial(args.device, args.baud)
+s.flushInput()  # Flush startup text in serial input
+
+print("Streaming " + args.gcode_file.name + " to " + args.device)
+
+lock= threading.Condition()
+acked= 0      # number of lines acked
+sent= 0       # number of lines sent
+credits= 1    # frames we may have outstanding
+synced= False
+
+def read_thread():
+    """thread worker function"""
+    global acked, sent, credits, synced, errorflg
+    while True :
+        rep= s.readline().decode('ascii', 'ignore').strip()
+        if rep.startswith('ack ') :
+            p= rep.split()
+            seq= int(p[1], 16)
+            with lock:
+                if not synced :
+                    synced= True
+                else :
+                    # the sequence number wraps, work out how many new lines it acks
+                    n= (seq - acked + 1) & 0xFF
+                    if n <= sent - acked :
+                        acked += n
+                if len(p) > 2 :
+                    credits= int(p[2])
+                lock.notify()
+
+        elif rep.startswith('nak ') :
+            seq= int(rep.split()[1], 16)
+            with lock:
+                # go back and resend everything from the one it expected next
+                if synced and ((seq - acked) & 0xFF) == 0 :
+                    sent= acked
+                lock.notify()
+            if verbose: print("Resending from " + str(acked))
+
+        elif rep :
+            print("Incoming: " + rep)
+            if "error" in rep or "!!" in rep or "ALARM" in rep or "ERROR" in rep:
+                with lock:
+                    errorflg= True
+                    lock.notify()
+                break
+
+    print("Read thread exited")
+    return
+
+# start read thread
+t = threading.Thread(target=read_thread)
+t.daemon = True
+t.start()
+
+start= time.time()
+try:
+    # start a session, resync until acked
+    while not synced and not errorflg :
+        s.write(frame(0, ''))
+        with lock:
+            lock.wait(1)
+
+    while acked < len(lines) and not errorflg and not intrflg :
+        with lock:
+            while sent < len(lines) and sent - acked < credits :
+                s.write(frame(sent, lines[sent]))
+                sent += 1
+                if verbose: print("SND " + str(sent) + ": " + lines[sent-1] + " - " + str(acked))
+            lock.wait(1)
+
+except KeyboardInterrupt:
+    print("Interrupted...")
+    intrflg= True
+
+if intrflg :
+    print("Sending Abort...")
+    s.write(b'\x18') # send halt
+
+elif errorflg :
+    print("Target halted due to errors")
+
+else :
+    el= time.time() - start
+    print("Sent {} lines in {:.1f} seconds, {:.1f} lines/sec".format(len(lines), el, len(lines) / max(el, 0.001)))
+
+# Close serial port
+s.close()
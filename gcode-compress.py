@@ -0,0 +1,61 @@
+#!/usr/bin/env python
+"""\
+Compress a g-code file for playing from the Smoothie SD card
+
+The output is a raw deflate stream with a small window so it can be decoded
+on the fly by the player, use the .gcz extension and play it as any other file.
+"""
+
+from __future__ import print_function
+import sys
+import argparse
+import re
+import zlib
+
+# Define command line argument interface
+parser = argparse.ArgumentParser(description='Compress g-code file to play on Smoothie.')
+parser.add_argument('gcode_file', type=argparse.FileType('r'),
+        help='g-code filename to be compressed')
+parser.add_argument('output_file', nargs='?',
+        help='compressed filename, defaults to the g-code filename with a .gcz extension')
+parser.add_argument('-w','--window',type=int, default=10, choices=range(9, 13),
+        help='deflate window bits, must be no more than 12 which is all Smoothie allows')
+parser.add_argument('-s','--strip',action='store_true', default=False,
+        help='strip comments and blank lines before compressing')
+parser.add_argument('-q','--quiet',action='store_true', default=False,
+        help='suppress output text')
+args = parser.parse_args()
+
+f = args.gcode_file
+verbose = not args.quiet
+
+outname = args.output_file
+if outname is None:
+    outname = re.sub(r'\.[^./\\]*$', '', f.name) + '.gcz'
+
+comment = re.compile(r'\s*(;.*|\(.*?\))')
+
+# zlib with negative window bits writes a raw deflate stream with no zlib header or checksum
+compressor = zlib.compressobj(9, zlib.DEFLATED, -args.window)
+
+insize = 0
+outsize = 0
+with open(outname, 'wb') as out:
+    out.write(b'GCZ' + bytearray([args.window]))
+    for line in f:
+        insize += len(line)
+        if args.strip:
+            line = comment.sub('', line).strip()
+            if not line:
+                continue
+            line += '\n'
+        data = compressor.compress(line.encode('ascii', 'ignore'))
+        outsize += len(data)
+        out.write(data)
+
+    data = compressor.flush()
+    outsize += len(data) + 4
+    out.write(data)
+
+if verbose:
+    print("Compressed {} to {}: {} bytes to {} bytes ({:.1f}%)".format(f.name, outname, insize, outsize, outsize * 100.0 / max(insize, 1)))
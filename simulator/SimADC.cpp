@@ -0,0 +1,47 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// model of the mbed ADC driver in libs/ADC so libs/Adc.cpp can be built for the host tests,
+// there is no converter so nothing is sampled and the burst and interrupt settings are ignored
+
+#include "libs/ADC/adc.h"
+
+using namespace mbed;
+
+ADC *ADC::instance = nullptr;
+
+ADC::ADC(int sample_rate, int cclk_div)
+{
+    instance = this;
+    _adc_g_isr = nullptr;
+    _adc_m_isr = nullptr;
+    for (int i = 0; i < 8; ++i) {
+        _adc_data[i] = 0;
+        _adc_isr[i] = nullptr;
+    }
+}
+
+void ADC::setup(PinName pin, int state) {}
+void ADC::burst(int state) {}
+void ADC::interrupt_state(PinName pin, int state) {}
+
+void ADC::append(void(*fptr)(int chan, uint32_t value))
+{
+    _adc_g_isr = fptr;
+}
+
+int ADC::_pin_to_channel(PinName pin)
+{
+    switch (pin) {
+        case p16: return 1;
+        case p17: return 2;
+        case p18: return 3;
+        case p19: return 4;
+        case p20: return 5;
+        default: return 0;
+    }
+}
@@ -0,0 +1,150 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SimHardware.h"
+
+#include "LPC17xx.h"
+#include "us_ticker_api.h"
+#include "wait_api.h"
+#include "libs/Kernel.h"
+#include "libs/StepTicker.h"
+#include "libs/StepperMotor.h"
+#include "modules/robot/Robot.h"
+#include "StreamOutput.h"
+#include "SimpleShell.h"
+
+#include <stdlib.h>
+#include <string>
+
+// the register model the firmware writes to, see include/LPC17xx.h
+LPC_GPIO_TypeDef sim_gpio[5];
+LPC_PINCON_TypeDef sim_pincon;
+LPC_TIM_TypeDef sim_tim[4];
+LPC_SC_TypeDef sim_sc;
+LPC_WDT_TypeDef sim_wdt;
+
+uint32_t SystemCoreClock = 100000000;
+
+extern "C" void TIMER0_IRQHandler(void);
+extern "C" void TIMER1_IRQHandler(void);
+
+ConfigSource *sim_config_source = nullptr;
+SimStdoutStream sim_stdout;
+
+SimStepTimer *SimStepTimer::instance = nullptr;
+
+SimStepTimer::SimStepTimer(uint32_t idle_ticks, FILE *trace)
+{
+    instance = this;
+    this->ticks = 0;
+    this->step_count = 0;
+    this->idle_ticks = idle_ticks;
+    this->trace = trace;
+}
+
+void SimStepTimer::on_module_loaded()
+{
+    this->register_for_event(ON_IDLE);
+
+    for(auto a : THEROBOT->actuators) {
+        last_position.push_back(a->get_current_step());
+    }
+
+    if(trace != nullptr) {
+        fprintf(trace, "tick,step_mask,dir_mask");
+        for (size_t i = 0; i < last_position.size(); ++i) fprintf(trace, ",pos%d", (int)i);
+        fprintf(trace, "\n");
+    }
+}
+
+void SimStepTimer::on_idle(void*)
+{
+    run(idle_ticks);
+}
+
+uint64_t SimStepTimer::get_microseconds() const
+{
+    return (ticks * 1000000ULL) / THEKERNEL->base_stepping_frequency;
+}
+
+void SimStepTimer::run(uint32_t n)
+{
+    for (uint32_t i = 0; i < n; ++i) {
+        LPC_TIM0->IR.match(1 << 0);
+        TIMER0_IRQHandler();
+
+        // the unstep timer was started so it fires well before the next step tick
+        if(LPC_TIM1->TCR == 1) {
+            LPC_TIM1->TCR = 0;
+            TIMER1_IRQHandler();
+        }
+
+        ++ticks;
+        trace_tick();
+    }
+}
+
+void SimStepTimer::trace_tick()
+{
+    uint32_t step_mask = 0, dir_mask = 0;
+    for (size_t i = 0; i < last_position.size(); ++i) {
+        StepperMotor *a = THEROBOT->actuators[i];
+        int32_t pos = a->get_current_step();
+        if(pos != last_position[i]) {
+            step_mask |= (1 << i);
+            last_position[i] = pos;
+            ++step_count;
+        }
+        if(a->which_direction()) dir_mask |= (1 << i);
+    }
+
+    if(trace == nullptr || step_mask == 0) return;
+
+    fprintf(trace, "%llu,%lu,%lu", (unsigned long long)ticks, (unsigned long)step_mask, (unsigned long)dir_mask);
+    for (auto p : last_position) fprintf(trace, ",%ld", (long)p);
+    fprintf(trace, "\n");
+}
+
+// time as seen by the firmware is the simulated step timer time
+extern "C" uint32_t us_ticker_read(void)
+{
+    if(SimStepTimer::getInstance() == nullptr) return 0;
+    return (uint32_t)SimStepTimer::getInstance()->get_microseconds();
+}
+
+// the step timer keeps running while the firmware busy waits
+extern "C" void wait_us(int us)
+{
+    if(SimStepTimer::getInstance() == nullptr || us <= 0) return;
+    uint64_t n = ((uint64_t)us * THEKERNEL->base_stepping_frequency) / 1000000ULL;
+    SimStepTimer::getInstance()->run(n > 0 ? n : 1);
+}
+
+extern "C" void wait_ms(int ms)
+{
+    wait_us(ms * 1000);
+}
+
+extern "C" void wait(float s)
+{
+    wait_us(s * 1000000.0F);
+}
+
+extern "C" void NVIC_SystemReset(void)
+{
+    exit(1);
+}
+
+extern "C" void set_high_on_debug(int port, int pin) {}
+extern "C" void set_low_on_debug(int port, int pin) {}
+
+// there is no console in the simulator so only gcodes are handled
+bool SimpleShell::parse_command(const char *cmd, std::string args, StreamOutput *stream)
+{
+    stream->printf("error:Unsupported command - %s\n", cmd);
+    return true;
+}
@@ -0,0 +1,61 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SIMHARDWARE_H
+#define SIMHARDWARE_H
+
+#include "Module.h"
+#include "StreamOutput.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+class ConfigSource;
+
+// set by main before the Kernel is created
+extern ConfigSource *sim_config_source;
+
+// the console, everything the firmware would send to the serial port ends up on stdout
+class SimStdoutStream : public StreamOutput {
+    public:
+        int puts(const char *s) { fputs(s, stdout); return strlen(s); }
+};
+extern SimStdoutStream sim_stdout;
+
+// Drives the StepTicker interrupts from the idle loop.
+// Each ON_IDLE advances the simulated clock by idle_ticks step ticks, which is roughly how long
+// the main loop takes to come around on the real board, and optionally writes a step/dir trace.
+class SimStepTimer : public Module {
+    public:
+        SimStepTimer(uint32_t idle_ticks, FILE *trace);
+
+        void on_module_loaded();
+        void on_idle(void*);
+
+        // run the step and unstep interrupts for n ticks
+        void run(uint32_t n);
+
+        static SimStepTimer *getInstance() { return instance; }
+        uint64_t get_ticks() const { return ticks; }
+        uint64_t get_microseconds() const;
+        uint64_t get_step_count() const { return step_count; }
+
+    private:
+        static SimStepTimer *instance;
+
+        void trace_tick();
+
+        std::vector<int32_t> last_position;
+        uint64_t ticks;
+        uint64_t step_count;
+        uint32_t idle_ticks;
+        FILE *trace;
+};
+
+#endif
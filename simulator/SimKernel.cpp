@@ -0,0 +1,180 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+This replaces libs/Kernel.cpp for the host simulator, it only creates the motion core and has no serial, usb, sdcard or slow ticker
+*/
+
+#include "libs/Kernel.h"
+#include "libs/Module.h"
+#include "libs/Config.h"
+#include "libs/StreamOutputPool.h"
+#include "checksumm.h"
+#include "ConfigValue.h"
+
+#include "libs/StepTicker.h"
+#include "modules/communication/GcodeDispatch.h"
+#include "modules/robot/Planner.h"
+#include "modules/robot/Robot.h"
+#include "modules/robot/Conveyor.h"
+
+#include "SimHardware.h"
+#include "EventProfiler.h"
+
+#include <array>
+#include <string>
+
+#define base_stepping_frequency_checksum            CHECKSUM("base_stepping_frequency")
+#define microseconds_per_step_pulse_checksum        CHECKSUM("microseconds_per_step_pulse")
+#define grbl_mode_checksum                          CHECKSUM("grbl_mode")
+#define ok_per_line_checksum                        CHECKSUM("ok_per_line")
+
+Kernel* Kernel::instance;
+
+Kernel::Kernel()
+{
+    halted = false;
+    feed_hold = false;
+    enable_feed_hold = false;
+    bad_mcu = false;
+    uploading = false;
+    laser_mode = false;
+    use_leds = false;
+
+    instance = this; // setup the Singleton instance of the kernel
+
+    this->serial = nullptr;
+    this->slow_ticker = nullptr;
+    this->adc = nullptr;
+    this->event_profiler = nullptr;
+    this->simpleshell = nullptr;
+    this->configurator = nullptr;
+
+    // the config is read from the file given on the command line, see main.cpp
+    this->config = new Config(sim_config_source);
+    this->config->config_cache_load();
+
+    this->streams = new StreamOutputPool();
+    this->streams->append_stream(&sim_stdout);
+    this->current_path = "/";
+
+#ifdef CNC
+    this->grbl_mode = this->config->value( grbl_mode_checksum )->by_default(true)->as_bool();
+#else
+    this->grbl_mode = this->config->value( grbl_mode_checksum )->by_default(false)->as_bool();
+#endif
+    this->ok_per_line = this->config->value( ok_per_line_checksum )->by_default(true)->as_bool();
+
+    this->step_ticker = new StepTicker();
+
+    // Configure the step ticker
+    this->base_stepping_frequency = this->config->value(base_stepping_frequency_checksum)->by_default(100000)->as_number();
+    float microseconds_per_step_pulse = this->config->value(microseconds_per_step_pulse_checksum)->by_default(1)->as_number();
+
+    this->step_ticker->set_frequency( this->base_stepping_frequency );
+    this->step_ticker->set_unstep_time( microseconds_per_step_pulse );
+
+    // Core modules
+    this->add_module( this->conveyor       = new Conveyor(),      "Conveyor" );
+    this->add_module( this->gcode_dispatch = new GcodeDispatch(), "GcodeDispatch" );
+    this->add_module( this->robot          = new Robot(),         "Robot" );
+
+    this->planner = new Planner();
+}
+
+// the simulator has no endstops, spindle or temperature controls so this only reports state and position
+std::string Kernel::get_query_string()
+{
+    std::string str;
+    str.append("<");
+    if(halted) {
+        str.append("Alarm");
+    } else if(feed_hold) {
+        str.append("Hold");
+    } else if(this->conveyor->is_idle()) {
+        str.append("Idle");
+    } else {
+        str.append("Run");
+    }
+
+    char buf[64];
+    Robot::wcs_t mpos = robot->get_axis_position();
+    size_t n = snprintf(buf, sizeof(buf), "|MPos:%1.4f,%1.4f,%1.4f", std::get<X_AXIS>(mpos), std::get<Y_AXIS>(mpos), std::get<Z_AXIS>(mpos));
+    if(n > sizeof(buf)) n = sizeof(buf);
+    str.append(buf, n);
+
+    str.append(">\n");
+    return str;
+}
+
+// Add a module to Kernel. We don't actually hold a list of modules we just call its on_module_loaded
+void Kernel::add_module(Module* module, const char *name)
+{
+    module->set_module_name(name);
+    module->on_module_loaded();
+}
+
+// Adds a hook for a given module and event
+void Kernel::register_for_event(_EVENT_ENUM id_event, Module *mod)
+{
+    this->hooks[id_event].push_back(mod);
+}
+
+// Call a specific event with an argument
+void Kernel::call_event(_EVENT_ENUM id_event, void * argument)
+{
+    bool was_idle = true;
+    if(id_event == ON_HALT) {
+        this->halted = (argument == nullptr);
+        if(!this->halted && this->feed_hold) this->feed_hold = false; // also clear feed hold
+        was_idle = conveyor->is_idle();
+    }
+
+    // send to all registered modules
+    if(this->event_profiler == nullptr) {
+        for (auto m : hooks[id_event]) {
+            (m->*kernel_callback_functions[id_event])(argument);
+        }
+
+    } else {
+        std::vector<Module*>& v = hooks[id_event];
+        for (size_t i = 0; i < v.size(); ++i) {
+            uint32_t start = EventProfiler::now();
+            (v[i]->*kernel_callback_functions[id_event])(argument);
+            this->event_profiler->record(id_event, i, EventProfiler::now() - start);
+        }
+    }
+
+    if(id_event == ON_HALT) {
+        if(!this->halted || !was_idle) {
+            this->robot->reset_position_from_current_actuator_position();
+        }
+    }
+}
+
+bool Kernel::kernel_has_event(_EVENT_ENUM id_event, Module *mod)
+{
+    for (auto m : hooks[id_event]) {
+        if(m == mod) return true;
+    }
+    return false;
+}
+
+void Kernel::unregister_for_event(_EVENT_ENUM id_event, Module *mod)
+{
+    for (auto i = hooks[id_event].begin(); i != hooks[id_event].end(); ++i) {
+        if(*i == mod) {
+            hooks[id_event].erase(i);
+            return;
+        }
+    }
+}
+
+void Kernel::event_profile_report(StreamOutput *stream)
+{
+    if(this->event_profiler != nullptr) this->event_profiler->report(stream, hooks);
+}
@@ -0,0 +1,276 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SimSDCard.h"
+
+#include "mbed.h"
+#include "gpio.h"
+
+#include <string.h>
+
+#define R1_IDLE_STATE       0x01
+#define R1_ILLEGAL_COMMAND  0x04
+#define R1_ADDRESS_ERROR    0x20
+#define R1_PARAMETER_ERROR  0x40
+
+SimSDCard *SimSDCard::attached = nullptr;
+
+SimSDCard::SimSDCard(uint32_t blocks) : data(blocks * 512, 0)
+{
+    bytes_clocked = 0;
+    protocol_errors = 0;
+    fail_write_block = -1;
+    fail_read_block = -1;
+    cmdlen = 0;
+    state = IDLE;
+    multiple = false;
+    selected = false;
+    app_cmd = false;
+    init_count = 0;
+    address = 0;
+    rxlen = 0;
+    read_error = false;
+}
+
+int SimSDCard::exchange(int mosi)
+{
+    if(!selected) return 0xFF;
+
+    ++bytes_clocked;
+    uint8_t in = mosi;
+
+    // a multiple block read keeps sending blocks until CMD12
+    if(out.empty() && state == READING && !read_error) queue_block();
+
+    int miso = 0xFF;
+    if(!out.empty()) {
+        miso = out.front();
+        out.pop_front();
+    }
+
+    switch(state) {
+        case RECEIVING:
+            rxbuf[rxlen++] = in;
+            if(rxlen == sizeof(rxbuf)) {
+                // data response token, accepted or write error, then busy while it is programmed
+                bool ok = address < get_blocks() && (int32_t)address != fail_write_block;
+                if(ok) {
+                    memcpy(block(address), rxbuf, 512);
+                } else {
+                    fail_write_block = -1;
+                }
+                out.push_back(ok ? 0xE5 : 0xED);
+                busy(3);
+                ++address;
+                state = multiple ? WRITING : IDLE;
+            }
+            return miso;
+
+        case WRITING:
+            if(in == 0xFF) return miso;
+            if(miso == 0x00) ++protocol_errors; // the host must wait for the card to stop being busy
+            if(in == (multiple ? 0xFC : 0xFE)) {
+                rxlen = 0;
+                state = RECEIVING;
+            } else if(multiple && in == 0xFD) {
+                // stop tran token, a stuff byte then busy
+                out.push_back(0xFF);
+                busy(4);
+                state = IDLE;
+            } else {
+                ++protocol_errors;
+            }
+            return miso;
+
+        default:
+            break;
+    }
+
+    // commands are 01xxxxxx followed by the argument and crc
+    if(cmdlen == 0 && (in & 0xC0) != 0x40) return miso;
+    cmdbuf[cmdlen++] = in;
+    if(cmdlen == sizeof(cmdbuf)) {
+        cmdlen = 0;
+        command(cmdbuf[0] & 0x3F, (cmdbuf[1] << 24) | (cmdbuf[2] << 16) | (cmdbuf[3] << 8) | cmdbuf[4]);
+    }
+
+    return miso;
+}
+
+void SimSDCard::command(uint8_t cmd, uint32_t arg)
+{
+    uint8_t idle = (init_count > 0) ? R1_IDLE_STATE : 0;
+
+    if(app_cmd) {
+        app_cmd = false;
+        commands.push_back(100 + cmd);
+        if(cmd == 41) {
+            // takes a few goes before the card is ready
+            if(init_count > 0) --init_count;
+            respond(init_count > 0 ? R1_IDLE_STATE : 0);
+        } else {
+            respond(idle | R1_ILLEGAL_COMMAND);
+        }
+        return;
+    }
+
+    commands.push_back(cmd);
+
+    switch(cmd) {
+        case 0: // GO_IDLE_STATE
+            out.clear();
+            state = IDLE;
+            init_count = 3;
+            respond(R1_IDLE_STATE);
+            break;
+
+        case 8: // SEND_IF_COND, echo the voltage and check pattern
+            respond(idle);
+            out.push_back(0x00);
+            out.push_back(0x00);
+            out.push_back((arg >> 8) & 0x0F);
+            out.push_back(arg & 0xFF);
+            break;
+
+        case 55: // APP_CMD
+            app_cmd = true;
+            respond(idle);
+            break;
+
+        case 58: // READ_OCR, powered up and high capacity
+            respond(idle);
+            out.push_back(0xC0);
+            out.push_back(0xFF);
+            out.push_back(0x80);
+            out.push_back(0x00);
+            break;
+
+        case 9: { // SEND_CSD, version 2.0 structure
+            uint8_t csd[16];
+            memset(csd, 0, sizeof(csd));
+            uint32_t c_size = get_blocks() / 1024 - 1;
+            csd[0] = 0x40;
+            csd[7] = (c_size >> 16) & 0x3F;
+            csd[8] = (c_size >> 8) & 0xFF;
+            csd[9] = c_size & 0xFF;
+            respond(idle);
+            out.push_back(0xFF);
+            out.push_back(0xFE);
+            out.insert(out.end(), csd, csd + sizeof(csd));
+            out.push_back(0x00);
+            out.push_back(0x00);
+            break;
+        }
+
+        case 16: // SET_BLOCKLEN, only 512 on a high capacity card
+            respond(idle | (arg == 512 ? 0 : R1_PARAMETER_ERROR));
+            break;
+
+        case 17: // READ_SINGLE_BLOCK
+        case 18: // READ_MULTIPLE_BLOCK
+            if(arg >= get_blocks()) {
+                respond(R1_ADDRESS_ERROR);
+                break;
+            }
+            respond(0);
+            address = arg;
+            multiple = (cmd == 18);
+            read_error = false;
+            state = READING;
+            if(!multiple) {
+                queue_block();
+                state = IDLE;
+            }
+            break;
+
+        case 24: // WRITE_BLOCK
+        case 25: // WRITE_MULTIPLE_BLOCK
+            if(arg >= get_blocks()) {
+                respond(R1_ADDRESS_ERROR);
+                break;
+            }
+            respond(0);
+            address = arg;
+            multiple = (cmd == 25);
+            state = WRITING;
+            break;
+
+        case 12: // STOP_TRANSMISSION, whatever was being sent is dropped, then a stuff byte, R1 and busy
+            if(state != READING) ++protocol_errors;
+            out.clear();
+            out.push_back(0xC3);
+            out.push_back(0x00);
+            busy(2);
+            state = IDLE;
+            break;
+
+        default:
+            respond(idle | R1_ILLEGAL_COMMAND);
+            break;
+    }
+}
+
+// the access time, then a data block or an error token
+void SimSDCard::queue_block()
+{
+    out.push_back(0xFF);
+    out.push_back(0xFF);
+
+    if(address >= get_blocks() || (int32_t)address == fail_read_block) {
+        // out of range error token, the host has to stop the transfer
+        out.push_back(0x08);
+        fail_read_block = -1;
+        read_error = true;
+        return;
+    }
+
+    out.push_back(0xFE);
+    out.insert(out.end(), block(address), block(address) + 512);
+    out.push_back(0x00);
+    out.push_back(0x00);
+    ++address;
+}
+
+// The SDCard driver talks to the card with mbed::SPI and selects it with a GPIO, on the host both end up at the attached card.
+// Nothing else built with the card model uses GPIO so every GPIO write is taken to be the chip select.
+
+mbed::SPI::SPI(PinName mosi, PinName miso, PinName sclk) : _bits(8), _mode(0), _hz(1000000) {}
+
+int mbed::SPI::write(int value)
+{
+    SimSDCard *card = SimSDCard::get_attached();
+    return (card != nullptr) ? card->exchange(value & 0xFF) : 0xFF;
+}
+
+GPIO::GPIO(PinName pin)
+{
+    this->port = (pin >> 5) & 7;
+    this->pin = pin & 0x1F;
+}
+
+void GPIO::output() {}
+
+void GPIO::set()
+{
+    SimSDCard *card = SimSDCard::get_attached();
+    if(card != nullptr) card->select(false);
+}
+
+void GPIO::clear()
+{
+    SimSDCard *card = SimSDCard::get_attached();
+    if(card != nullptr) card->select(true);
+}
+
+int GPIO::operator=(int value)
+{
+    if (value)
+        set();
+    else
+        clear();
+    return value;
+}
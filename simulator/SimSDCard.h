@@ -0,0 +1,70 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SIMSDCARD_H
+#define SIMSDCARD_H
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+// An SD card in SPI mode, good enough to run the SDCard driver against on the host.
+// It follows the command sequences of the SD simplified physical layer spec chapter 7: the
+// initialisation commands of a high capacity v2 card, single and multiple block reads and
+// writes, CMD12 and the stop tran token, with busy time after every write. Every command is
+// logged so tests can check which sequence the driver used, and errors can be injected.
+class SimSDCard {
+    public:
+        SimSDCard(uint32_t blocks);
+
+        // connect the SPI bus and chip select of the SDCard driver to this card
+        static void attach(SimSDCard *card) { attached = card; }
+        static SimSDCard *get_attached() { return attached; }
+
+        // one byte clocked each way on the bus
+        int exchange(int mosi);
+        void select(bool selected) { this->selected = selected; }
+
+        uint8_t *block(uint32_t n) { return &data[n * 512]; }
+        uint32_t get_blocks() const { return data.size() / 512; }
+
+        // commands received, ACMDs are logged as 100 + the command
+        std::vector<int> commands;
+        uint32_t bytes_clocked;
+        // tokens sent while the card was busy, unexpected tokens, and CMD12 outside a multiple block read
+        int protocol_errors;
+
+        // the next write of this block is rejected with a write error, or the next read of it gets an error token
+        int32_t fail_write_block;
+        int32_t fail_read_block;
+
+    private:
+        enum STATE { IDLE, READING, WRITING, RECEIVING, STOPPING };
+
+        void command(uint8_t cmd, uint32_t arg);
+        void queue_block();
+        void respond(uint8_t r1) { out.push_back(0xFF); out.push_back(r1); }
+        void busy(int n) { for (int i = 0; i < n; ++i) out.push_back(0x00); }
+
+        static SimSDCard *attached;
+
+        std::vector<uint8_t> data;
+        std::deque<uint8_t> out;    // bytes the card will send
+        uint8_t cmdbuf[6];
+        int cmdlen;
+        STATE state;
+        bool multiple;              // the current transfer is CMD18 or CMD25
+        bool selected;
+        bool app_cmd;               // last command was CMD55
+        int init_count;             // ACMD41 calls until the card leaves the idle state
+        uint32_t address;           // next block to read or write
+        int rxlen;                  // bytes of the current data block received, including the crc
+        bool read_error;            // an error token was sent, no more blocks are sent until CMD12
+        uint8_t rxbuf[514];
+};
+
+#endif
@@ -0,0 +1,20 @@
+// simulator build: pin change interrupts are never raised on the host
+#pragma once
+
+#include "PinNames.h"
+
+namespace mbed {
+class InterruptIn {
+public:
+    InterruptIn(PinName pin) : pin(pin) {}
+    virtual ~InterruptIn() {}
+    template<typename T> void rise(T *, void (T::*)(void)) {}
+    template<typename T> void fall(T *, void (T::*)(void)) {}
+    void rise(void (*)(void)) {}
+    void fall(void (*)(void)) {}
+    void mode(PinMode) {}
+
+private:
+    PinName pin;
+};
+}
@@ -0,0 +1,142 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+    Host side replacement for the CMSIS LPC17xx.h header used by the simulator build.
+    Only the peripherals touched by the motion core are modelled, each one is a
+    struct in RAM so register writes are harmless and can be inspected by the simulator.
+*/
+
+#ifndef __LPC17xx_H__
+#define __LPC17xx_H__
+
+#include <stdint.h>
+
+#define __I  volatile  // read only on the chip, writable here so the simulator can zero it
+#define __O  volatile
+#define __IO volatile
+
+typedef enum IRQn {
+    PendSV_IRQn  = -2,
+    WDT_IRQn     = 0,
+    TIMER0_IRQn  = 1,
+    TIMER1_IRQn  = 2,
+    TIMER2_IRQn  = 3,
+    TIMER3_IRQn  = 4,
+    UART0_IRQn   = 5,
+    UART1_IRQn   = 6,
+    UART2_IRQn   = 7,
+    UART3_IRQn   = 8,
+    PWM1_IRQn    = 9,
+    SSP0_IRQn    = 14,
+    SSP1_IRQn    = 15,
+    RIT_IRQn     = 29,
+    EINT3_IRQn   = 21,
+    ADC_IRQn     = 22,
+    USB_IRQn     = 24,
+    DMA_IRQn     = 26,
+} IRQn_Type;
+
+typedef struct {
+    __IO uint32_t FIODIR;
+    uint32_t RESERVED0[3];
+    __IO uint32_t FIOMASK;
+    __IO uint32_t FIOPIN;
+    __IO uint32_t FIOSET;
+    __O  uint32_t FIOCLR;
+} LPC_GPIO_TypeDef;
+
+typedef struct {
+    __IO uint32_t PINSEL0, PINSEL1, PINSEL2, PINSEL3, PINSEL4, PINSEL5, PINSEL6, PINSEL7, PINSEL8, PINSEL9, PINSEL10;
+    __IO uint32_t PINMODE0, PINMODE1, PINMODE2, PINMODE3, PINMODE4, PINMODE5, PINMODE6, PINMODE7, PINMODE8, PINMODE9;
+    __IO uint32_t PINMODE_OD0, PINMODE_OD1, PINMODE_OD2, PINMODE_OD3, PINMODE_OD4;
+} LPC_PINCON_TypeDef;
+
+// the timer interrupt flags are cleared by writing a 1 to them as on the chip, so a handler
+// that clears its flag and reads it back sees whether another match came in meanwhile
+struct sim_timer_ir {
+    uint32_t value;
+    operator uint32_t() const { return value; }
+    sim_timer_ir &operator=(uint32_t v) { value &= ~v; return *this; }
+    sim_timer_ir &operator|=(uint32_t v) { value &= ~(value | v); return *this; }
+    void match(uint32_t v) { value |= v; }
+};
+
+typedef struct {
+    sim_timer_ir IR;
+    __IO uint32_t TCR;
+    __IO uint32_t TC;
+    __IO uint32_t PR;
+    __IO uint32_t PC;
+    __IO uint32_t MCR;
+    __IO uint32_t MR0, MR1, MR2, MR3;
+    __IO uint32_t CCR;
+    __I  uint32_t CR0, CR1;
+} LPC_TIM_TypeDef;
+
+typedef struct {
+    __IO uint32_t PCONP;
+    __IO uint32_t PCLKSEL0;
+    __IO uint32_t PCLKSEL1;
+} LPC_SC_TypeDef;
+
+typedef struct {
+    __IO uint32_t WDMOD;
+    __IO uint32_t WDTC;
+    __O  uint32_t WDFEED;
+    __I  uint32_t WDTV;
+    __IO uint32_t WDCLKSEL;
+} LPC_WDT_TypeDef;
+
+// mbed's PinNames.h encodes pins relative to the GPIO block base
+#define LPC_GPIO_BASE   (0x2009C000UL)
+#define LPC_GPIO0_BASE  (LPC_GPIO_BASE + 0x00000)
+#define LPC_PINCON_BASE (0x4002C000UL)
+
+// the simulated peripherals, defined in SimHardware.cpp
+extern LPC_GPIO_TypeDef   sim_gpio[5];
+extern LPC_PINCON_TypeDef sim_pincon;
+extern LPC_TIM_TypeDef    sim_tim[4];
+extern LPC_SC_TypeDef     sim_sc;
+extern LPC_WDT_TypeDef    sim_wdt;
+
+#define LPC_GPIO0   (&sim_gpio[0])
+#define LPC_GPIO1   (&sim_gpio[1])
+#define LPC_GPIO2   (&sim_gpio[2])
+#define LPC_GPIO3   (&sim_gpio[3])
+#define LPC_GPIO4   (&sim_gpio[4])
+#define LPC_PINCON  (&sim_pincon)
+#define LPC_TIM0    (&sim_tim[0])
+#define LPC_TIM1    (&sim_tim[1])
+#define LPC_TIM2    (&sim_tim[2])
+#define LPC_TIM3    (&sim_tim[3])
+#define LPC_SC      (&sim_sc)
+#define LPC_WDT     (&sim_wdt)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern uint32_t SystemCoreClock;
+
+// interrupts are modelled by the simulator calling the handlers directly, so masking is a no-op
+static inline void __disable_irq() {}
+static inline void __enable_irq() {}
+static inline void __NOP() {}
+static inline void NVIC_EnableIRQ(IRQn_Type) {}
+static inline void NVIC_DisableIRQ(IRQn_Type) {}
+static inline void NVIC_SetPendingIRQ(IRQn_Type) {}
+static inline void NVIC_SetPriority(IRQn_Type, uint32_t) {}
+static inline uint32_t NVIC_GetPriority(IRQn_Type) { return 0; }
+static inline void NVIC_SetPriorityGrouping(uint32_t) {}
+void NVIC_SystemReset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,26 @@
+// simulator build: hardware PWM is not modelled, the duty cycle is just remembered
+#pragma once
+
+#include "PinNames.h"
+
+namespace mbed {
+class PwmOut {
+public:
+    PwmOut(PinName pin) : pin(pin), value(0), period_width(20000) {}
+    void write(float v) { value= v; }
+    float read() { return value; }
+    void period(float s) { period_width= s * 1000000.0F; }
+    void period_ms(int ms) { period_width= ms * 1000; }
+    void period_us(int us) { period_width= us; }
+    void pulsewidth(float s) { value= (s * 1000000.0F) / period_width; }
+    void pulsewidth_ms(int ms) { value= (ms * 1000.0F) / period_width; }
+    void pulsewidth_us(int us) { value= (float)us / period_width; }
+    PwmOut& operator= (float v) { write(v); return *this; }
+    operator float() { return read(); }
+
+private:
+    PinName pin;
+    float value;
+    int period_width;
+};
+}
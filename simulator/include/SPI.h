@@ -0,0 +1,20 @@
+// simulator build: the SPI bus is connected to whatever device model is attached in SimSDCard.cpp
+#pragma once
+
+#include "PinNames.h"
+
+namespace mbed {
+class SPI {
+public:
+    SPI(PinName mosi, PinName miso, PinName sclk);
+    virtual ~SPI() {}
+    void format(int bits, int mode = 0) { _bits= bits; _mode= mode; }
+    void frequency(int hz = 1000000) { _hz= hz; }
+    virtual int write(int value);
+
+protected:
+    int _bits;
+    int _mode;
+    int _hz;
+};
+}
@@ -0,0 +1,25 @@
+// simulator build: mbed::Timer on top of the simulated microsecond ticker
+#pragma once
+
+#include "us_ticker_api.h"
+
+namespace mbed {
+class Timer {
+public:
+    Timer() : running(false), start_us(0), accumulated(0) {}
+    void start() { if(!running) { start_us= us_ticker_read(); running= true; } }
+    void stop() { accumulated += slice(); running= false; }
+    void reset() { start_us= us_ticker_read(); accumulated= 0; }
+    int read_us() { return accumulated + slice(); }
+    int read_ms() { return read_us() / 1000; }
+    float read() { return read_us() / 1000000.0F; }
+
+private:
+    int slice() { return running ? (int)(us_ticker_read() - start_us) : 0; }
+    bool running;
+    uint32_t start_us;
+    int accumulated;
+};
+}
+
+using namespace mbed;
@@ -0,0 +1,7 @@
+#pragma once
+
+// simulator build: newlib's fastmath.h maps onto the regular libm
+#include <math.h>
+
+// newlib extension used by the temperature sensors
+static inline float infinityf() { return INFINITY; }
@@ -0,0 +1,2 @@
+// simulator build: use the host side register model
+#include "LPC17xx.h"
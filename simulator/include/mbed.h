@@ -0,0 +1,19 @@
+// simulator build: the subset of the mbed API used by the code built for the host
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "cmsis.h"
+#include "PinNames.h"
+#include "us_ticker_api.h"
+#include "wait_api.h"
+#include "PwmOut.h"
+#include "InterruptIn.h"
+#include "Timer.h"
+#include "SPI.h"
+
+using namespace mbed;
+using namespace std;
@@ -0,0 +1,8 @@
+// simulator build: there is no debug monitor on the host, a debugbreak is fatal
+#pragma once
+
+#include <stdlib.h>
+
+#define MRI_ENABLE 0
+
+static inline void __debugbreak(void) { abort(); }
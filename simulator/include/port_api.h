@@ -0,0 +1,7 @@
+// simulator build: pin/port mapping as done by the mbed LPC1768 port api
+#pragma once
+
+#include "PinNames.h"
+#include "PortNames.h"
+
+static inline PinName port_pin(PortName port, int pin_n) { return (PinName)(LPC_GPIO0_BASE + ((port << PORT_SHIFT) | pin_n)); }
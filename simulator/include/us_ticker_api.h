@@ -0,0 +1,14 @@
+// simulator build: microsecond ticker driven by the simulated step timer
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t us_ticker_read(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,14 @@
+// simulator build: waits advance simulated time instead of spinning
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void wait(float s);
+void wait_ms(int ms);
+void wait_us(int us);
+
+#ifdef __cplusplus
+}
+#endif
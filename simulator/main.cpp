@@ -0,0 +1,164 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+Host side motion simulator, feeds a gcode file through the real GcodeDispatch, Robot, Planner and Conveyor
+and runs the StepTicker against a simulated clock. Reports the simulated job time and optionally writes a step/dir trace.
+*/
+
+#include "libs/Kernel.h"
+#include "libs/StreamOutputPool.h"
+#include "libs/SerialMessage.h"
+#include "libs/StepTicker.h"
+#include "modules/robot/Robot.h"
+#include "modules/robot/Conveyor.h"
+#include "FirmConfigSource.h"
+#include "platform_memory.h"
+
+#include "SimHardware.h"
+#include "EventProfiler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+
+#ifndef SIM_DEFAULT_CONFIG
+#define SIM_DEFAULT_CONFIG "config"
+#endif
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-c config] [-t trace.csv] [-i idle_ticks] [-v] [-p] file.gcode\n", name);
+    fprintf(stderr, "  -c config      config file to use (default %s)\n", SIM_DEFAULT_CONFIG);
+    fprintf(stderr, "  -t trace.csv   write a line for every step tick that issued a step\n");
+    fprintf(stderr, "  -i idle_ticks  step ticks that elapse for each pass of the idle loop (default 10)\n");
+    fprintf(stderr, "  -v             print the responses to each line\n");
+    fprintf(stderr, "  -p             print the time each module took handling each event, the step interrupt times and the queue stats\n");
+}
+
+// reads the whole file into memory, the caller owns the buffer
+static char *read_file(const char *fn, size_t& len)
+{
+    FILE *fp = fopen(fn, "rb");
+    if(fp == NULL) return NULL;
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *buf = (char *)malloc(len + 1);
+    len = fread(buf, 1, len, fp);
+    buf[len] = '\0';
+    fclose(fp);
+    return buf;
+}
+
+// the two 16K AHB banks of the LPC1768, setup the same way as build/mbed_custom.cpp does
+static uint8_t ahb0_bank[0x4000];
+static uint8_t ahb1_bank[0x4000];
+
+int main(int argc, char *argv[])
+{
+    _AHB0 = new MemoryPool(ahb0_bank, sizeof(ahb0_bank));
+    _AHB1 = new MemoryPool(ahb1_bank, sizeof(ahb1_bank));
+
+    const char *config_fn = SIM_DEFAULT_CONFIG;
+    const char *trace_fn = NULL;
+    uint32_t idle_ticks = 10;
+    bool verbose = false;
+    bool profile = false;
+
+    int c;
+    while((c = getopt(argc, argv, "c:t:i:vph")) != -1) {
+        switch(c) {
+            case 'c': config_fn = optarg; break;
+            case 't': trace_fn = optarg; break;
+            case 'i': idle_ticks = strtoul(optarg, NULL, 10); break;
+            case 'v': verbose = true; break;
+            case 'p': profile = true; break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+
+    if(optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char *gcode_fn = argv[optind];
+
+    size_t config_len;
+    char *config = read_file(config_fn, config_len);
+    if(config == NULL) {
+        fprintf(stderr, "Could not open config file: %s\n", config_fn);
+        return 1;
+    }
+    sim_config_source = new FirmConfigSource("sim", config, config + config_len);
+
+    FILE *gcode = fopen(gcode_fn, "r");
+    if(gcode == NULL) {
+        fprintf(stderr, "Could not open gcode file: %s\n", gcode_fn);
+        return 1;
+    }
+
+    FILE *trace = NULL;
+    if(trace_fn != NULL) {
+        trace = fopen(trace_fn, "w");
+        if(trace == NULL) {
+            fprintf(stderr, "Could not open trace file: %s\n", trace_fn);
+            return 1;
+        }
+    }
+
+    Kernel *kernel = new Kernel();
+    if(profile) {
+        kernel->event_profiler = new EventProfiler();
+        kernel->step_ticker->set_timing(true);
+    }
+
+    SimStepTimer *timer = new SimStepTimer(idle_ticks > 0 ? idle_ticks : 1, trace);
+    kernel->add_module(timer, "SimStepTimer");
+
+    THEKERNEL->conveyor->start(THEROBOT->get_number_registered_motors());
+    THEKERNEL->step_ticker->start();
+
+    // feed one line per pass of the main loop, as the serial console would when the host keeps up,
+    // the queue running dry before the file has all been read is counted as an underrun as when the player plays it
+    char buf[256];
+    unsigned int lines = 0;
+    THECONVEYOR->set_playing(true);
+    while(fgets(buf, sizeof buf, gcode) != NULL) {
+        // the consoles pass on the line without its newline
+        buf[strcspn(buf, "\r\n")] = '\0';
+        struct SerialMessage message = {verbose ? (StreamOutput *)&sim_stdout : &(StreamOutput::NullStream), buf, 0};
+        kernel->call_event(ON_CONSOLE_LINE_RECEIVED, &message);
+        kernel->call_event(ON_MAIN_LOOP);
+        kernel->call_event(ON_IDLE);
+        ++lines;
+        if(kernel->is_halted()) break;
+    }
+    fclose(gcode);
+    THECONVEYOR->set_playing(false);
+
+    // run until the last block has been stepped out
+    THECONVEYOR->wait_for_idle();
+
+    if(trace != NULL) fclose(trace);
+
+    float secs = timer->get_microseconds() / 1000000.0F;
+    printf("lines: %u\n", lines);
+    printf("steps: %llu\n", (unsigned long long)timer->get_step_count());
+    printf("step ticks: %llu\n", (unsigned long long)timer->get_ticks());
+    printf("simulated time: %1.4f s\n", secs);
+    if(profile) {
+        kernel->event_profile_report(&sim_stdout);
+        kernel->step_ticker->report_timing(&sim_stdout);
+        kernel->conveyor->report_queue_stats(&sim_stdout);
+    }
+
+    free(config);
+    return kernel->is_halted() ? 2 : 0;
+}
@@ -0,0 +1,104 @@
+#include "Adc.h"
+#include "Pin.h"
+
+#include <stdlib.h>
+
+#include "easyunit/test.h"
+
+// the pin is AD0.1 and the readings are given to new_sample() as the ADC interrupt would
+#define SETUP_ADC(filter) \
+    Adc adc; \
+    Pin pin; \
+    pin.from_string("0.24"); \
+    adc.enable_pin(&pin, filter);
+
+static void sample(Adc &adc, uint32_t reading)
+{
+    adc.new_sample(1, reading << 4);
+}
+
+// readings around the value with up to 3 counts of noise, and every 7th one a spike to full scale or zero
+static void noisy_samples(Adc &adc, uint32_t value, int n)
+{
+    for (int i = 0; i < n; ++i) {
+        uint32_t r = value + (rand() % 7) - 3;
+        if(i % 7 == 3) r = (i % 2) ? 4095 : 0;
+        sample(adc, r);
+    }
+}
+
+static bool near(unsigned int reading, uint32_t value, uint32_t within)
+{
+    uint32_t expected = value << OVERSAMPLE;
+    return reading + within >= expected && reading <= expected + within;
+}
+
+TEST(AdcTest,median_rejects_spikes)
+{
+    SETUP_ADC(Adc::FILTER_MEDIAN)
+    srand(1);
+
+    noisy_samples(adc, 2000, 200);
+    ASSERT_TRUE(near(adc.read(&pin), 2000, 3 << OVERSAMPLE));
+
+    // a clean reading is exact
+    for (int i = 0; i < 32; ++i) sample(adc, 1234);
+    ASSERT_TRUE(adc.read(&pin) == (1234 << OVERSAMPLE));
+}
+
+TEST(AdcTest,iir_rejects_spikes)
+{
+    SETUP_ADC(Adc::FILTER_IIR)
+    srand(2);
+
+    // it starts from the first sample
+    sample(adc, 2000);
+    ASSERT_TRUE(adc.read(&pin) == (2000 << OVERSAMPLE));
+
+    unsigned int worst = 0;
+    for (int i = 0; i < 50; ++i) {
+        noisy_samples(adc, 2000, 7);
+        unsigned int r = adc.read(&pin);
+        unsigned int e = (r > (2000 << OVERSAMPLE)) ? r - (2000 << OVERSAMPLE) : (2000 << OVERSAMPLE) - r;
+        if(e > worst) worst = e;
+    }
+    ASSERT_TRUE(worst <= (3 << OVERSAMPLE));
+}
+
+TEST(AdcTest,iir_follows_a_real_change)
+{
+    SETUP_ADC(Adc::FILTER_IIR)
+
+    for (int i = 0; i < 20; ++i) sample(adc, 1000);
+    // a couple of spikes are ignored
+    sample(adc, 3000);
+    sample(adc, 3000);
+    ASSERT_TRUE(adc.read(&pin) == (1000 << OVERSAMPLE));
+
+    // but if it stays there it is a real change, like a thermistor coming unplugged
+    for (int i = 0; i < 2; ++i) sample(adc, 3000);
+    ASSERT_TRUE(adc.read(&pin) == (3000 << OVERSAMPLE));
+
+    // small changes are followed smoothly
+    for (int i = 0; i < 100; ++i) sample(adc, 3050);
+    ASSERT_TRUE(near(adc.read(&pin), 3050, 1));
+}
+
+TEST(AdcTest,filter_for_each_pin)
+{
+    SETUP_ADC(Adc::FILTER_MEDIAN)
+    Pin pin2;
+    pin2.from_string("0.25");
+    adc.enable_pin(&pin2, Adc::FILTER_IIR);
+
+    for (int i = 0; i < 32; ++i) {
+        sample(adc, 500);
+        adc.new_sample(2, 800 << 4);
+    }
+    ASSERT_TRUE(adc.read(&pin) == (500 << OVERSAMPLE));
+    ASSERT_TRUE(adc.read(&pin2) == (800 << OVERSAMPLE));
+
+    ASSERT_TRUE(Adc::filter_from_string("median") == Adc::FILTER_MEDIAN);
+    ASSERT_TRUE(Adc::filter_from_string("iir") == Adc::FILTER_IIR);
+    ASSERT_TRUE(Adc::filter_from_string("") == Adc::FILTER_SORTED);
+}
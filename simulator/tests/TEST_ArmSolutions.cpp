@@ -0,0 +1,121 @@
+#include "LinearDeltaSolution.h"
+#include "RotaryDeltaSolution.h"
+#include "MorganSCARASolution.h"
+#include "ConfigSources/FirmConfigSource.h"
+#include "Config.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "easyunit/test.h"
+
+// as Robot batches the segments of a line
+#define BATCH 8
+#define GRID 6
+
+// the solution defaults are used, only the arm solution is named
+static Config *make_config(const char *text)
+{
+    FirmConfigSource *src = new FirmConfigSource("test", text, text + strlen(text));
+    Config *config = new Config(src);
+    config->config_cache_load();
+    return config;
+}
+
+// a grid of positions around the middle of the bed, centre + span * (-1..1)
+static void make_positions(float pos[][3], int n, float span, float z)
+{
+    for (int i = 0; i < n; i++) {
+        pos[i][0] = span * (((i % GRID) * 2.0F / (GRID - 1)) - 1.0F);
+        pos[i][1] = span * ((((i / GRID) % GRID) * 2.0F / (GRID - 1)) - 1.0F);
+        pos[i][2] = z + (i / (GRID * GRID)) * 5.0F;
+    }
+}
+
+// the largest difference between the batch and converting each position on its own
+static float max_difference(BaseSolution &s, float span, float z)
+{
+    const int n = GRID * GRID * 4;
+    float pos[n][3];
+    make_positions(pos, n, span, z);
+
+    float worst = 0;
+    for (int i = 0; i < n; i += BATCH) {
+        ActuatorCoordinates batch[BATCH];
+        s.cartesian_to_actuators(&pos[i], batch, BATCH);
+        for (int j = 0; j < BATCH; j++) {
+            ActuatorCoordinates single;
+            s.cartesian_to_actuator(pos[i + j], single);
+            for (int a = 0; a < 3; a++) {
+                float e = fabsf(batch[j][a] - single[a]);
+                if(!(e <= worst)) worst = e; // also catches nan
+            }
+        }
+    }
+    return worst;
+}
+
+// segments per second one at a time and in batches, printed so the two can be compared
+static void benchmark(const char *name, BaseSolution &s, float span, float z)
+{
+    const int n = GRID * GRID * 4;
+    const int loops = 2000;
+    float pos[n][3];
+    make_positions(pos, n, span, z);
+    ActuatorCoordinates out[BATCH];
+    volatile float sink = 0;
+
+    clock_t start = clock();
+    for (int l = 0; l < loops; l++) {
+        for (int i = 0; i < n; i++) {
+            s.cartesian_to_actuator(pos[i], out[0]);
+            sink += out[0][0];
+        }
+    }
+    float single = (float)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (int l = 0; l < loops; l++) {
+        for (int i = 0; i < n; i += BATCH) {
+            s.cartesian_to_actuators(&pos[i], out, BATCH);
+            sink += out[0][0];
+        }
+    }
+    float batch = (float)(clock() - start) / CLOCKS_PER_SEC;
+
+    float segments = (float)n * loops;
+    printf("%s: %.0f segments/s single, %.0f segments/s batched\n", name,
+           single > 0 ? segments / single : 0, batch > 0 ? segments / batch : 0);
+}
+
+TEST(ArmSolutionsTest,linear_delta_batch)
+{
+    Config *config = make_config("arm_solution linear_delta\n");
+    LinearDeltaSolution s(config);
+    ASSERT_TRUE(max_difference(s, 80, 0) < 0.001F);
+    benchmark("linear delta", s, 80, 0);
+}
+
+TEST(ArmSolutionsTest,rotary_delta_batch)
+{
+    Config *config = make_config("arm_solution rotary_delta\n");
+    RotaryDeltaSolution s(config);
+    // the angles are in degrees and the divide by z is done once for all three arms
+    ASSERT_TRUE(max_difference(s, 40, -20) < 0.01F);
+    // and the grid is reachable, an impossible position would be 0 both ways
+    float corner[1][3] = {{40, 40, -20}};
+    ActuatorCoordinates a[1];
+    s.cartesian_to_actuators(corner, a, 1);
+    ASSERT_TRUE(a[0][0] != 0 && a[0][1] != 0 && a[0][2] != 0);
+    benchmark("rotary delta", s, 40, -20);
+}
+
+TEST(ArmSolutionsTest,morgan_scara_batch)
+{
+    Config *config = make_config("arm_solution morgan\n");
+    MorganSCARASolution s(config);
+    ASSERT_TRUE(max_difference(s, 60, 0) < 0.01F);
+    benchmark("morgan scara", s, 60, 0);
+}
@@ -0,0 +1,114 @@
+#include "Block.h"
+#include "libs/Kernel.h"
+#include "libs/StepTicker.h"
+#include "ConfigSources/FirmConfigSource.h"
+#include "SimHardware.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "easyunit/test.h"
+
+#define ACCELERATION 1000.0F
+#define JERK 20000.0F
+#define STEPS_PER_MM 80.0F
+
+// the block only needs the step ticker frequency from the kernel, the defaults are used
+static void setup_kernel()
+{
+    if(THEKERNEL != nullptr) return;
+    static const char text[] = "\n";
+    sim_config_source = new FirmConfigSource("test", text, text + strlen(text));
+    new Kernel();
+    Block::init(1);
+}
+
+static void setup_block(Block &b, float mm, float speed)
+{
+    b.steps[0] = lroundf(mm * STEPS_PER_MM);
+    b.steps_event_count = b.steps[0];
+    b.millimeters = mm;
+    b.nominal_speed = speed;
+    b.nominal_rate = b.steps_event_count * speed / mm;
+    b.acceleration = ACCELERATION;
+    b.jerk = JERK;
+}
+
+// the peak acceleration and jerk of a ramp as stepticker will follow them, in mm/s² and mm/s³
+static void ramp_peaks(const Block &b, uint32_t jerk_ticks, int64_t jerk_fp, float &acceleration, float &jerk)
+{
+    float f = THEKERNEL->step_ticker->get_frequency();
+    float j = fabsf(STEPTICKER_FROMFP(jerk_fp)); // steps/tick³
+    jerk = j * f * f * f / STEPS_PER_MM;
+    acceleration = j * jerk_ticks * f * f / STEPS_PER_MM;
+}
+
+// the ramps stay within the settings and the profile covers the block
+static bool within_limits(const Block &b)
+{
+    float acceleration, jerk;
+    if(b.accel_jerk_ticks != 0) {
+        ramp_peaks(b, b.accel_jerk_ticks, b.jerk_info[0].accel_jerk, acceleration, jerk);
+        if(acceleration > ACCELERATION * 1.001F || jerk > JERK * 1.001F) return false;
+    }
+    if(b.decel_jerk_ticks != 0) {
+        ramp_peaks(b, b.decel_jerk_ticks, b.jerk_info[0].decel_jerk, acceleration, jerk);
+        if(acceleration > ACCELERATION * 1.001F || jerk > JERK * 1.001F) return false;
+    }
+
+    // the ramps are rounded up to whole ticks so it can end a little past the block
+    float steps = b.steps_at_tick(b.total_move_ticks);
+    return steps >= b.steps_event_count - 1 && steps <= b.steps_event_count * 1.01F + 2;
+}
+
+TEST(BlockTest,s_curve_long_move)
+{
+    setup_kernel();
+    Block b;
+    setup_block(b, 100, 100);
+    b.calculate_trapezoid(0, 0);
+    ASSERT_TRUE(b.s_curve);
+    ASSERT_TRUE(b.maximum_rate == b.nominal_rate);
+    ASSERT_TRUE(within_limits(b));
+}
+
+TEST(BlockTest,s_curve_short_move)
+{
+    setup_kernel();
+    Block b;
+    // too short to reach the full acceleration, the speed it gets to is lowered
+    setup_block(b, 0.5F, 100);
+    b.calculate_trapezoid(0, 0);
+    ASSERT_TRUE(b.maximum_rate < b.nominal_rate);
+    ASSERT_TRUE(within_limits(b));
+}
+
+TEST(BlockTest,s_curve_entry_and_exit)
+{
+    setup_kernel();
+    Block b;
+    setup_block(b, 10, 80);
+    b.calculate_trapezoid(30, 5);
+    ASSERT_TRUE(within_limits(b));
+
+    // a small speed change is all jerk phases
+    setup_block(b, 10, 51);
+    b.calculate_trapezoid(50, 50);
+    ASSERT_TRUE(within_limits(b));
+}
+
+TEST(BlockTest,s_curve_planned_speeds_fit)
+{
+    setup_kernel();
+    Block b;
+    // the fastest entry the planner allows to stop within the block, with and without reaching the full acceleration
+    float lengths[] = {0.05F, 2, 20};
+    for (float mm : lengths) {
+        setup_block(b, mm, 1000);
+        float entry = b.max_allowable_speed(-ACCELERATION, 0, mm);
+        ASSERT_TRUE(entry < 1000);
+        b.calculate_trapezoid(entry, 0);
+        ASSERT_TRUE(within_limits(b));
+        ASSERT_TRUE(fabsf(b.maximum_rate - b.initial_rate) <= b.initial_rate * 0.01F);
+    }
+}
@@ -0,0 +1,159 @@
+#include "SDCard.h"
+#include "SimSDCard.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "easyunit/test.h"
+
+// the card model is attached before the driver is created, as the constructor deselects the card
+#define SETUP_CARD \
+    SimSDCard card(4096); \
+    SimSDCard::attach(&card); \
+    SDCard sd(P0_9, P0_8, P0_7, P0_6); \
+    ASSERT_TRUE(sd.disk_initialize() == 0);
+
+static void fill(char *buf, int n, int seed)
+{
+    for (int i = 0; i < n; ++i) buf[i] = (char)(i * 7 + seed);
+}
+
+static bool has_command(const SimSDCard &card, int cmd)
+{
+    return std::find(card.commands.begin(), card.commands.end(), cmd) != card.commands.end();
+}
+
+TEST(SDCardTest,initialize)
+{
+    SETUP_CARD
+
+    ASSERT_TRUE(sd.card_type() == SDCard::SDCARD_V2HC);
+    ASSERT_TRUE(sd.disk_sectors() == 4096);
+    // CMD0, CMD8, then ACMD41 until ready, CMD58, CMD9 and CMD16
+    ASSERT_TRUE(card.commands.front() == 0);
+    ASSERT_TRUE(has_command(card, 8));
+    ASSERT_TRUE(has_command(card, 141));
+    ASSERT_TRUE(has_command(card, 58));
+    ASSERT_TRUE(card.commands.back() == 16);
+    ASSERT_TRUE(card.protocol_errors == 0);
+
+    SimSDCard::attach(nullptr);
+}
+
+TEST(SDCardTest,single_block)
+{
+    SETUP_CARD
+
+    char wbuf[512], rbuf[512];
+    fill(wbuf, sizeof(wbuf), 3);
+    card.commands.clear();
+
+    ASSERT_TRUE(sd.disk_write(wbuf, 5) == 0);
+    ASSERT_TRUE(memcmp(card.block(5), wbuf, 512) == 0);
+    ASSERT_TRUE(sd.disk_read(rbuf, 5) == 0);
+    ASSERT_TRUE(memcmp(rbuf, wbuf, 512) == 0);
+
+    ASSERT_TRUE(card.commands.size() == 2);
+    ASSERT_TRUE(card.commands[0] == 24);
+    ASSERT_TRUE(card.commands[1] == 17);
+    ASSERT_TRUE(card.protocol_errors == 0);
+
+    SimSDCard::attach(nullptr);
+}
+
+TEST(SDCardTest,multiple_blocks)
+{
+    SETUP_CARD
+
+    static char wbuf[8 * 512], rbuf[8 * 512];
+    fill(wbuf, sizeof(wbuf), 11);
+    card.commands.clear();
+
+    ASSERT_TRUE(sd.disk_write(wbuf, 100, 8) == 0);
+    ASSERT_TRUE(memcmp(card.block(100), wbuf, sizeof(wbuf)) == 0);
+    ASSERT_TRUE(sd.disk_read(rbuf, 100, 8) == 0);
+    ASSERT_TRUE(memcmp(rbuf, wbuf, sizeof(rbuf)) == 0);
+
+    // one command for each transfer, the read is ended with CMD12
+    ASSERT_TRUE(card.commands.size() == 3);
+    ASSERT_TRUE(card.commands[0] == 25);
+    ASSERT_TRUE(card.commands[1] == 18);
+    ASSERT_TRUE(card.commands[2] == 12);
+    ASSERT_TRUE(card.protocol_errors == 0);
+
+    // the blocks either side are untouched
+    static const char zero[512] = {0};
+    ASSERT_TRUE(memcmp(card.block(99), zero, 512) == 0);
+    ASSERT_TRUE(memcmp(card.block(108), zero, 512) == 0);
+
+    SimSDCard::attach(nullptr);
+}
+
+TEST(SDCardTest,multiple_blocks_use_fewer_bytes)
+{
+    SETUP_CARD
+
+    static char buf[8 * 512];
+    fill(buf, sizeof(buf), 1);
+
+    card.bytes_clocked = 0;
+    for (int i = 0; i < 8; ++i) {
+        ASSERT_TRUE(sd.disk_read(buf + i * 512, 200 + i) == 0);
+    }
+    uint32_t single = card.bytes_clocked;
+
+    card.bytes_clocked = 0;
+    ASSERT_TRUE(sd.disk_read(buf, 200, 8) == 0);
+    uint32_t multiple = card.bytes_clocked;
+
+    ASSERT_TRUE(multiple < single);
+
+    SimSDCard::attach(nullptr);
+}
+
+TEST(SDCardTest,write_error)
+{
+    SETUP_CARD
+
+    static char buf[4 * 512];
+    fill(buf, sizeof(buf), 5);
+
+    // the third block is rejected, the transfer must still be stopped properly
+    card.fail_write_block = 302;
+    ASSERT_TRUE(sd.disk_write(buf, 300, 4) != 0);
+    ASSERT_TRUE(card.protocol_errors == 0);
+    ASSERT_TRUE(memcmp(card.block(300), buf, 2 * 512) == 0);
+
+    // and the card is usable afterwards
+    ASSERT_TRUE(sd.disk_write(buf, 300, 4) == 0);
+    ASSERT_TRUE(memcmp(card.block(300), buf, sizeof(buf)) == 0);
+    ASSERT_TRUE(card.protocol_errors == 0);
+
+    SimSDCard::attach(nullptr);
+}
+
+TEST(SDCardTest,read_error)
+{
+    SETUP_CARD
+
+    static char buf[4 * 512];
+    memcpy(card.block(400), "hello", 5);
+
+    card.fail_read_block = 401;
+    ASSERT_TRUE(sd.disk_read(buf, 400, 4) != 0);
+    ASSERT_TRUE(card.commands.back() == 12);
+    ASSERT_TRUE(card.protocol_errors == 0);
+
+    card.fail_read_block = 400;
+    ASSERT_TRUE(sd.disk_read(buf, 400) != 0);
+
+    ASSERT_TRUE(sd.disk_read(buf, 400, 4) == 0);
+    ASSERT_TRUE(memcmp(buf, "hello", 5) == 0);
+
+    // past the end of the card
+    ASSERT_TRUE(sd.disk_read(buf, 4096, 2) != 0);
+    ASSERT_TRUE(sd.disk_read(buf, 400) == 0);
+    ASSERT_TRUE(card.protocol_errors == 0);
+
+    SimSDCard::attach(nullptr);
+}
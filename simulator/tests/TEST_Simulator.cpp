@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#include "easyunit/test.h"
+
+// whole jobs run through the simulator, with the sample config and the settings given added to it
+
+static bool write_file(const char *fn, const std::string &text)
+{
+    FILE *fp = fopen(fn, "w");
+    if(fp == NULL) return false;
+    fputs(text.c_str(), fp);
+    fclose(fp);
+    return true;
+}
+
+static std::string sample_config()
+{
+    std::string text;
+    FILE *fp = fopen(SIM_DEFAULT_CONFIG, "r");
+    if(fp == NULL) return text;
+    char buf[256];
+    while(fgets(buf, sizeof buf, fp) != NULL) text += buf;
+    fclose(fp);
+    return text;
+}
+
+// the simulated job time in seconds, or -1 if it did not run
+static float job_time(const char *settings, const char *gcode_fn)
+{
+    const char *config_fn = "/tmp/smoothietest.config";
+    if(!write_file(config_fn, sample_config() + "\n" + settings)) return -1;
+
+    std::string cmd = std::string(SIM_PROGRAM) + " -c " + config_fn + " " + gcode_fn;
+    FILE *p = popen(cmd.c_str(), "r");
+    if(p == NULL) return -1;
+    float secs = -1;
+    char buf[256];
+    while(fgets(buf, sizeof buf, p) != NULL) {
+        sscanf(buf, "simulated time: %f", &secs);
+    }
+    pclose(p);
+    return secs;
+}
+
+TEST(SimulatorTest,segmented_short_moves_keep_lookahead)
+{
+    // short moves need the planner to see ahead, stepping them in segments must not make it stop at each one
+    const char *gcode_fn = "/tmp/smoothietest.gcode";
+    std::string gcode = "G1 X0 Y0 F6000\n";
+    char line[32];
+    for (int i = 1; i <= 4000; ++i) {
+        snprintf(line, sizeof line, "G1 X%1.2f\n", i * 0.05F);
+        gcode += line;
+    }
+    ASSERT_TRUE(write_file(gcode_fn, gcode));
+
+    float unsegmented = job_time("", gcode_fn);
+    float segmented = job_time("segmented_stepping true\n", gcode_fn);
+    printf("4000 moves of 0.05mm: %1.3f s per tick, %1.3f s segmented\n", unsegmented, segmented);
+    ASSERT_TRUE(unsegmented > 0);
+    ASSERT_TRUE(segmented > 0 && segmented < unsegmented * 1.1F);
+}
@@ -0,0 +1,83 @@
+#include "Thermistor.h"
+
+#include <math.h>
+
+#include "easyunit/test.h"
+
+// the oversampled ADC full scale, as Adc::get_max_value()
+#define MAX_ADC (4095 << 2)
+
+// the largest difference between the table and the closed form for readings from 0°C to 400°C
+static float max_error(Thermistor &t)
+{
+    float worst = 0;
+    for (uint32_t adc = 1; adc < MAX_ADC; ++adc) {
+        float exact = t.calculate_temperature(adc);
+        if(!(exact >= 0 && exact <= 400)) continue;
+        float e = fabsf(t.adc_value_to_temperature(adc) - exact);
+        if(!(e <= worst)) worst = e; // also catches nan
+    }
+    return worst;
+}
+
+static void use_predefined(Thermistor &t, int n)
+{
+    Thermistor::sensor_options_t options;
+    options['P'] = n;
+    t.set_optional(options);
+    t.build_table(MAX_ADC);
+}
+
+TEST(ThermistorTest,steinhart_hart_table)
+{
+    Thermistor t;
+    use_predefined(t, 1); // EPCOS100K
+    ASSERT_TRUE(max_error(t) < 0.3F);
+
+    // 25°C is 100k, with the 4.7k pull up that is this reading
+    uint32_t adc = lroundf(MAX_ADC * 100000.0F / 104700.0F);
+    ASSERT_TRUE(fabsf(t.adc_value_to_temperature(adc) - 25.0F) < 0.5F);
+}
+
+TEST(ThermistorTest,beta_table)
+{
+    Thermistor t;
+    use_predefined(t, 129); // EPCOS100K from the beta table
+    ASSERT_TRUE(max_error(t) < 0.3F);
+}
+
+TEST(ThermistorTest,parallel_resistor_table)
+{
+    Thermistor t;
+    use_predefined(t, 131); // RRRF10K has r1 in parallel
+    ASSERT_TRUE(max_error(t) < 0.3F);
+}
+
+TEST(ThermistorTest,out_of_range)
+{
+    Thermistor t;
+    use_predefined(t, 1);
+
+    ASSERT_TRUE(isinf(t.adc_value_to_temperature(0)));
+    ASSERT_TRUE(isinf(t.adc_value_to_temperature(MAX_ADC)));
+    // over 800k is an open circuit
+    ASSERT_TRUE(isinf(t.adc_value_to_temperature(MAX_ADC - 10)));
+    // the readings next to the ends are not in the table and use the closed form
+    ASSERT_TRUE(t.adc_value_to_temperature(5) == t.calculate_temperature(5));
+}
+
+TEST(ThermistorTest,table_follows_settings)
+{
+    Thermistor t;
+    use_predefined(t, 129);
+    uint32_t adc = MAX_ADC / 20;
+    float before = t.adc_value_to_temperature(adc);
+
+    // a different beta is used straight away
+    Thermistor::sensor_options_t options;
+    options['B'] = 3950;
+    ASSERT_TRUE(t.set_optional(options));
+    float after = t.adc_value_to_temperature(adc);
+    ASSERT_TRUE(fabsf(after - before) > 1.0F);
+    ASSERT_TRUE(fabsf(after - t.calculate_temperature(adc)) < 0.3F);
+}
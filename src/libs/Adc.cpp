@@ -23,6 +23,19 @@
 
 Adc *Adc::instance;
 
+#ifdef OVERSAMPLE
+#define READ_SHIFT OVERSAMPLE
+#else
+#define READ_SHIFT 0
+#endif
+
+// a FILTER_IIR sample further than this many 12 bit counts from the filtered value is taken as a spike
+#define IIR_SPIKE 128
+// unless there are this many in a row, then the reading has really changed and the filter starts again from there
+#define IIR_MAX_REJECTS 4
+// each sample moves the filtered value 1/16 of the way to it
+#define IIR_SHIFT 4
+
 static void sample_isr(int chan, uint32_t value)
 {
     Adc::instance->new_sample(chan, value);
@@ -31,6 +44,13 @@ static void sample_isr(int chan, uint32_t value)
 Adc::Adc()
 {
     instance = this;
+    for (int i = 0; i < num_channels; ++i) {
+        filters[i] = FILTER_SORTED;
+        sorted_buffers[i] = nullptr;
+        iir_values[i] = 0;
+        iir_rejects[i] = 0;
+    }
+
     // ADC sample rate need to be fast enough to be able to read the enabled channels within the thermistor poll time
     // even though ther maybe 32 samples we only need one new one within the polling time
     const uint32_t sample_rate= 1000; // 1KHz sample rate
@@ -52,26 +72,85 @@ AD6 P0.3    0-GPIO,     1-RXD0, 2-AD0[6], 3-                6,7 bits of PINSEL0
 AD7 P0.2    0-GPIO,     1-TXD0, 2-AD0[7], 3-                4,5 bits of PINSEL0
 */
 
-// Enables ADC on a given pin
-void Adc::enable_pin(Pin *pin)
+// Enables ADC on a given pin, with the filter to use for its readings
+void Adc::enable_pin(Pin *pin, FILTER_TYPE filter)
 {
     PinName pin_name = this->_pin_to_pinname(pin);
     int channel = adc->_pin_to_channel(pin_name);
     memset(sample_buffers[channel], 0, sizeof(sample_buffers[0]));
 
+    filters[channel] = filter;
+    if(filter == FILTER_MEDIAN && sorted_buffers[channel] == nullptr) {
+        sorted_buffers[channel] = new uint16_t[num_samples];
+    }
+    if(sorted_buffers[channel] != nullptr) {
+        // the same zeros as the sample buffer, in order
+        memset(sorted_buffers[channel], 0, sizeof(sample_buffers[0]));
+    }
+    iir_rejects[channel] = 0xFF;
+
     this->adc->burst(1);
     this->adc->setup(pin_name, 1);
     this->adc->interrupt_state(pin_name, 1);
 }
 
-// Keeps the last 8 values for each channel
+Adc::FILTER_TYPE Adc::filter_from_string(const std::string &name)
+{
+    if(name == "median") return FILTER_MEDIAN;
+    if(name == "iir") return FILTER_IIR;
+    return FILTER_SORTED;
+}
+
+// replaces one copy of old in the sorted buffer s with v, moving the ones between along so it stays sorted
+static void replace_sorted(uint16_t *s, int n, uint16_t old, uint16_t v)
+{
+    int i = std::lower_bound(s, s + n, old) - s;
+    while(i > 0 && s[i - 1] > v) {
+        s[i] = s[i - 1];
+        --i;
+    }
+    while(i < n - 1 && s[i + 1] < v) {
+        s[i] = s[i + 1];
+        ++i;
+    }
+    s[i] = v;
+}
+
+// Keeps the last num_samples values for each channel, and updates the filter of the channels that filter as they go
 // This is called in an ISR, so sample_buffers needs to be accessed atomically
 void Adc::new_sample(int chan, uint32_t value)
 {
     // Shuffle down and add new value to the end
     if(chan < num_channels) {
+        uint16_t v = (value >> 4) & 0xFFF; // the 12 bit ADC reading
+        if(sorted_buffers[chan] != nullptr) {
+            // the oldest one is about to be dropped from the window
+            replace_sorted(sorted_buffers[chan], num_samples, sample_buffers[chan][0], v);
+        }
         memmove(&sample_buffers[chan][0], &sample_buffers[chan][1], sizeof(sample_buffers[0]) - sizeof(sample_buffers[0][0]));
-        sample_buffers[chan][num_samples - 1] = (value >> 4) & 0xFFF; // the 12 bit ADC reading
+        sample_buffers[chan][num_samples - 1] = v;
+
+        if(filters[chan] == FILTER_IIR) {
+            int32_t x = (int32_t)v << (READ_SHIFT + 8);
+            if(iir_rejects[chan] == 0xFF) {
+                // the first sample
+                iir_values[chan] = x;
+                iir_rejects[chan] = 0;
+                return;
+            }
+
+            int32_t d = x - iir_values[chan];
+            const int32_t spike = IIR_SPIKE << (READ_SHIFT + 8);
+            if(d > spike || d < -spike) {
+                if(++iir_rejects[chan] < IIR_MAX_REJECTS) return;
+                iir_values[chan] = x;
+                iir_rejects[chan] = 0;
+                return;
+            }
+
+            iir_rejects[chan] = 0;
+            iir_values[chan] += d >> IIR_SHIFT;
+        }
     }
 }
 
@@ -82,6 +161,21 @@ unsigned int Adc::read(Pin *pin)
     PinName p = this->_pin_to_pinname(pin);
     int channel = adc->_pin_to_channel(p);
 
+    if(filters[channel] == FILTER_IIR) {
+        // a single word so it is read atomically
+        return (iir_values[channel] + 128) >> 8;
+
+    } else if(filters[channel] == FILTER_MEDIAN) {
+        // the middle 4^OVERSAMPLE of the window added up is the oversampled reading, the middle one if not oversampling
+        const int n = 1 << (2 * READ_SHIFT);
+        const uint16_t *s = &sorted_buffers[channel][(num_samples - n) / 2];
+        uint32_t sum = 0;
+        __disable_irq();
+        for (int i = 0; i < n; ++i) sum += s[i];
+        __enable_irq();
+        return sum >> READ_SHIFT;
+    }
+
     uint16_t median_buffer[num_samples];
     // needs atomic access TODO maybe be able to use std::atomic here or some lockless mutex
     __disable_irq();
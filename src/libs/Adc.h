@@ -13,6 +13,7 @@
 #include "PinNames.h" // mbed.h lib
 
 #include <cmath>
+#include <string>
 
 class Pin;
 namespace mbed {
@@ -26,9 +27,16 @@ namespace mbed {
 class Adc
 {
 public:
+    // how the samples of a pin are filtered
+    //   SORTED sorts the window on every read and averages the middle half of it
+    //   MEDIAN keeps the window sorted as each sample comes in, a read averages the middle few of it
+    //   IIR is a first order low pass that ignores single spikes, a read just returns it
+    enum FILTER_TYPE { FILTER_SORTED, FILTER_MEDIAN, FILTER_IIR };
+
     Adc();
-    void enable_pin(Pin *pin);
+    void enable_pin(Pin *pin, FILTER_TYPE filter= FILTER_SORTED);
     unsigned int read(Pin *pin);
+    static FILTER_TYPE filter_from_string(const std::string &name);
 
     static Adc *instance;
     void new_sample(int chan, uint32_t value);
@@ -52,6 +60,15 @@ private:
 #endif
     // buffers storing the last num_samples readings for each channel
     uint16_t sample_buffers[num_channels][num_samples];
+    uint8_t filters[num_channels];
+
+    // FILTER_MEDIAN, the same readings in order, only allocated for the channels that use it
+    uint16_t *sorted_buffers[num_channels];
+
+    // FILTER_IIR, the filtered reading in the read() scale with 8 bits of fraction, and how many samples in a row
+    // have been rejected as spikes, the first sample after enable_pin() starts the filter off
+    int32_t iir_values[num_channels];
+    uint8_t iir_rejects[num_channels];
 };
 
 #endif
@@ -9,6 +9,10 @@
 #include "ff.h"
 #include "FATFileSystem.h"
 
+// the cluster link map starts with room for 15 fragments, and may grow to 127 if the file is that fragmented
+#define LINKMAP_SIZE 32
+#define LINKMAP_MAX_SIZE 256
+
 namespace mbed {
 
 #if FFSDEBUG_ENABLED
@@ -37,6 +41,9 @@ FATFileHandle::FATFileHandle(FIL_t fh) {
 int FATFileHandle::close() {
     FFSDEBUG("close\n");
     int retval = f_close(&_fh);
+#if _USE_FASTSEEK
+    delete [] _fh.cltbl;
+#endif
     delete this;
     return retval;
 }
@@ -74,6 +81,13 @@ off_t FATFileHandle::lseek(off_t position, int whence) {
     } else if(whence==SEEK_CUR) {
         position += _fh.fptr;
     }
+#if _USE_FASTSEEK
+    // a normal seek follows the cluster chain from the start of the file in the FAT, so on a file opened for reading
+    // the first seek past the start builds a map of the chain instead and every seek after that goes straight there
+    if(_fh.cltbl == NULL && position > 0 && !(_fh.flag & FA_WRITE)) {
+        create_link_map();
+    }
+#endif
     FRESULT res = f_lseek(&_fh, position);
     if(res) {
         FFSDEBUG("lseek failed (%d, %s)\n", res, FR_ERRORS[res]);
@@ -84,6 +98,28 @@ off_t FATFileHandle::lseek(off_t position, int whence) {
     }
 }
         
+#if _USE_FASTSEEK
+void FATFileHandle::create_link_map() {
+    DWORD size = LINKMAP_SIZE;
+    while(true) {
+        _fh.cltbl = new DWORD[size];
+        _fh.cltbl[0] = size;
+        FRESULT res = f_lseek(&_fh, CREATE_LINKMAP);
+        if(res == FR_OK) return;
+
+        // the first entry is how big it needs to be when it was not big enough
+        DWORD needed = _fh.cltbl[0];
+        delete [] _fh.cltbl;
+        _fh.cltbl = NULL;
+        if(res != FR_NOT_ENOUGH_CORE || needed > LINKMAP_MAX_SIZE) {
+            FFSDEBUG("create_link_map failed (%d), using normal seeks\n", res);
+            return;
+        }
+        size = needed;
+    }
+}
+#endif
+
 int FATFileHandle::fsync() {
     FFSDEBUG("fsync()\n");
     FRESULT res = f_sync(&_fh);
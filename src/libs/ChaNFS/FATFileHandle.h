@@ -23,6 +23,9 @@ public:
     virtual off_t flen();
 
 protected:
+#if _USE_FASTSEEK
+    void create_link_map();
+#endif
 
     FIL_t _fh;
 
@@ -44,8 +44,10 @@ Config::Config()
         fcs = new FileConfigSource("/sd/config", "sd");
     else if( file_exists("/sd/config.txt") )
         fcs = new FileConfigSource("/sd/config.txt", "sd");
-    if( fcs != NULL )
+    if( fcs != NULL ) {
         this->config_sources.push_back( fcs );
+        this->compiled_file = "/sd/config.bin";
+    }
 }
 
 Config::Config(ConfigSource *cs)
@@ -75,12 +77,76 @@ void Config::config_cache_load(bool parse)
     this->config_cache_clear();
 
     this->config_cache= new ConfigCache;
-    if(parse) {
-        // For each ConfigSource in our stack
-        for( ConfigSource *source : this->config_sources ) {
-            source->transfer_values_to_cache(this->config_cache);
+    if(!parse) return;
+
+    if(this->compiled_file.empty()) {
+        parse_sources();
+        return;
+    }
+
+    // use the compiled config if it was compiled from exactly what the sources hold now
+    uint32_t stamp = get_stamp();
+    if(stamp != 0) {
+        FILE *fp = fopen(this->compiled_file.c_str(), "r");
+        if(fp != NULL) {
+            bool ok = this->config_cache->load(fp, stamp);
+            fclose(fp);
+            if(ok) return;
         }
     }
+
+    parse_sources();
+
+    // the sources may not have been compilable until they were parsed, eg a file that includes another
+    stamp = get_stamp();
+    if(stamp != 0 && !save_compiled(stamp)) {
+        printf("WARNING: could not save the compiled config to %s\n", this->compiled_file.c_str());
+    }
+}
+
+void Config::parse_sources()
+{
+    // For each ConfigSource in our stack
+    for( ConfigSource *source : this->config_sources ) {
+        source->transfer_values_to_cache(this->config_cache);
+    }
+}
+
+// combined stamps of all the sources, 0 if any of them can not be compiled
+uint32_t Config::get_stamp()
+{
+    uint32_t stamp = ConfigSource::hash(nullptr, 0);
+    for( ConfigSource *source : this->config_sources ) {
+        uint32_t s = source->get_stamp();
+        if(s == 0) return 0;
+        stamp = ConfigSource::hash(&s, sizeof(s), stamp);
+    }
+    return stamp == 0 ? 1 : stamp;
+}
+
+bool Config::save_compiled(uint32_t stamp)
+{
+    FILE *fp = fopen(this->compiled_file.c_str(), "w");
+    if(fp == NULL) return false;
+    bool ok = this->config_cache->save(fp, stamp);
+    fclose(fp);
+    if(!ok) remove(this->compiled_file.c_str()); // do not leave a partial one around
+    return ok;
+}
+
+// parse the sources even if there is a valid compiled config and save it again
+int Config::config_compile()
+{
+    if(this->compiled_file.empty()) return -1;
+
+    this->config_cache_clear();
+    this->config_cache= new ConfigCache;
+    parse_sources();
+
+    uint32_t stamp = get_stamp();
+    int n = (stamp != 0 && save_compiled(stamp)) ? this->config_cache->size() : -1;
+    this->config_cache_clear();
+    return n;
 }
 
 // Command to clear the config cache after init
@@ -25,6 +25,8 @@ class Config  {
 
         void config_cache_load(bool parse= true);
         void config_cache_clear();
+        // parse the config files and save the compiled config, returns the number of values or -1 if it could not
+        int config_compile();
         void set_string( string setting , string value);
 
         ConfigValue* value(uint16_t check_sum_a, uint16_t check_sum_b= 0, uint16_t check_sum_c= 0 );
@@ -37,6 +39,11 @@ class Config  {
 
     private:
         bool   has_characters(uint16_t check_sum, string str );
+        uint32_t get_stamp();
+        void parse_sources();
+        bool save_compiled(uint32_t stamp);
+
+        string compiled_file;                 // where the compiled config is kept, empty if it is not used
 
         ConfigCache* config_cache;            // A cache in which ConfigValues are kept
         vector<ConfigSource*> config_sources; // A list of all possible coniguration sources
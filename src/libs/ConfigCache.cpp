@@ -1,8 +1,12 @@
 #include "ConfigCache.h"
 #include "ConfigValue.h"
+#include "ConfigSource.h"
 
 #include "libs/StreamOutput.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 ConfigCache::ConfigCache()
 {
 }
@@ -19,15 +23,52 @@ void ConfigCache::clear()
     }
     store.clear();
     storage_t().swap(store);   //  makes sure the vector releases its memory
+    index.clear();
+    vector<uint16_t>().swap(index);
 }
 
-void ConfigCache::add(ConfigValue *v)
+// the three check sums as one key, so entries sort by family then instance then setting
+static inline uint64_t key_of(const uint16_t *check_sums)
+{
+    return ((uint64_t)check_sums[0] << 32) | ((uint32_t)check_sums[1] << 16) | check_sums[2];
+}
+
+size_t ConfigCache::lower_bound(const uint16_t *check_sums) const
 {
+    uint64_t key = key_of(check_sums);
+    size_t lo = 0, hi = index.size();
+    while(lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if(key_of(store[index[mid]]->check_sums) < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// add to the end of the store and keep the index sorted, a duplicate goes after the existing ones
+void ConfigCache::insert(ConfigValue *v)
+{
+    size_t pos = lower_bound(v->check_sums);
+    while(pos < index.size() && key_of(store[index[pos]]->check_sums) == key_of(v->check_sums)) ++pos;
+    index.insert(index.begin() + pos, store.size());
     store.push_back(v);
 }
 
+void ConfigCache::add(ConfigValue *v)
+{
+    insert(v);
+}
+
 void ConfigCache::pop()
 {
+    uint16_t last = store.size() - 1;
+    for (auto i = index.begin(); i != index.end(); ++i) {
+        if(*i == last) {
+            index.erase(i);
+            break;
+        }
+    }
+
     auto cv= store.back();
     store.pop_back();
     delete cv;
@@ -36,8 +77,9 @@ void ConfigCache::pop()
 // If we find an existing value, replace it, otherwise, push it at the back of the list
 void ConfigCache::replace_or_push_back(ConfigValue *new_value)
 {
-    // For each already existing element
-    for(auto &cv : store) {
+    size_t pos = lower_bound(new_value->check_sums);
+    if(pos < index.size()) {
+        ConfigValue *&cv = store[index[pos]];
         // If this configvalue matches the checksum
         if(memcmp(new_value->check_sums, cv->check_sums, sizeof(cv->check_sums)) == 0) {
             // Replace with the provided value
@@ -49,12 +91,14 @@ void ConfigCache::replace_or_push_back(ConfigValue *new_value)
     }
 
     // Value does not already exists, add to the list
-    store.push_back(new_value);
+    insert(new_value);
 }
 
 ConfigValue *ConfigCache::lookup(const uint16_t *check_sums) const
 {
-    for( auto &cv : store) {
+    size_t pos = lower_bound(check_sums);
+    if(pos < index.size()) {
+        ConfigValue *cv = store[index[pos]];
         if(memcmp(check_sums, cv->check_sums, sizeof(cv->check_sums)) == 0)
             return cv;
     }
@@ -81,3 +125,95 @@ void ConfigCache::dump(StreamOutput *stream)
                        l++, v->check_sums[0], v->check_sums[1], v->check_sums[2], v->value.c_str(), v->found, v->default_set, v->default_double, v->default_int );
     }
 }
+
+#define COMPILED_MAGIC "SCC1"
+#define COMPILED_MAX_SIZE (32*1024)
+
+struct compiled_header_t {
+    char magic[4];
+    uint32_t stamp;     // of the sources it was compiled from
+    uint32_t count;     // number of entries
+    uint32_t size;      // bytes of entries after the header
+    uint32_t hash;      // of the entries
+};
+
+// each entry is the three check sums, the length of the value and the value without a terminator
+#define COMPILED_ENTRY_SIZE (3 * sizeof(uint16_t) + 1)
+
+bool ConfigCache::save(FILE *fp, uint32_t stamp) const
+{
+    compiled_header_t hdr;
+    memcpy(hdr.magic, COMPILED_MAGIC, sizeof(hdr.magic));
+    hdr.stamp = stamp;
+    hdr.count = store.size();
+    hdr.size = 0;
+    hdr.hash = ConfigSource::hash(nullptr, 0);
+
+    // first pass to get the size and hash so the header can go first
+    for( auto &kv : store ) {
+        if(kv->value.size() > 255) return false;
+        uint8_t len = kv->value.size();
+        hdr.hash = ConfigSource::hash(kv->check_sums, sizeof(kv->check_sums), hdr.hash);
+        hdr.hash = ConfigSource::hash(&len, 1, hdr.hash);
+        hdr.hash = ConfigSource::hash(kv->value.data(), len, hdr.hash);
+        hdr.size += COMPILED_ENTRY_SIZE + len;
+    }
+    if(hdr.size > COMPILED_MAX_SIZE) return false;
+
+    if(fwrite(&hdr, sizeof(hdr), 1, fp) != 1) return false;
+    for( auto &kv : store ) {
+        uint8_t len = kv->value.size();
+        if(fwrite(kv->check_sums, sizeof(kv->check_sums), 1, fp) != 1 ||
+           fwrite(&len, 1, 1, fp) != 1 ||
+           fwrite(kv->value.data(), 1, len, fp) != len) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ConfigCache::load(FILE *fp, uint32_t stamp)
+{
+    compiled_header_t hdr;
+    if(fread(&hdr, sizeof(hdr), 1, fp) != 1 || memcmp(hdr.magic, COMPILED_MAGIC, sizeof(hdr.magic)) != 0 ||
+       hdr.stamp != stamp || hdr.size > COMPILED_MAX_SIZE) {
+        return false;
+    }
+
+    // the entries are read with one read, then checked before any of them are used
+    char *buf = (char *)malloc(hdr.size);
+    if(buf == nullptr) return false;
+    bool ok = fread(buf, 1, hdr.size, fp) == hdr.size && ConfigSource::hash(buf, hdr.size) == hdr.hash;
+
+    store.reserve(hdr.count);
+    index.reserve(hdr.count);
+    const char *p = buf, *end = buf + hdr.size;
+    for (uint32_t i = 0; ok && i < hdr.count; ++i) {
+        if(end - p < (ptrdiff_t)COMPILED_ENTRY_SIZE) {
+            ok = false;
+            break;
+        }
+        uint16_t check_sums[3];
+        memcpy(check_sums, p, sizeof(check_sums));
+        uint8_t len = p[sizeof(check_sums)];
+        p += COMPILED_ENTRY_SIZE;
+        if(end - p < len) {
+            ok = false;
+            break;
+        }
+
+        ConfigValue *cv = new ConfigValue(check_sums);
+        cv->found = true;
+        cv->value.assign(p, len);
+        p += len;
+        insert(cv);
+    }
+    free(buf);
+
+    if(!ok || p != end) {
+        clear();
+        return false;
+    }
+    return true;
+}
@@ -11,6 +11,7 @@
 using namespace std;
 #include <vector>
 #include <stdint.h>
+#include <stdio.h>
 #include <map>
 
 class ConfigValue;
@@ -37,9 +38,20 @@ class ConfigCache {
         // used for debugging, dumps the cache to a stream
         void dump(StreamOutput *stream);
 
+        // the compiled config, a header then the check sums and value of each entry in the order they were added
+        // stamp identifies the sources it was compiled from, load fails if it does not match
+        bool save(FILE *fp, uint32_t stamp) const;
+        bool load(FILE *fp, uint32_t stamp);
+        size_t size() const { return store.size(); }
+
     private:
         typedef vector<ConfigValue*> storage_t;
-        storage_t store;
+        // position in index of the first entry not less than check_sums
+        size_t lower_bound(const uint16_t *check_sums) const;
+        void insert(ConfigValue *v);
+
+        storage_t store;            // in the order they were added, get_module_list relies on this
+        vector<uint16_t> index;     // positions in store sorted by the check sums, so lookups are a binary search
 };
 
 
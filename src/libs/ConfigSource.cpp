@@ -59,6 +59,16 @@ ConfigValue* ConfigSource::process_line_from_ascii_config(const string &buffer,
     return NULL;
 }
 
+uint32_t ConfigSource::hash(const void *buf, size_t len, uint32_t h)
+{
+    const uint8_t *p = (const uint8_t *)buf;
+    while(len-- > 0) {
+        h ^= *p++;
+        h *= 16777619UL;
+    }
+    return h;
+}
+
 string ConfigSource::process_line_from_ascii_config(const string &buffer, uint16_t line_checksums[3])
 {
     string value= "";
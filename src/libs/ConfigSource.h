@@ -9,6 +9,8 @@
 #define CONFIGSOURCE_H
 
 #include <string>
+#include <stdint.h>
+#include <stddef.h>
 
 class ConfigValue;
 class ConfigCache;
@@ -24,6 +26,12 @@ class ConfigSource {
         virtual bool write( std::string setting, std::string value ) = 0;
         virtual std::string read( uint16_t check_sums[3] ) = 0;
 
+        // a hash of everything transfer_values_to_cache would read, 0 if the values can not be compiled
+        virtual uint32_t get_stamp() { return 0; }
+
+        // FNV-1a, pass the previous result as h to continue a hash
+        static uint32_t hash(const void *buf, size_t len, uint32_t h= 2166136261UL);
+
     protected:
         virtual ConfigValue* process_line_from_ascii_config(const std::string& line, ConfigCache* cache);
         virtual std::string process_line_from_ascii_config(const std::string& line, uint16_t line_checksums[3]);
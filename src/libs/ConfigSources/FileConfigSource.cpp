@@ -24,6 +24,7 @@ FileConfigSource::FileConfigSource(string config_file, const char *name)
     this->name_checksum = get_checksum(name);
     this->config_file = config_file;
     this->config_file_found = false;
+    this->include_found = false;
 }
 
 bool FileConfigSource::readLine(string& line, int lineno, FILE *fp)
@@ -55,6 +56,7 @@ void FileConfigSource::transfer_values_to_cache( ConfigCache *cache )
     if( !this->has_config_file() ) {
         return;
     }
+    this->include_found = false;
     transfer_values_to_cache( cache, this->get_config_file().c_str());
 }
 
@@ -79,6 +81,7 @@ void FileConfigSource::transfer_values_to_cache( ConfigCache *cache, const char
 
             // if this line is an include directive then attempt to read the included file
             if(cv->check_sums[0] == include_checksum) {
+                this->include_found = true;
                 string inc_file_name = cv->value.c_str();
                 cache->pop(); // we do not need to keep this around or leave it on the list
 
@@ -120,6 +123,27 @@ void FileConfigSource::transfer_values_to_cache( ConfigCache *cache, const char
     fclose(lp);
 }
 
+// hash the raw contents, reading the file a block at a time is much quicker than parsing it
+uint32_t FileConfigSource::get_stamp()
+{
+    if( this->include_found || !this->has_config_file() ) {
+        return 0;
+    }
+
+    FILE *lp = fopen(this->config_file.c_str(), "r");
+    if(lp == NULL) return 0;
+
+    char buf[512];
+    uint32_t h = hash(nullptr, 0);
+    size_t n;
+    while((n = fread(buf, 1, sizeof(buf), lp)) > 0) {
+        h = hash(buf, n, h);
+    }
+    fclose(lp);
+
+    return h == 0 ? 1 : h;
+}
+
 // Return true if the check_sums match
 bool FileConfigSource::is_named( uint16_t check_sum )
 {
@@ -0,0 +1,110 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "EventProfiler.h"
+#include "StreamOutput.h"
+#include "us_ticker_api.h"
+
+#ifdef SIMULATOR
+#include <chrono>
+#else
+#include "LPC17xx.h"
+#endif
+
+// in the same order as _EVENT_ENUM
+static const char *event_names[NUMBER_OF_DEFINED_EVENTS] = {
+    "main_loop",
+    "console_line_received",
+    "gcode_received",
+    "idle",
+    "second_tick",
+    "get_public_data",
+    "set_public_data",
+    "halt",
+    "enable"
+};
+
+EventProfiler::EventProfiler()
+{
+    start_counter();
+    start_us = now_us();
+}
+
+void EventProfiler::start_counter()
+{
+#ifndef SIMULATOR
+    // the cycle counter is not running unless a debugger started it
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+uint32_t EventProfiler::ticks_per_us()
+{
+#ifdef SIMULATOR
+    return 1000;
+#else
+    return SystemCoreClock / 1000000;
+#endif
+}
+
+uint32_t EventProfiler::now()
+{
+#ifdef SIMULATOR
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+    return DWT->CYCCNT;
+#endif
+}
+
+uint32_t EventProfiler::now_us()
+{
+#ifdef SIMULATOR
+    // us_ticker_read() is the simulated time in the simulator
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+    return us_ticker_read();
+#endif
+}
+
+void EventProfiler::record(_EVENT_ENUM id_event, size_t i, uint32_t ticks)
+{
+    std::vector<stats_t>& v = stats[id_event];
+    if(i >= v.size()) v.resize(i + 1, stats_t{0, 0, 0});
+
+    stats_t& s = v[i];
+    ++s.count;
+    s.total += ticks;
+    if(ticks > s.max) s.max = ticks;
+}
+
+void EventProfiler::reset()
+{
+    for (auto& v : stats) {
+        v.clear();
+    }
+    start_us = now_us();
+}
+
+void EventProfiler::report(StreamOutput *stream, const std::array<std::vector<Module*>, NUMBER_OF_DEFINED_EVENTS>& hooks) const
+{
+    stream->printf("event profile over %lu ms\n", (unsigned long)((now_us() - start_us) / 1000));
+    stream->printf("%-22s %-24s %10s %10s %9s %9s\n", "event", "module", "calls", "total ms", "avg us", "max us");
+    for (int e = 0; e < NUMBER_OF_DEFINED_EVENTS; ++e) {
+        const std::vector<stats_t>& v = stats[e];
+        for (size_t i = 0; i < v.size(); ++i) {
+            const stats_t& s = v[i];
+            if(s.count == 0) continue;
+
+            char buf[24];
+            const char *name = i < hooks[e].size() ? hooks[e][i]->get_module_label(buf, sizeof(buf)) : "?";
+            float total_us = (float)s.total / ticks_per_us();
+            stream->printf("%-22s %-24s %10lu %10.1f %9.1f %9.1f\n", event_names[e], name,
+                           (unsigned long)s.count, total_us / 1000, total_us / s.count, (float)s.max / ticks_per_us());
+        }
+    }
+}
@@ -0,0 +1,48 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Module.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <vector>
+
+class StreamOutput;
+
+// Records the number of calls, total and longest time each module takes to handle each event, so we can see which
+// module is holding up the main loop. Kernel::call_event uses it while Kernel::event_profiler is set.
+// Time is counted in cycles of the DWT cycle counter on the target, and nanoseconds of the monotonic clock on the host.
+// now_us() is the same clock in microseconds, it is used for the span of the profile and the boot profile so the
+// simulator does not report host time against simulated time.
+// A call that calls another event includes the time taken by that event.
+class EventProfiler {
+    public:
+        EventProfiler();
+
+        static uint32_t now();
+        // starts the cycle counter on the target, now() is not valid until this has been called
+        static void start_counter();
+        static uint32_t ticks_per_us();
+        static uint32_t now_us();
+        // i is the position of the module in the hooks for the event
+        void record(_EVENT_ENUM id_event, size_t i, uint32_t ticks);
+        void reset();
+        void report(StreamOutput *stream, const std::array<std::vector<Module*>, NUMBER_OF_DEFINED_EVENTS>& hooks) const;
+
+    private:
+        struct stats_t {
+            uint32_t count;
+            uint32_t max;
+            uint64_t total;
+        };
+
+        std::array<std::vector<stats_t>, NUMBER_OF_DEFINED_EVENTS> stats;
+        uint32_t start_us;
+};
@@ -0,0 +1,339 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Inflater.h"
+
+#include <string.h>
+
+// the decoder follows the structure of puff.c by Mark Adler, but decodes incrementally into a small window
+
+#define MAXBITS 15 // maximum bits in a code
+#define MAXLCODES 286 // maximum number of literal/length codes
+#define MAXDCODES 30 // maximum number of distance codes
+#define FIXLCODES 288 // number of fixed literal/length codes
+
+static const uint16_t length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+};
+static const uint8_t dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+Inflater::Inflater(FILE *fp, uint8_t window_bits)
+{
+    this->fp = fp;
+    this->window = new uint8_t[1 << window_bits];
+    this->wmask = (1 << window_bits) - 1;
+    this->wpos = 0;
+    this->in_pos = this->in_end = 0;
+    this->bytes_read = INFLATER_HEADER_SIZE;
+    this->bitbuf = 0;
+    this->bitcnt = 0;
+    this->stored_len = 0;
+    this->copy_len = 0;
+    this->copy_dist = 0;
+    this->state = HEADER;
+    this->last_block = false;
+}
+
+Inflater::~Inflater()
+{
+    delete [] window;
+}
+
+Inflater *Inflater::open(FILE *fp)
+{
+    long pos = ftell(fp);
+    uint8_t hdr[INFLATER_HEADER_SIZE];
+    if(fread(hdr, 1, sizeof(hdr), fp) == sizeof(hdr) && memcmp(hdr, INFLATER_MAGIC, 3) == 0 &&
+       hdr[3] >= 8 && hdr[3] <= INFLATER_MAX_WINDOW_BITS) {
+        return new Inflater(fp, hdr[3]);
+    }
+
+    // not compressed, or a window too big for us to handle
+    fseek(fp, pos, SEEK_SET);
+    return nullptr;
+}
+
+int Inflater::next_byte()
+{
+    if(in_pos >= in_end) {
+        // read the file a whole buffer at a time, much faster than a byte at a time from the SD card
+        size_t n = fread(inbuf, 1, sizeof(inbuf), fp);
+        if(n == 0) return -1;
+        in_pos = 0;
+        in_end = n;
+        bytes_read += n;
+    }
+    return inbuf[in_pos++];
+}
+
+bool Inflater::need_bits(uint8_t n)
+{
+    while(bitcnt < n) {
+        int c = next_byte();
+        if(c < 0) {
+            state = ERROR; // ran out of input in the middle of the stream
+            return false;
+        }
+        bitbuf |= (uint32_t)c << bitcnt;
+        bitcnt += 8;
+    }
+    return true;
+}
+
+// return n bits from the input, lsb first as deflate packs them, 0 on error with the state set to ERROR
+uint32_t Inflater::bits(uint8_t n)
+{
+    if(n == 0 || !need_bits(n)) return 0;
+    uint32_t v = bitbuf & ((1UL << n) - 1);
+    bitbuf >>= n;
+    bitcnt -= n;
+    return v;
+}
+
+// decode one symbol using the canonical code, codes are read a bit at a time msb first
+int Inflater::decode(const Huffman &h)
+{
+    int code = 0, first = 0, index = 0;
+    for (int len = 1; len <= MAXBITS; len++) {
+        code |= bits(1);
+        if(state == ERROR) return -1;
+        int count = h.count[len];
+        if(code - count < first) return h.symbol[index + (code - first)];
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -1; // ran out of codes
+}
+
+// build the count and symbol tables from the code lengths, returns < 0 if the code is over subscribed
+int Inflater::construct(Huffman &h, const uint8_t *length, int n)
+{
+    uint16_t offs[MAXBITS + 1];
+
+    memset(h.count, 0, sizeof(uint16_t) * (MAXBITS + 1));
+    for (int i = 0; i < n; i++) h.count[length[i]]++;
+    if(h.count[0] == n) return 0; // no codes, complete but decoding will fail
+
+    int left = 1;
+    for (int len = 1; len <= MAXBITS; len++) {
+        left <<= 1;
+        left -= h.count[len];
+        if(left < 0) return left;
+    }
+
+    offs[1] = 0;
+    for (int len = 1; len < MAXBITS; len++) offs[len + 1] = offs[len] + h.count[len];
+    for (int i = 0; i < n; i++) {
+        if(length[i] != 0) h.symbol[offs[length[i]]++] = i;
+    }
+
+    return left;
+}
+
+void Inflater::fixed_tables()
+{
+    uint8_t lengths[FIXLCODES];
+    int i;
+    for (i = 0; i < 144; i++) lengths[i] = 8;
+    for (; i < 256; i++) lengths[i] = 9;
+    for (; i < 280; i++) lengths[i] = 7;
+    for (; i < FIXLCODES; i++) lengths[i] = 8;
+    construct(lencode, lengths, FIXLCODES);
+
+    for (i = 0; i < MAXDCODES; i++) lengths[i] = 5;
+    construct(distcode, lengths, MAXDCODES);
+}
+
+bool Inflater::dynamic_tables()
+{
+    static const uint8_t order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+    uint8_t lengths[MAXLCODES + MAXDCODES];
+
+    int nlen = bits(5) + 257;
+    int ndist = bits(5) + 1;
+    int ncode = bits(4) + 4;
+    if(state == ERROR || nlen > MAXLCODES || ndist > MAXDCODES) return false;
+
+    // the code length code lengths, these are decoded with the length tables which are about to be replaced anyway
+    int index;
+    for (index = 0; index < ncode; index++) lengths[order[index]] = bits(3);
+    for (; index < 19; index++) lengths[order[index]] = 0;
+    if(state == ERROR || construct(lencode, lengths, 19) != 0) return false; // must be complete
+
+    index = 0;
+    while (index < nlen + ndist) {
+        int symbol = decode(lencode);
+        if(symbol < 0) return false;
+        if(symbol < 16) {
+            lengths[index++] = symbol;
+            continue;
+        }
+
+        uint8_t len = 0; // repeated length
+        if(symbol == 16) {
+            if(index == 0) return false; // no last length
+            len = lengths[index - 1];
+            symbol = 3 + bits(2);
+        } else if(symbol == 17) {
+            symbol = 3 + bits(3);
+        } else {
+            symbol = 11 + bits(7);
+        }
+        if(state == ERROR || index + symbol > nlen + ndist) return false;
+        while (symbol--) lengths[index++] = len;
+    }
+
+    if(lengths[256] == 0) return false; // no end of block code
+
+    // incomplete codes are only allowed if there is a single code
+    int err = construct(lencode, lengths, nlen);
+    if(err < 0 || (err > 0 && nlen - lencode.count[0] != 1)) return false;
+    err = construct(distcode, lengths + nlen, ndist);
+    if(err < 0 || (err > 0 && ndist - distcode.count[0] != 1)) return false;
+
+    return true;
+}
+
+bool Inflater::block_header()
+{
+    last_block = bits(1);
+    uint32_t type = bits(2);
+    if(state == ERROR) return false;
+
+    switch(type) {
+        case 0: {
+            // stored block, skip to a byte boundary then read the length and its complement
+            bitbuf = 0;
+            bitcnt = 0;
+            uint32_t len = bits(16);
+            uint32_t nlen = bits(16);
+            if(state == ERROR || len != (~nlen & 0xFFFF)) return false;
+            stored_len = len;
+            state = STORED;
+            return true;
+        }
+        case 1:
+            fixed_tables();
+            state = CODES;
+            return true;
+        case 2:
+            if(!dynamic_tables()) return false;
+            state = CODES;
+            return true;
+    }
+
+    return false;
+}
+
+// return the next decompressed byte or -1 at the end of the stream
+int Inflater::getc()
+{
+    while(true) {
+        if(copy_len > 0) {
+            uint8_t c = window[(wpos - copy_dist) & wmask];
+            put(c);
+            --copy_len;
+            return c;
+        }
+
+        switch(state) {
+            case HEADER:
+                if(last_block) {
+                    state = DONE;
+                } else if(!block_header()) {
+                    state = ERROR;
+                }
+                break;
+
+            case STORED: {
+                if(stored_len == 0) {
+                    state = HEADER;
+                    break;
+                }
+                int c = next_byte();
+                if(c < 0) {
+                    state = ERROR;
+                    break;
+                }
+                --stored_len;
+                put(c);
+                return c;
+            }
+
+            case CODES: {
+                int symbol = decode(lencode);
+                if(symbol < 0) {
+                    state = ERROR;
+                    break;
+                }
+                if(symbol < 256) {
+                    put(symbol);
+                    return symbol;
+                }
+                if(symbol == 256) {
+                    state = HEADER;
+                    break;
+                }
+
+                symbol -= 257;
+                if(symbol >= 29) {
+                    state = ERROR;
+                    break;
+                }
+                uint16_t len = length_base[symbol] + bits(length_extra[symbol]);
+                symbol = decode(distcode);
+                if(symbol < 0 || symbol >= 30) {
+                    state = ERROR;
+                    break;
+                }
+                uint32_t dist = dist_base[symbol] + bits(dist_extra[symbol]);
+                // the distance can neither go back before the start nor further than our window
+                if(state == ERROR || dist > wpos || dist > wmask + 1) {
+                    state = ERROR;
+                    break;
+                }
+                copy_len = len;
+                copy_dist = dist;
+                break;
+            }
+
+            case DONE:
+            case ERROR:
+                return -1;
+        }
+    }
+}
+
+char *Inflater::gets(char *buf, int size)
+{
+    int n = 0;
+    while(n < size - 1) {
+        int c = getc();
+        if(c < 0) break;
+        buf[n++] = c;
+        if(c == '\n') break;
+    }
+
+    if(n == 0) return nullptr;
+    buf[n] = '\0';
+    return buf;
+}
@@ -0,0 +1,78 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+// header of a compressed gcode file as written by gcode-compress.py
+// 'G' 'C' 'Z' followed by one byte with the deflate window bits, then a raw deflate stream (RFC 1951)
+#define INFLATER_MAGIC "GCZ"
+#define INFLATER_HEADER_SIZE 4
+#define INFLATER_MAX_WINDOW_BITS 12
+
+// Streaming decoder for raw deflate data read from a file.
+// Only a window of 2^window_bits bytes is kept so the encoder must use the same or a smaller window,
+// data is decoded a byte at a time as it is asked for so nothing bigger than a line is ever buffered.
+class Inflater {
+    public:
+        Inflater(FILE *fp, uint8_t window_bits);
+        ~Inflater();
+
+        // reads the header at the current position of fp, returns an Inflater if it is a compressed file
+        // otherwise rewinds the file to where it was and returns nullptr
+        static Inflater *open(FILE *fp);
+
+        // like fgets but reads decompressed data, returns nullptr at the end of the stream or on an error
+        char *gets(char *buf, int size);
+        int getc();
+
+        bool is_eof() const { return state == DONE; }
+        bool is_error() const { return state == ERROR; }
+        // number of compressed bytes used so far including the header, for progress reporting
+        unsigned long get_bytes_read() const { return bytes_read - (in_end - in_pos); }
+
+    private:
+        struct Huffman {
+            uint16_t *count;  // number of codes of each length
+            uint16_t *symbol; // symbols ordered by code
+        };
+
+        int next_byte();
+        bool need_bits(uint8_t n);
+        uint32_t bits(uint8_t n);
+        int decode(const Huffman &h);
+        static int construct(Huffman &h, const uint8_t *length, int n);
+        bool block_header();
+        bool dynamic_tables();
+        void fixed_tables();
+        void put(uint8_t c) { window[wpos++ & wmask] = c; }
+
+        FILE *fp;
+        uint8_t *window;
+        uint32_t wmask;
+        uint32_t wpos;              // total bytes output, only the low bits are used to index the window
+        uint8_t inbuf[512];
+        uint16_t in_pos, in_end;
+        unsigned long bytes_read;
+        uint32_t bitbuf;
+        uint8_t bitcnt;
+
+        uint16_t lencnt[16], lensym[288];
+        uint16_t distcnt[16], distsym[30];
+        Huffman lencode{lencnt, lensym};
+        Huffman distcode{distcnt, distsym};
+
+        uint32_t stored_len;        // bytes left in a stored block
+        uint16_t copy_len;          // bytes left to copy of the current match
+        uint16_t copy_dist;
+
+        enum STATE { HEADER, STORED, CODES, DONE, ERROR };
+        STATE state;
+        bool last_block;
+};
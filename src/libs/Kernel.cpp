@@ -40,6 +40,9 @@
 
 #include "platform_memory.h"
 
+#include "us_ticker_api.h"
+#include "EventProfiler.h"
+
 #include <malloc.h>
 #include <array>
 #include <string>
@@ -54,6 +57,7 @@
 #define grbl_mode_checksum                          CHECKSUM("grbl_mode")
 #define feed_hold_enable_checksum                   CHECKSUM("enable_feed_hold")
 #define ok_per_line_checksum                        CHECKSUM("ok_per_line")
+#define step_timing_enable_checksum                 CHECKSUM("step_timing_enable")
 
 Kernel* Kernel::instance;
 
@@ -69,6 +73,9 @@ Kernel::Kernel()
 
     instance = this; // setup the Singleton instance of the kernel
 
+    this->boot_profile = new std::vector<boot_step_t>;
+    this->event_profiler = nullptr;
+
     // serial first at fixed baud rate (DEFAULT_SERIAL_BAUD_RATE) so config can report errors to serial
     // Set to UART0, this will be changed to use the same UART as MRI if it's enabled
     this->serial = new SerialConsole(USBTX, USBRX, DEFAULT_SERIAL_BAUD_RATE);
@@ -77,7 +84,9 @@ Kernel::Kernel()
     this->config = new Config();
 
     // Pre-load the config cache, do after setting up serial so we can report errors to serial
+    uint32_t start_us = EventProfiler::now_us();
     this->config->config_cache_load();
+    this->boot_profile->push_back({"config cache load", nullptr, EventProfiler::now_us() - start_us});
 
     // now config is loaded we can do normal setup for serial based on config
     delete this->serial;
@@ -126,10 +135,10 @@ Kernel::Kernel()
     // we expect ok per line now not per G code, setting this to false will return to the old (incorrect) way of ok per G code
     this->ok_per_line = this->config->value( ok_per_line_checksum )->by_default(true)->as_bool();
 
-    this->add_module( this->serial );
+    this->add_module( this->serial, "SerialConsole" );
 
     // HAL stuff
-    add_module( this->slow_ticker = new SlowTicker());
+    add_module( this->slow_ticker = new SlowTicker(), "SlowTicker" );
 
     this->step_ticker = new StepTicker();
     this->adc = new Adc();
@@ -167,12 +176,13 @@ Kernel::Kernel()
     // Configure the step ticker
     this->step_ticker->set_frequency( this->base_stepping_frequency );
     this->step_ticker->set_unstep_time( microseconds_per_step_pulse );
+    this->step_ticker->set_timing( this->config->value(step_timing_enable_checksum)->by_default(false)->as_bool() );
 
     // Core modules
-    this->add_module( this->conveyor       = new Conveyor()      );
-    this->add_module( this->gcode_dispatch = new GcodeDispatch() );
-    this->add_module( this->robot          = new Robot()         );
-    this->add_module( this->simpleshell    = new SimpleShell()   );
+    this->add_module( this->conveyor       = new Conveyor(),      "Conveyor" );
+    this->add_module( this->gcode_dispatch = new GcodeDispatch(), "GcodeDispatch" );
+    this->add_module( this->robot          = new Robot(),         "Robot" );
+    this->add_module( this->simpleshell    = new SimpleShell(),   "SimpleShell" );
 
     this->planner = new Planner();
     this->configurator = new Configurator();
@@ -301,6 +311,11 @@ std::string Kernel::get_query_string()
 		str.append(buf, n);
 	}
 
+    // longest step interrupt in us, step ticks missed as the interrupt overran and times the moves were starved of blocks
+    n = snprintf(buf, sizeof(buf), "|ST:%lu,%lu,%lu", (unsigned long)step_ticker->get_max_step_us(), (unsigned long)step_ticker->get_missed_ticks(), (unsigned long)step_ticker->get_starved());
+    if(n > sizeof(buf)) n= sizeof(buf);
+    str.append(buf, n);
+
     // current running file info
     if (running) {
         void *returned_data;
@@ -334,9 +349,38 @@ std::string Kernel::get_query_string()
 }
 
 // Add a module to Kernel. We don't actually hold a list of modules we just call its on_module_loaded
-void Kernel::add_module(Module* module)
+void Kernel::add_module(Module* module, const char *name)
 {
+    module->set_module_name(name);
+    uint32_t start_us = EventProfiler::now_us();
     module->on_module_loaded();
+    if(boot_profile != nullptr) {
+        boot_profile->push_back({nullptr, module, EventProfiler::now_us() - start_us});
+    }
+}
+
+void Kernel::event_profile_report(StreamOutput *stream)
+{
+    if(this->event_profiler != nullptr) this->event_profiler->report(stream, hooks);
+}
+
+void Kernel::boot_profile_report(StreamOutput *stream)
+{
+    if(boot_profile == nullptr) return;
+
+    if(stream != nullptr) {
+        uint32_t total = 0;
+        stream->printf("Boot profile, ms spent loading each module:\n");
+        char buf[24];
+        for(auto &p : *boot_profile) {
+            stream->printf("%9.2f %s\n", p.us / 1000.0F, p.module != nullptr ? p.module->get_module_label(buf, sizeof(buf)) : p.name);
+            total += p.us;
+        }
+        stream->printf("%9.2f total, %lu ms since reset\n", total / 1000.0F, (unsigned long)(EventProfiler::now_us() / 1000));
+    }
+
+    delete boot_profile;
+    boot_profile = nullptr;
 }
 
 // Adds a hook for a given module and event
@@ -356,8 +400,19 @@ void Kernel::call_event(_EVENT_ENUM id_event, void * argument)
     }
 
     // send to all registered modules
-    for (auto m : hooks[id_event]) {
-        (m->*kernel_callback_functions[id_event])(argument);
+    if(this->event_profiler == nullptr) {
+        for (auto m : hooks[id_event]) {
+            (m->*kernel_callback_functions[id_event])(argument);
+        }
+
+    } else {
+        std::vector<Module*>& v = hooks[id_event];
+        for (size_t i = 0; i < v.size(); ++i) {
+            uint32_t start = EventProfiler::now();
+            (v[i]->*kernel_callback_functions[id_event])(argument);
+            // the profiler may have been turned off by the call
+            if(this->event_profiler != nullptr) this->event_profiler->record(id_event, i, EventProfiler::now() - start);
+        }
     }
 
     if(id_event == ON_HALT) {
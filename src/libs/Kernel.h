@@ -23,6 +23,7 @@ class Module;
 class Conveyor;
 class SlowTicker;
 class SerialConsole;
+class StreamOutput;
 class StreamOutputPool;
 class GcodeDispatch;
 class Robot;
@@ -32,6 +33,7 @@ class Adc;
 class PublicData;
 class SimpleShell;
 class Configurator;
+class EventProfiler;
 
 class Kernel {
     public:
@@ -39,7 +41,8 @@ class Kernel {
         static Kernel* instance; // the Singleton instance of Kernel usable anywhere
         const char* config_override_filename(){ return "/sd/config-override"; }
 
-        void add_module(Module* module);
+        // name is used in the boot and event profiles
+        void add_module(Module* module, const char *name= nullptr);
         void register_for_event(_EVENT_ENUM id_event, Module *module);
         void call_event(_EVENT_ENUM id_event, void * argument= nullptr);
 
@@ -65,6 +68,11 @@ class Kernel {
 
         std::string get_query_string();
 
+        // time spent in each on_module_loaded during boot, printed to stream if not null then freed
+        void boot_profile_report(StreamOutput *stream);
+        // time spent by each module handling each event, recorded while event_profiler is set
+        void event_profile_report(StreamOutput *stream);
+
         // These modules are available to all other modules
         SerialConsole*    serial;
         StreamOutputPool* streams;
@@ -79,12 +87,19 @@ class Kernel {
         SlowTicker*       slow_ticker;
         StepTicker*       step_ticker;
         Adc*              adc;
+        EventProfiler*    event_profiler;
         std::string       current_path;
         uint32_t          base_stepping_frequency;
 
     private:
         // When a module asks to be called for a specific event ( a hook ), this is where that request is remembered
         std::array<std::vector<Module*>, NUMBER_OF_DEFINED_EVENTS> hooks;
+        struct boot_step_t {
+            const char *name;                               // used when module is null
+            const Module *module;
+            uint32_t us;
+        };
+        std::vector<boot_step_t> *boot_profile;             // null once boot is done
         struct {
             bool use_leds:1;
             bool halted:1;
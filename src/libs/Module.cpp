@@ -8,7 +8,10 @@
 #include "libs/Module.h"
 #include "libs/Kernel.h"
 
-Module::Module(){}
+#include <stdint.h>
+#include <stdio.h>
+
+Module::Module() : module_name(nullptr) {}
 Module::~Module(){}
 
 // this is used to callback the specific method in the Module instance, there must be one for each _EVENT_ENUM and in the same order
@@ -32,3 +35,13 @@ void Module::register_for_event(_EVENT_ENUM event_id){
     // You add things to Smoothie by making a new class that inherits the Module class. See http://smoothieware.org/moduleexample for a crude introduction
     THEKERNEL->register_for_event(event_id, this);
 }
+
+// there is no RTTI to name the class, so a module without a name is labelled with its vtable pointer,
+// nm -C shows the class as "vtable for <class>" two pointers before it
+const char *Module::get_module_label(char *buf, size_t size) const
+{
+    if(module_name != nullptr) return module_name;
+
+    snprintf(buf, size, "vtable@%08lx", (unsigned long)*reinterpret_cast<const uintptr_t *>(this));
+    return buf;
+}
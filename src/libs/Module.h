@@ -8,6 +8,8 @@
 #ifndef MODULE_H
 #define MODULE_H
 
+#include <stddef.h>
+
 // See : http://smoothieware.org/listofevents
 // When adding a new event the virtual method needs to be defined in class Module and the method pointer need to be defined in
 // Module.cpp:16 in the same order
@@ -39,6 +41,12 @@ public:
 
     void register_for_event(_EVENT_ENUM event_id);
 
+    // the name given to Kernel::add_module, may be null
+    const char *get_module_name() const { return module_name; }
+    void set_module_name(const char *name) { module_name = name; }
+    // the name, or when there is none a label made in buf from the class, for reports
+    const char *get_module_label(char *buf, size_t size) const;
+
     // event callbacks, not every module will implement all of these
     // there should be one for each _EVENT_ENUM
     virtual void on_main_loop(void *) {};
@@ -51,6 +59,8 @@ public:
     virtual void on_halt(void *) {};
     virtual void on_enable(void *) {};
 
+private:
+    const char *module_name;
 };
 
 #endif
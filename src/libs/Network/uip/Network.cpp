@@ -188,7 +188,7 @@ void Network::on_module_loaded()
         }
     }
 
-    THEKERNEL->add_module( ethernet );
+    THEKERNEL->add_module( ethernet, "Ethernet" );
     THEKERNEL->slow_ticker->attach( 100, this, &Network::tick );
 
     // Register for events
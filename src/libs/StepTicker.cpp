@@ -15,6 +15,8 @@
 #include "StreamOutputPool.h"
 #include "Block.h"
 #include "Conveyor.h"
+#include "EventProfiler.h"
+#include "StreamOutput.h"
 
 #include "system_LPC17xx.h" // mbed.h lib
 #include <math.h>
@@ -45,6 +47,11 @@ StepTicker::StepTicker()
     LPC_TIM1->MCR = 5;              // match on Mr0, stop on match
     LPC_TIM1->TCR = 0;              // Disable interrupt
 
+    // the interrupts can be timed with the cycle counter
+    EventProfiler::start_counter();
+    this->ticks_per_us = EventProfiler::ticks_per_us();
+    reset_timing();
+
     // Default start values
     this->set_frequency(100000);
     this->set_unstep_time(100);
@@ -53,7 +60,12 @@ StepTicker::StepTicker()
     this->num_motors = 0;
 
     this->running = false;
+    this->segmented = false;
+    this->waiting = true;
+    this->speed_stopped = true;
     this->current_block = nullptr;
+    this->segment.steps = 0;
+    this->segment_steps = 0;
 
     #ifdef STEPTICKER_DEBUG_PIN
     // setup debug pin if defined
@@ -107,7 +119,14 @@ void StepTicker::unstep_tick()
 extern "C" void TIMER1_IRQHandler (void)
 {
     LPC_TIM1->IR |= 1 << 0;
-    StepTicker::getInstance()->unstep_tick();
+    StepTicker *st= StepTicker::getInstance();
+    if(st->is_timing()) {
+        uint32_t start= EventProfiler::now();
+        st->unstep_tick();
+        st->record_unstep_time(EventProfiler::now() - start);
+    } else {
+        st->unstep_tick();
+    }
 }
 
 // The actual interrupt handler where we do all the work
@@ -115,7 +134,54 @@ extern "C" void TIMER0_IRQHandler (void)
 {
     // Reset interrupt register
     LPC_TIM0->IR |= 1 << 0;
-    StepTicker::getInstance()->step_tick();
+    StepTicker *st= StepTicker::getInstance();
+    if(st->is_timing()) {
+        uint32_t start= EventProfiler::now();
+        st->step_tick();
+        st->record_step_time(EventProfiler::now() - start);
+    } else {
+        st->step_tick();
+    }
+    // the match flag is set again if the next tick came in while we were still busy
+    if(LPC_TIM0->IR & 1) st->count_missed_tick();
+}
+
+void StepTicker::isr_stats_t::add(uint32_t ticks, uint32_t ticks_per_us)
+{
+    ++count;
+    if(ticks > max) max= ticks;
+    uint32_t us= ticks / ticks_per_us;
+    ++histogram[us < STEPTICKER_HISTOGRAM_SIZE ? us : STEPTICKER_HISTOGRAM_SIZE - 1];
+}
+
+void StepTicker::reset_timing()
+{
+    __disable_irq();
+    step_stats= isr_stats_t{};
+    unstep_stats= isr_stats_t{};
+    missed_ticks= 0;
+    starved= 0;
+    __enable_irq();
+}
+
+void StepTicker::report_timing(StreamOutput *stream) const
+{
+    const isr_stats_t *stats[2]= {&step_stats, &unstep_stats};
+    const char *names[2]= {"step", "unstep"};
+    if(!timing) stream->printf("interrupt timing is off, steptimes on to start it\n");
+    for (int i = 0; timing && i < 2; ++i) {
+        const isr_stats_t& s= *stats[i];
+        stream->printf("%s tick: %lu calls, max %1.2f us\n", names[i], (unsigned long)s.count, (float)s.max / ticks_per_us);
+        for (int b = 0; b < STEPTICKER_HISTOGRAM_SIZE; ++b) {
+            if(s.histogram[b] == 0) continue;
+            if(b == STEPTICKER_HISTOGRAM_SIZE - 1) {
+                stream->printf("  >= %2d us: %lu\n", b, (unsigned long)s.histogram[b]);
+            } else {
+                stream->printf("  %2d-%2d us: %lu\n", b, b + 1, (unsigned long)s.histogram[b]);
+            }
+        }
+    }
+    stream->printf("step period %1.2f us, missed ticks %lu, starved %lu\n", 1000000.0F / frequency, (unsigned long)missed_ticks, (unsigned long)starved);
 }
 
 extern "C" void PendSV_Handler(void)
@@ -135,6 +201,11 @@ void StepTicker::step_tick (void)
 {
     //SET_STEPTICKER_DEBUG_PIN(running ? 1 : 0);
 
+    if(segmented) {
+        segment_tick();
+        return;
+    }
+
     // if nothing has been setup we ignore the ticks
     if(!running){
         // check if anything new available
@@ -153,11 +224,20 @@ void StepTicker::step_tick (void)
         return;
     }
 
+    // the jerk of an S-curve block changes at the same ticks for all motors
+    if(current_block->s_curve) {
+        while(jerk_phase < 8 && current_tick == next_jerk_tick) next_jerk_phase();
+    }
+
     bool still_moving= false;
     // foreach motor, if it is active see if time to issue a step to that motor
     for (uint8_t m = 0; m < num_motors; m++) {
         if(current_block->tick_info[m].steps_to_move == 0) continue; // not active
 
+        if(current_block->s_curve) {
+            current_block->tick_info[m].acceleration_change += jerk[m];
+        }
+
         current_block->tick_info[m].steps_per_tick += current_block->tick_info[m].acceleration_change;
 
         if(current_tick == current_block->tick_info[m].next_accel_event) {
@@ -208,6 +288,8 @@ void StepTicker::step_tick (void)
     // do this after so we start at tick 0
     current_tick++; // count number of ticks
 
+    if(speed_fnc) speed_tick(current_block->tick_info[speed_motor].steps_per_tick);
+
     // We may have set a pin on in this tick, now we reset the timer to set it off
     // Note there could be a race here if we run another tick before the unsteps have happened,
     // right now it takes about 3-4us but if the unstep were near 10uS or greater it would be an issue
@@ -227,14 +309,17 @@ void StepTicker::step_tick (void)
 
         // get next block
         // do it here so there is no delay in ticks
+        bool more= current_block->exit_speed > 0; // the planner expected another block to follow on
         THECONVEYOR->block_finished();
 
         if(THECONVEYOR->get_next_block(&current_block)) { // returns false if no new block is available
             running= start_next_block(); // returns true if there is at least one motor with steps to issue
 
         }else{
+            if(more && !THECONVEYOR->is_flushing()) ++starved;
             current_block= nullptr;
             running= false;
+            stop_speed_updates();
         }
 
         // all moves finished
@@ -264,6 +349,14 @@ bool StepTicker::start_next_block()
 
     current_tick= 0;
 
+    if(speed_fnc && ok) start_speed_updates();
+
+    if(current_block->s_curve) {
+        // first jerk phase starts on tick 0
+        jerk_phase= 0;
+        next_jerk_tick= 0;
+    }
+
     if(ok) {
         //SET_STEPTICKER_DEBUG_PIN(1);
         return true;
@@ -277,6 +370,247 @@ bool StepTicker::start_next_block()
     return false;
 }
 
+// step clock when segmented, the conveyor has already worked out the rate so all that is left per tick is
+// a 32 bit add for the longest axis, and when that steps a Bresenham step for the other motors
+void StepTicker::segment_tick()
+{
+    // get the next segment once the current one has issued all its steps
+    if(!running || segment_steps == segment.steps) {
+        if(!next_segment()) {
+            // if the queue was flushed the rest of this block is gone, otherwise we wait for the conveyor to catch up
+            if(THECONVEYOR->is_flushing()) {
+                if(running) stop_block();
+                waiting= true;
+            } else if(!waiting) {
+                // stopped part way through a block, or between blocks that were meant to follow on
+                waiting= true;
+                ++starved;
+            }
+            // nothing to step until the next segment, the speed is not reported as zero between blocks that follow on
+            stop_speed_updates();
+            return;
+        }
+        if(waiting) speed_countdown= 0; // report the speed as soon as it resumes
+        waiting= false;
+
+        // the plane motors of an arc may have just changed direction, so it waits a tick before it steps
+        if(current_block->is_arc) return;
+    }
+
+    if(THEKERNEL->is_halted()) {
+        running= false;
+        current_tick = 0;
+        current_block= nullptr;
+        return;
+    }
+
+    uint32_t c= segment_counter + segment.rate;
+    bool stepped= c < segment_counter; // wrapped so 1.0 step time for the longest axis
+    segment_counter= c;
+
+    if(speed_fnc) speed_tick(segment.rate);
+
+    if(stepped) {
+        ++segment_steps;
+
+        bool still_moving= false;
+        for (uint8_t m = 0; m < num_motors; m++) {
+            if(current_block->tick_info[m].steps_to_move == 0) continue; // not active
+
+            bresenham[m] += bresenham_steps[m];
+            if(bresenham[m] >= bresenham_count[m]) {
+                bresenham[m] -= bresenham_count[m];
+                ++current_block->tick_info[m].step_count;
+
+                // step the motor
+                bool ismoving= motor[m]->step(); // returns false if the moving flag was set to false externally (probes, endstops etc)
+                // we stepped so schedule an unstep
+                unstep.set(m);
+
+                if(!ismoving || current_block->tick_info[m].step_count == current_block->tick_info[m].steps_to_move) {
+                    // done
+                    current_block->tick_info[m].steps_to_move = 0;
+                    motor[m]->stop_moving(); // let motor know it is no longer moving
+                }
+            }
+
+            if(motor[m]->is_moving()) still_moving= true;
+        }
+
+        if(current_block->is_arc && still_moving && segment.last && segment_steps == segment.steps) {
+            // the plane motors of an arc do not count their steps, they are done when the last segment is
+            for (uint8_t m = 0; m < num_motors; m++) {
+                if(current_block->tick_info[m].steps_to_move == 0) continue;
+                current_block->tick_info[m].steps_to_move = 0;
+                motor[m]->stop_moving();
+            }
+            still_moving= false;
+        }
+
+        if(!still_moving) {
+            // all moves finished, any segments left for this block are skipped by next_segment()
+            current_tick = 0;
+            // if the planner expected another block to follow on, not having its first segment ready is a stall
+            waiting= current_block->exit_speed <= 0;
+            THECONVEYOR->block_finished();
+            current_block= nullptr;
+            running= false;
+        }
+    }
+
+    current_tick++;
+
+    // We may have set a pin on in this tick, now we reset the timer to set it off
+    if( unstep.any()) {
+        LPC_TIM1->TCR = 3;
+        LPC_TIM1->TCR = 1;
+    }
+
+    // get the next segment now rather than on the next tick, as the block path starts the next block, so any
+    // direction it sets is a tick before its first step
+    if((!running || segment_steps == segment.steps) && next_segment()) {
+        if(waiting) speed_countdown= 0;
+        waiting= false;
+    }
+}
+
+// only called from the step tick ISR, takes the next segment off the conveyor and starts its block if it is the first one
+bool StepTicker::next_segment()
+{
+    while(THECONVEYOR->get_next_segment(segment)) {
+        if(segment.first) {
+            current_block= segment.block;
+            if(!start_next_block()) {
+                // no motors to move and the block has already been released
+                current_block= nullptr;
+                running= false;
+                continue;
+            }
+
+            segment_counter= 0;
+            // start half way so the steps of the shorter axes are centered
+            uint32_t half= current_block->steps_event_count / 2;
+            for (uint8_t m = 0; m < num_motors; m++) {
+                bresenham[m]= half;
+                bresenham_steps[m]= current_block->steps[m];
+                bresenham_count[m]= current_block->steps_event_count;
+            }
+
+        } else if(segment.block != current_block) {
+            // left over from a block that was stopped early
+            continue;
+        }
+
+        if(current_block->is_arc) {
+            // the plane motors follow the chord of the arc for this segment, which may be in either direction
+            for (int i = 0; i < 2; ++i) {
+                uint8_t m= current_block->arc_info->motor[i];
+                int32_t s= segment.arc_steps[i];
+                motor[m]->set_direction(s < 0);
+                bresenham[m]= segment.steps / 2;
+                bresenham_steps[m]= (s < 0) ? -s : s;
+                bresenham_count[m]= segment.steps;
+            }
+        }
+
+        segment_steps= 0;
+        running= true;
+        return true;
+    }
+
+    return false;
+}
+
+// only called from the step tick ISR when the queue is flushed part way through a block, the conveyor has already released it
+void StepTicker::stop_block()
+{
+    for (uint8_t m = 0; m < num_motors; m++) {
+        if(current_block->tick_info[m].steps_to_move == 0) continue;
+        current_block->tick_info[m].steps_to_move = 0;
+        motor[m]->stop_moving();
+    }
+
+    current_tick = 0;
+    current_block= nullptr;
+    running= false;
+    stop_speed_updates();
+}
+
+void StepTicker::set_speed_fnc(std::function<void(const Block*, float)> fnc, uint32_t ticks)
+{
+    __disable_irq();
+    speed_fnc= fnc;
+    speed_ticks= ticks > 0 ? ticks : 1;
+    speed_countdown= 0;
+    // a block already being stepped gets its speed from now on
+    if(speed_fnc && running && current_block != nullptr) start_speed_updates();
+    __enable_irq();
+}
+
+// only called from the step tick ISR when a block starts and there is a speed_fnc
+void StepTicker::start_speed_updates()
+{
+    // the longest axis moves at the nominal rate of the block
+    speed_motor= 0;
+    for (uint8_t m = 1; m < num_motors; m++) {
+        if(current_block->steps[m] > current_block->steps[speed_motor]) speed_motor= m;
+    }
+
+    // the rate is steps per tick in 2.62 fixed point, or in 0.32 fixed point for a segment
+    float nominal= current_block->nominal_rate / frequency;
+    speed_scale= 1.0F / (nominal * (segmented ? 4294967296.0F : (float)STEPTICKER_FPSCALE));
+    speed_countdown= 0; // so the new block gets its speed straight away
+    speed_stopped= false;
+}
+
+// only called from the step tick ISR when there is nothing left to step
+void StepTicker::stop_speed_updates()
+{
+    if(!speed_fnc || speed_stopped) return;
+    speed_stopped= true;
+    speed_fnc(nullptr, 0);
+}
+
+// only called from the step tick ISR, rate is the current rate of speed_motor
+void StepTicker::speed_tick(float rate)
+{
+    if(speed_countdown > 0) {
+        --speed_countdown;
+        return;
+    }
+    speed_countdown= speed_ticks - 1;
+    // it is being stepped again, so the next time nothing is the speed_fnc must be told
+    speed_stopped= false;
+    // a short segment at the end of a block can be well over the nominal rate as its steps are rounded
+    float ratio= rate * speed_scale;
+    speed_fnc(current_block, ratio > 1.0F ? 1.0F : ratio);
+}
+
+// returns the rate of the segment being stepped in steps/sec of the longest axis of its block
+float StepTicker::get_segment_rate() const
+{
+    if(!running) return 0;
+    return (segment.rate / 4294967296.0F) * frequency;
+}
+
+// only called from the step tick ISR, sets the jerk for the current phase of the S-curve and moves on to the next one
+void StepTicker::next_jerk_phase()
+{
+    for (uint8_t m = 0; m < num_motors; m++) {
+        switch(jerk_phase) {
+            case 0: jerk[m]= current_block->jerk_info[m].accel_jerk; break;
+            case 2: jerk[m]= -current_block->jerk_info[m].accel_jerk; break;
+            case 4: jerk[m]= -current_block->jerk_info[m].decel_jerk; break;
+            case 6: jerk[m]= current_block->jerk_info[m].decel_jerk; break;
+            // past the end of the deceleration keep slowing down so any step left over from rounding gets forced out
+            case 7: jerk[m]= -current_block->jerk_info[m].decel_jerk; break;
+            default: jerk[m]= 0;
+        }
+    }
+
+    ++jerk_phase;
+    next_jerk_tick= current_block->get_jerk_event_tick(jerk_phase);
+}
 
 // returns index of the stepper motor in the array and bitset
 int StepTicker::register_motor(StepperMotor* m)
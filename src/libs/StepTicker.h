@@ -17,14 +17,19 @@
 
 #include "ActuatorCoordinates.h"
 #include "TSRingBuffer.h"
+#include "StepSegment.h"
 
 class StepperMotor;
 class Block;
+class StreamOutput;
 
 // handle 2.62 Fixed point
 #define STEPTICKER_FPSCALE (1LL<<62)
 #define STEPTICKER_FROMFP(x) ((float)(x)/STEPTICKER_FPSCALE)
 
+// number of 1us buckets in the histogram of the time taken by the step and unstep interrupts, the last is everything longer
+#define STEPTICKER_HISTOGRAM_SIZE 16
+
 class StepTicker{
     public:
         StepTicker();
@@ -35,6 +40,9 @@ class StepTicker{
         float get_frequency() const { return frequency; }
         void unstep_tick();
         const Block *get_current_block() const { return current_block; }
+        void set_segmented(bool flg) { segmented= flg; }
+        bool is_segmented() const { return segmented; }
+        float get_segment_rate() const;
 
         void step_tick (void);
         void handle_finish (void);
@@ -43,23 +51,84 @@ class StepTicker{
         // whatever setup the block should register this to know when it is done
         std::function<void()> finished_fnc{nullptr};
 
+        // called from the step tick ISR at the start of each block and then every ticks ticks while it is stepped, with the speed
+        // of its longest axis as a fraction of its nominal speed, and with nullptr when there is nothing left to step
+        void set_speed_fnc(std::function<void(const Block*, float)> fnc, uint32_t ticks);
+
         static StepTicker *getInstance() { return instance; }
 
+        // timing of the interrupts, only done when set_timing() turned it on as it adds to every tick. The interrupt handlers
+        // give the time taken in EventProfiler::now() ticks, and the step tick counts when the next match came in while it ran
+        void set_timing(bool flg) { timing= flg; }
+        bool is_timing() const { return timing; }
+        void record_step_time(uint32_t ticks) { step_stats.add(ticks, ticks_per_us); }
+        void record_unstep_time(uint32_t ticks) { unstep_stats.add(ticks, ticks_per_us); }
+        void count_missed_tick() { ++missed_ticks; }
+        void report_timing(StreamOutput *stream) const;
+        void reset_timing();
+        uint32_t get_max_step_us() const { return step_stats.max / ticks_per_us; }
+        uint32_t get_missed_ticks() const { return missed_ticks; }
+        uint32_t get_starved() const { return starved; }
+
     private:
         static StepTicker *instance;
 
+        struct isr_stats_t {
+            uint32_t count;
+            uint32_t max;
+            uint32_t histogram[STEPTICKER_HISTOGRAM_SIZE];
+            void add(uint32_t ticks, uint32_t ticks_per_us);
+        };
+
         bool start_next_block();
+        void next_jerk_phase();
+        void segment_tick();
+        bool next_segment();
+        void stop_block();
+        void start_speed_updates();
+        void stop_speed_updates();
+        void speed_tick(float rate);
 
         float frequency;
         uint32_t period;
+        uint32_t ticks_per_us;
+
+        isr_stats_t step_stats;
+        isr_stats_t unstep_stats;
+        volatile bool timing{false};   // the interrupts are timed into the stats, kept out of the bit fields the ISR writes
+        uint32_t missed_ticks;     // step interrupts that were still running when the next timer match came in
+        uint32_t starved;          // times a move had to wait, or stopped, as the next block or segment was not ready
         std::array<StepperMotor*, k_max_actuators> motor;
         std::bitset<k_max_actuators> unstep;
 
         Block *current_block;
         uint32_t current_tick{0};
 
+        // the speed updates, speed_scale turns the rate of speed_motor into a fraction of the nominal rate
+        std::function<void(const Block*, float)> speed_fnc{nullptr};
+        uint32_t speed_ticks{0};
+        uint32_t speed_countdown{0};
+        float speed_scale{0};
+        uint8_t speed_motor{0};
+
+        // the jerk currently being applied to each motor when the block is an S-curve
+        std::array<int64_t, k_max_actuators> jerk;
+        uint32_t next_jerk_tick{0};
+        uint8_t jerk_phase{0};
+
+        // when segmented the conveyor hands over constant rate segments and the motors are stepped with 32 bit counters
+        StepSegment segment;
+        uint32_t segment_counter;  // 0.32 fixed point, the longest axis steps when this wraps
+        uint32_t segment_steps;    // steps of the longest axis issued so far in this segment
+        std::array<uint32_t, k_max_actuators> bresenham;
+        std::array<uint32_t, k_max_actuators> bresenham_steps; // steps of each motor over bresenham_count steps of the longest axis
+        std::array<uint32_t, k_max_actuators> bresenham_count; // the whole block, or just the segment for the plane motors of an arc
+
         struct {
             volatile bool running:1;
             uint8_t num_motors:4;
+            bool segmented:1;
+            bool speed_stopped:1; // the speed_fnc has been told there is nothing being stepped
+            bool waiting:1;    // when segmented, the step ticks are waiting for a segment that is either not needed yet or already counted as starved
         };
 };
@@ -64,10 +64,11 @@
  * just always use the Standard Capacity cards with a block size of 512 bytes.
  * This is set with CMD16.
  *
- * You can read and write single blocks (CMD17, CMD25) or multiple blocks
- * (CMD18, CMD25). For simplicity, I'll just use single block accesses. When
- * the card gets a read command, it responds with a response token, and then
- * a data token or an error.
+ * You can read and write single blocks (CMD17, CMD24) or multiple blocks
+ * (CMD18, CMD25). Single block accesses are used for one block, and multiple
+ * block accesses when FatFs asks for several consecutive blocks, which saves
+ * the command and busy time between them. When the card gets a read command,
+ * it responds with a response token, and then a data token or an error.
  *
  * SPI Command Format
  * ------------------
@@ -115,6 +116,17 @@
  * +------+---------+---------+- -  - -+---------+-----------+----------+
  * | 0xFE | data[0] | data[1] |        | data[n] | crc[15:8] | crc[7:0] |
  * +------+---------+---------+- -  - -+---------+-----------+----------+
+ *
+ * Multiple Block Read and Write
+ * -----------------------------
+ *
+ * After CMD18 the card sends blocks, each with the 0xFE start token, until
+ * it gets CMD12 (STOP_TRANSMISSION). The byte straight after CMD12 is a stuff
+ * byte, then comes the R1 response and busy until the card is ready.
+ *
+ * After CMD25 each block is sent with a 0xFC start token and acknowledged
+ * with a data response token followed by busy. The transfer is ended with a
+ * 0xFD stop token, also followed by busy.
  */
 
 #include <stdio.h>
@@ -126,12 +138,18 @@ static const uint8_t OXFF = 0xFF;
 
 #define SD_COMMAND_TIMEOUT 5000
 
+#define SD_TOKEN_START_BLOCK        0xFE
+#define SD_TOKEN_START_MULTI_WRITE  0xFC
+#define SD_TOKEN_STOP_TRAN          0xFD
+
 SDCard::SDCard(PinName mosi, PinName miso, PinName sclk, PinName cs) :
   _spi(mosi, miso, sclk), _cs(cs) {
     _cs.output();
     _cs = 1;
     busyflag = false;
     _sectors = 0;
+    use_dma = false;
+    ssp_no = (mosi == P0_9) ? 1 : (mosi == P0_18 || mosi == P1_24) ? 0 : 0xFF;
 }
 
 #define R1_IDLE_STATE           (1 << 0)
@@ -284,48 +302,91 @@ int SDCard::disk_initialize()
     return 0;
 }
 
-int SDCard::disk_write(const char *buffer, uint32_t block_number)
+int SDCard::disk_write(const char *buffer, uint32_t block_number, uint32_t count)
 {
     if (busyflag)
         return 0;
 
-    busyflag = true;
-
     if (cardtype == SDCARD_FAIL)
         return -1;
-    // set write address for single block (CMD24)
-    if(_cmd(SDCMD_WRITE_BLOCK, BLOCK2ADDR(block_number)) != 0) {
-        return 1;
-    }
 
-    // send the data block
-    _write(buffer, 512);
+    busyflag = true;
+
+    int r = 0;
+    if (count == 1) {
+        // set write address for single block (CMD24)
+        if(_cmd(SDCMD_WRITE_BLOCK, BLOCK2ADDR(block_number)) != 0) {
+            busyflag = false;
+            return 1;
+        }
+
+        // send the data block
+        r = _write(buffer, 512);
+
+    } else {
+        // set write address for multiple blocks (CMD25), the card stays selected until the stop token
+        if(_cmdx(SDCMD_WRITE_MULTIPLE_BLOCK, BLOCK2ADDR(block_number)) != 0) {
+            busyflag = false;
+            return 1;
+        }
+
+        for (uint32_t i = 0; i < count && r == 0; i++) {
+            r = _write_block(buffer, SD_TOKEN_START_MULTI_WRITE);
+            buffer += 512;
+        }
+
+        // the stop token is needed even after an error to get the card out of the receive state
+        _spi.write(SD_TOKEN_STOP_TRAN);
+        _spi.write(0xFF);
+        _wait_not_busy();
+        _cs = 1;
+        _spi.write(0xFF);
+    }
 
     busyflag = false;
 
-    return 0;
+    return r;
 }
 
-int SDCard::disk_read(char *buffer, uint32_t block_number)
+int SDCard::disk_read(char *buffer, uint32_t block_number, uint32_t count)
 {
     if (busyflag)
         return 0;
 
-    busyflag = true;
-
     if (cardtype == SDCARD_FAIL)
         return -1;
-    // set read address for single block (CMD17)
-    if(_cmd(SDCMD_READ_SINGLE_BLOCK, BLOCK2ADDR(block_number)) != 0) {
-        return 1;
-    }
 
-    // receive the data
-    _read(buffer, 512);
+    busyflag = true;
+
+    int r = 0;
+    if (count == 1) {
+        // set read address for single block (CMD17)
+        if(_cmd(SDCMD_READ_SINGLE_BLOCK, BLOCK2ADDR(block_number)) != 0) {
+            busyflag = false;
+            return 1;
+        }
+
+        // receive the data
+        r = _read(buffer, 512);
+
+    } else {
+        // set read address for multiple blocks (CMD18), the card keeps sending blocks until told to stop
+        if(_cmdx(SDCMD_READ_MULTIPLE_BLOCK, BLOCK2ADDR(block_number)) != 0) {
+            busyflag = false;
+            return 1;
+        }
+
+        for (uint32_t i = 0; i < count && r == 0; i++) {
+            r = _read_block(buffer, 512);
+            buffer += 512;
+        }
+
+        if(_stop_transmission() != 0) r = 1;
+    }
 
     busyflag = false;
 
-    return 0;
+    return r;
 }
 
 int SDCard::disk_status() { return (_sectors > 0)?0:1; }
@@ -336,7 +397,16 @@ int SDCard::disk_sync() {
 uint32_t SDCard::disk_sectors() { return _sectors; }
 uint64_t SDCard::disk_size() { return ((uint64_t) _sectors) << 9; }
 uint32_t SDCard::disk_blocksize() { return (1<<9); }
-bool SDCard::disk_canDMA() { return false; }
+bool SDCard::disk_canDMA() { return use_dma; }
+
+void SDCard::set_dma(bool enable)
+{
+#ifdef TARGET_LPC1768
+    use_dma = enable && ssp_no != 0xFF;
+#else
+    use_dma = false;
+#endif
+}
 
 SDCard::CARD_TYPE SDCard::card_type()
 {
@@ -441,7 +511,7 @@ int SDCard::_cmd8() {
         response[0] = _spi.write(0xFF);
         if(!(response[0] & 0x80)) {
                 for(int j=1; j<5; j++) {
-                    response[i] = _spi.write(0xFF);
+                    response[j] = _spi.write(0xFF);
                 }
                 _cs = 1;
                 _spi.write(0xFF);
@@ -456,57 +526,151 @@ int SDCard::_cmd8() {
 int SDCard::_read(char *buffer, int length) {
     _cs = 0;
 
-    // read until start byte (0xFF)
-    while(_spi.write(0xFF) != 0xFE);
-//     uint8_t r;
-//     while((r = _spi.write(0xFF)) != 0xFE)
-//     {
-//         iprintf("0x%02X ", r);
-//         for (volatile uint32_t j = 262144; j; j--);
-//     }
-//
-//     iprintf("Got start byte, reading data\n");
+    int r = _read_block(buffer, length);
 
-    // read data
-    for(int i=0; i<length; i++) {
-        buffer[i] = _spi.write(0xFF);
+    _cs = 1;
+    _spi.write(0xFF);
+    return r;
+}
+
+// read one data block, the card must already be selected
+int SDCard::_read_block(char *buffer, int length) {
+    // read until start byte (0xFE), anything else that is not 0xFF is an error token
+    int token;
+    for(int i=0; i<SD_COMMAND_TIMEOUT * 100; i++) {
+        token = _spi.write(0xFF);
+        if(token != 0xFF) break;
     }
+    if(token != SD_TOKEN_START_BLOCK) {
+        return 1;
+    }
+
+    // read data
+    _transfer(buffer, nullptr, length);
     _spi.write(0xFF); // checksum
     _spi.write(0xFF);
 
-    _cs = 1;
-    _spi.write(0xFF);
     return 0;
 }
 
 int SDCard::_write(const char *buffer, int length) {
     _cs = 0;
 
+    int r = _write_block(buffer, SD_TOKEN_START_BLOCK);
+
+    _cs = 1;
+    _spi.write(0xFF);
+    return r;
+}
+
+// write one 512 byte data block with the given start token, the card must already be selected
+int SDCard::_write_block(const char *buffer, int token) {
     // indicate start of block
-    _spi.write(0xFE);
+    _spi.write(token);
 
     // write the data
-    for(int i=0; i<length; i++) {
-        _spi.write(buffer[i]);
-    }
+    _transfer(nullptr, buffer, 512);
 
     // write the checksum
     _spi.write(0xFF);
     _spi.write(0xFF);
 
     // check the repsonse token
-    if((_spi.write(0xFF) & 0x1F) != 0x05) {
-        _cs = 1;
-        _spi.write(0xFF);
-        return 1;
-    }
+    int r = ((_spi.write(0xFF) & 0x1F) != 0x05) ? 1 : 0;
+
+    // wait for write to finish, the card is also busy after a rejected block
+    _wait_not_busy();
+    return r;
+}
 
-    // wait for write to finish
+// the card holds its output low while it is busy
+void SDCard::_wait_not_busy() {
     while(_spi.write(0xFF) == 0);
+}
+
+// end a multiple block read with CMD12, the card must already be selected
+int SDCard::_stop_transmission() {
+    _spi.write(0x40 | SDCMD_STOP_TRANSMISSION);
+    _spi.write(0);
+    _spi.write(0);
+    _spi.write(0);
+    _spi.write(0);
+    _spi.write(0x95);
+
+    // skip the stuff byte, then wait for the response
+    _spi.write(0xFF);
+    int response = -1;
+    for(int i=0; i<SD_COMMAND_TIMEOUT; i++) {
+        response = _spi.write(0xFF);
+        if(!(response & 0x80)) break;
+    }
 
+    _wait_not_busy();
     _cs = 1;
     _spi.write(0xFF);
-    return 0;
+    return response;
+}
+
+#ifdef TARGET_LPC1768
+// GPDMA channels used for the data blocks, the receive channel has the higher priority so the SSP never overruns.
+// nothing else in the firmware uses the GPDMA (M8266WIFI_SPI_ACCESS_USE_DMA is off in brd_cfg.h), should another driver
+// ever claim these channels dma_transfer() sees them busy and the block is moved by the CPU instead
+#define SD_DMA_RX_CHANNEL LPC_GPDMACH6
+#define SD_DMA_TX_CHANNEL LPC_GPDMACH7
+#define SD_DMA_RX_MASK    (1 << 6)
+#define SD_DMA_TX_MASK    (1 << 7)
+
+// move a block between memory and the SSP with the GPDMA, the receive side is dropped when rx is null and 0xFF sent when tx is null
+// returns false without doing anything if the channels are already in use
+static bool dma_transfer(LPC_SSP_TypeDef *ssp, uint8_t ssp_no, char *rx, const char *tx, int length)
+{
+    static const uint8_t ff = 0xFF;
+    static uint8_t dummy;
+
+    LPC_SC->PCONP |= (1UL << 29); // power up the GPDMA
+    if(LPC_GPDMA->DMACEnbldChns & (SD_DMA_RX_MASK | SD_DMA_TX_MASK)) return false;
+
+    LPC_GPDMA->DMACConfig = 1;
+    LPC_GPDMA->DMACIntTCClear = SD_DMA_RX_MASK | SD_DMA_TX_MASK;
+    LPC_GPDMA->DMACIntErrClr = SD_DMA_RX_MASK | SD_DMA_TX_MASK;
+
+    // SSP0 TX/RX are requests 0 and 1, SSP1 TX/RX are 2 and 3, burst of 4 bytes to match the SSP FIFO trigger level
+    SD_DMA_RX_CHANNEL->DMACCSrcAddr  = (uint32_t)&ssp->DR;
+    SD_DMA_RX_CHANNEL->DMACCDestAddr = (uint32_t)(rx != nullptr ? (uint8_t *)rx : &dummy);
+    SD_DMA_RX_CHANNEL->DMACCLLI      = 0;
+    SD_DMA_RX_CHANNEL->DMACCControl  = length | (1 << 12) | (1 << 15) | ((rx != nullptr) ? (1 << 27) : 0);
+    SD_DMA_RX_CHANNEL->DMACCConfig   = 1 | ((ssp_no * 2 + 1) << 1) | (2 << 11);
+
+    SD_DMA_TX_CHANNEL->DMACCSrcAddr  = (uint32_t)(tx != nullptr ? (const uint8_t *)tx : &ff);
+    SD_DMA_TX_CHANNEL->DMACCDestAddr = (uint32_t)&ssp->DR;
+    SD_DMA_TX_CHANNEL->DMACCLLI      = 0;
+    SD_DMA_TX_CHANNEL->DMACCControl  = length | (1 << 12) | (1 << 15) | ((tx != nullptr) ? (1 << 26) : 0);
+    SD_DMA_TX_CHANNEL->DMACCConfig   = 1 | ((ssp_no * 2) << 6) | (1 << 11);
+
+    ssp->DMACR = 3;
+
+    // the channels disable themselves when done, or on a bus error, the receive one finishes last. this busy waits for
+    // as long as the CPU would take to clock the block through itself, about 170us for 512 bytes at 25MHz. interrupts
+    // still run, the DMA just takes the work for each byte off the CPU
+    while(LPC_GPDMA->DMACEnbldChns & (SD_DMA_RX_MASK | SD_DMA_TX_MASK));
+
+    ssp->DMACR = 0;
+    return true;
+}
+#endif
+
+// clock length bytes through the SPI, reading into rx and sending tx, either of which may be null
+void SDCard::_transfer(char *rx, const char *tx, int length) {
+#ifdef TARGET_LPC1768
+    if(use_dma && dma_transfer(ssp_no == 0 ? LPC_SSP0 : LPC_SSP1, ssp_no, rx, tx, length)) {
+        return;
+    }
+#endif
+
+    for(int i=0; i<length; i++) {
+        int c = _spi.write(tx != nullptr ? tx[i] : 0xFF);
+        if(rx != nullptr) rx[i] = c;
+    }
 }
 
 static int ext_bits(char *data, int msb, int lsb) {
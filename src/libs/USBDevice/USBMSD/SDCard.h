@@ -69,8 +69,8 @@ public:
     } CARD_TYPE;
 
     virtual int disk_initialize();
-    virtual int disk_write(const char *buffer, uint32_t block_number);
-    virtual int disk_read(char *buffer, uint32_t block_number);
+    virtual int disk_write(const char *buffer, uint32_t block_number, uint32_t count = 1);
+    virtual int disk_read(char *buffer, uint32_t block_number, uint32_t count = 1);
     virtual int disk_status();
     virtual int disk_sync();
     virtual uint32_t disk_sectors();
@@ -80,6 +80,9 @@ public:
 
     CARD_TYPE card_type(void);
 
+    // use the GPDMA to move the data blocks to and from the SSP, only on the LPC1768
+    void set_dma(bool enable);
+
     bool busy();
 
 protected:
@@ -94,6 +97,11 @@ protected:
 
     int _read(char *buffer, int length);
     int _write(const char *buffer, int length);
+    int _read_block(char *buffer, int length);
+    int _write_block(const char *buffer, int token);
+    int _stop_transmission();
+    void _wait_not_busy();
+    void _transfer(char *rx, const char *tx, int length);
 
     uint32_t _sd_sectors();
     uint32_t _sectors;
@@ -102,6 +110,8 @@ protected:
     GPIO _cs;
 
     volatile bool busyflag;
+    bool use_dma;
+    uint8_t ssp_no; // which SSP the pins belong to, for the DMA requests
 
     CARD_TYPE cardtype;
 };
@@ -6,22 +6,24 @@
 class MSD_Disk {
 public:
     /*
-     * read a block on a storage chip
+     * read blocks on a storage chip
      *
      * @param data pointer where will be stored read data
-     * @param block block number
+     * @param block first block number
+     * @param count number of consecutive blocks to read
      * @returns 0 if successful
      */
-    virtual int disk_read(char * data, uint32_t block) { return 0; };
+    virtual int disk_read(char * data, uint32_t block, uint32_t count = 1) { return 0; };
 
     /*
-     * write a block on a storage chip
+     * write blocks on a storage chip
      *
      * @param data data to write
-     * @param block block number
+     * @param block first block number
+     * @param count number of consecutive blocks to write
      * @returns 0 if successful
      */
-    virtual int disk_write(const char * data, uint32_t block) { return 0; };
+    virtual int disk_write(const char * data, uint32_t block, uint32_t count = 1) { return 0; };
 
     /*
      * Disk initilization
@@ -95,11 +95,15 @@ int USBSerial::_getc()
     return c;
 }
 
+// returns everything received so far, up to a packets worth, so uploads are not handled a byte at a time
 int USBSerial::gets(char** buf)
 {
-	getc_result = this->_getc();
-	*buf = &getc_result;
-	return 1;
+    int n = 0;
+    do {
+        gets_buffer[n++] = this->_getc();
+    } while (n < (int)sizeof(gets_buffer) && !rxbuf.isEmpty());
+    *buf = gets_buffer;
+    return n;
 }
 
 int USBSerial::puts(const char *str)
@@ -39,7 +39,7 @@ public:
     int _getc();
     int puts(const char *);
     int gets(char** buf);
-    char getc_result;
+    char gets_buffer[MAX_PACKET_SIZE_EPBULK];
 
     uint8_t available();
     bool ready();
@@ -67,6 +67,8 @@
 #define disable_msd_checksum  CHECKSUM("msd_disable")
 #define dfu_enable_checksum  CHECKSUM("dfu_enable")
 #define watchdog_timeout_checksum  CHECKSUM("watchdog_timeout")
+#define sd_dma_enable_checksum  CHECKSUM("sd_dma_enable")
+#define boot_profile_enable_checksum  CHECKSUM("boot_profile_enable")
 
 
 // USB Stuff
@@ -105,6 +107,7 @@ void init() {
     kernel->streams->printf("Smoothie Running @%ldMHz\r\n", SystemCoreClock / 1000000);
     SimpleShell::version_command("", kernel->streams);
 
+    sd.set_dma(kernel->config->value( sd_dma_enable_checksum )->by_default(false)->as_bool());
     bool sdok= (sd.disk_initialize() == 0);
     if(!sdok) kernel->streams->printf("SDCard failed to initialize\r\n");
 
@@ -127,16 +130,16 @@ void init() {
 #endif
 
     // Create and add main modules
-    kernel->add_module( new(AHB0) Player() );
+    kernel->add_module( new(AHB0) Player(), "Player" );
 
     // ATC Handler
-    kernel->add_module( new(AHB0) ATCHandler() );
+    kernel->add_module( new(AHB0) ATCHandler(), "ATCHandler" );
     // Wifi Provider
-    kernel->add_module( new(AHB0) WifiProvider() );
+    kernel->add_module( new(AHB0) WifiProvider(), "WifiProvider" );
 
-    kernel->add_module( new(AHB0) CurrentControl() );
-    kernel->add_module( new(AHB0) KillButton() );
-    kernel->add_module( new(AHB0) PlayLed() );
+    kernel->add_module( new(AHB0) CurrentControl(), "CurrentControl" );
+    kernel->add_module( new(AHB0) KillButton(), "KillButton" );
+    kernel->add_module( new(AHB0) PlayLed(), "PlayLed" );
 
     // these modules can be completely disabled in the Makefile by adding to EXCLUDE_MODULES
     #ifndef NO_TOOLS_SWITCH
@@ -157,10 +160,10 @@ void init() {
     delete tp;
     // #endif
     #ifndef NO_TOOLS_ENDSTOPS
-    kernel->add_module( new(AHB0) Endstops() );
+    kernel->add_module( new(AHB0) Endstops(), "Endstops" );
     #endif
     #ifndef NO_TOOLS_LASER
-    kernel->add_module( new Laser() );
+    kernel->add_module( new Laser(), "Laser" );
     #endif
     #ifndef NO_TOOLS_SPINDLE
     SpindleMaker *sm= new SpindleMaker();
@@ -172,66 +175,69 @@ void init() {
     // kernel->add_module( new(AHB0) Panel() );
     #endif
     #ifndef NO_TOOLS_ZPROBE
-    kernel->add_module( new(AHB0) ZProbe() );
+    kernel->add_module( new(AHB0) ZProbe(), "ZProbe" );
     #endif
     #ifndef NO_TOOLS_SCARACAL
-    kernel->add_module( new(AHB0) SCARAcal() );
+    kernel->add_module( new(AHB0) SCARAcal(), "SCARAcal" );
     #endif
     #ifndef NO_TOOLS_ROTARYDELTACALIBRATION
-    kernel->add_module( new(AHB0) RotaryDeltaCalibration() );
+    kernel->add_module( new(AHB0) RotaryDeltaCalibration(), "RotaryDeltaCalibration" );
     #endif
     #ifndef NONETWORK
-    kernel->add_module( new Network() );
+    kernel->add_module( new Network(), "Network" );
     #endif
     #ifndef NO_TOOLS_TEMPERATURESWITCH
     // Must be loaded after TemperatureControl
-    kernel->add_module( new(AHB0) TemperatureSwitch() );
+    kernel->add_module( new(AHB0) TemperatureSwitch(), "TemperatureSwitch" );
     #endif
     #ifndef NO_TOOLS_DRILLINGCYCLES
-    kernel->add_module( new(AHB0) Drillingcycles() );
+    kernel->add_module( new(AHB0) Drillingcycles(), "Drillingcycles" );
     #endif
     #ifndef NO_TOOLS_FILAMENTDETECTOR
-    kernel->add_module( new(AHB0) FilamentDetector() );
+    kernel->add_module( new(AHB0) FilamentDetector(), "FilamentDetector" );
     #endif
     #ifndef NO_UTILS_MOTORDRIVERCONTROL
-    kernel->add_module( new MotorDriverControl(0) );
+    kernel->add_module( new MotorDriverControl(0), "MotorDriverControl" );
     #endif
     // Create and initialize USB stuff
     u.init();
 
 #ifdef DISABLEMSD
     if(sdok && msc != NULL){
-        kernel->add_module( msc );
+        kernel->add_module( msc, "MSD" );
     }
 #else
-    kernel->add_module( &msc );
+    kernel->add_module( &msc, "MSD" );
 #endif
 
-    kernel->add_module( &usbserial );
+    kernel->add_module( &usbserial, "USBSerial" );
     if( kernel->config->value( second_usb_serial_enable_checksum )->by_default(false)->as_bool() ){
-        kernel->add_module( new(AHB0) USBSerial(&u) );
+        kernel->add_module( new(AHB0) USBSerial(&u), "USBSerial" );
     }
 
     if( kernel->config->value( dfu_enable_checksum )->by_default(false)->as_bool() ){
-        kernel->add_module( new(AHB0) DFU(&u));
+        kernel->add_module( new(AHB0) DFU(&u), "DFU" );
     }
 
     // 10 second watchdog timeout (or config as seconds)
     float t= kernel->config->value( watchdog_timeout_checksum )->by_default(10.0F)->as_number();
     if(t > 0.1F) {
         // NOTE setting WDT_RESET with the current bootloader would leave it in DFU mode which would be suboptimal
-        kernel->add_module( new Watchdog(t*1000000, WDT_MRI)); // WDT_RESET));
+        kernel->add_module( new Watchdog(t*1000000, WDT_MRI), "Watchdog"); // WDT_RESET));
         kernel->streams->printf("Watchdog enabled for %f seconds\n", t);
     }else{
         kernel->streams->printf("WARNING Watchdog is disabled\n");
     }
 
 
-    kernel->add_module( &u );
+    kernel->add_module( &u, "USB" );
 
     // memory before cache is cleared
     //SimpleShell::print_mem(kernel->streams);
 
+    // how long each module took to load, needs the config so do it before the cache is cleared
+    kernel->boot_profile_report(kernel->config->value( boot_profile_enable_checksum )->by_default(false)->as_bool() ? kernel->streams : nullptr);
+
     // clear up the config cache to save some memory
     kernel->config->config_cache_clear();
 
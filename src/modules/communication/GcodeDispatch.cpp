@@ -27,8 +27,12 @@
 #include "LPC17xx.h"
 #include "version.h"
 
+#include <string.h>
+#include <algorithm>
+
 #define panel_display_message_checksum CHECKSUM("display_message")
 #define panel_checksum             CHECKSUM("panel")
+#define frame_window_checksum      CHECKSUM("frame_window")
 
 // goes in Flash, list of Mxxx codes that are allowed when in Halted state
 static const int allowed_mcodes[]= {2,5,9,30,105,114,115,119,80,81,911,503,106,107}; // get temp, get pos, get endstops etc
@@ -44,29 +48,134 @@ GcodeDispatch::GcodeDispatch()
     uploading = false;
     currentline = -1;
     modal_group_1= 0;
+    frame_seq= 0;
+    frame_window= 8;
 }
 
 // Called when the module has just been loaded
 void GcodeDispatch::on_module_loaded()
 {
     this->register_for_event(ON_CONSOLE_LINE_RECEIVED);
+
+    // limited so the frames in flight fit in the receive buffers, and below half the sequence numbers so old ones can be told apart
+    this->frame_window= std::min(127, std::max(1, THEKERNEL->config->value(frame_window_checksum)->by_default(8)->as_int()));
+}
+
+static int hex_value(const char *s, int n)
+{
+    int v = 0;
+    for (int i = 0; i < n; ++i) {
+        char c = s[i];
+        if(c >= '0' && c <= '9') v = (v << 4) | (c - '0');
+        else if(c >= 'A' && c <= 'F') v = (v << 4) | (c - 'A' + 10);
+        else if(c >= 'a' && c <= 'f') v = (v << 4) | (c - 'a' + 10);
+        else return -1;
+    }
+    return v;
+}
+
+// a framed line, see FramedStream.h. the line in it is passed on to everything that handles console lines just
+// as if it had been received on its own, with the replies going through framed_stream so its ok is dropped
+void GcodeDispatch::on_frame_received(SerialMessage& message)
+{
+    const char *frame = message.message.c_str();
+    size_t len = message.message.size();
+    StreamOutput *stream = message.stream;
+
+    // one frame may use one block, and there is always room for one more as it would just wait for the queue
+    auto credits = [this]() { return std::max(1, std::min<int>(this->frame_window, THECONVEYOR->get_free_blocks())); };
+
+    // STX ss line ETX cccc
+    const char *etx = (len >= 8) ? frame + len - 5 : nullptr;
+    int seq = (etx != nullptr) ? hex_value(frame + 1, 2) : -1;
+    int crc = (etx != nullptr && *etx == FRAME_END) ? hex_value(etx + 1, 4) : -1;
+    if(seq < 0 || crc < 0 || crc != FramedStream::crc16(frame + 1, etx - frame - 1)) {
+        stream->printf("nak %02X\n", this->frame_seq);
+        return;
+    }
+
+    if(etx == frame + 3 && seq == 0) {
+        // empty frame 0 starts a new session on this stream
+        this->framed_stream.flush();
+        this->framed_stream.set_stream(stream);
+        this->frame_seq = 0;
+        stream->printf("ack 00 %d\n", credits());
+        return;
+
+    } else if(stream != this->framed_stream.get_stream()) {
+        stream->printf("nak 00\n");
+        return;
+
+    } else if(seq != this->frame_seq) {
+        // a frame we have already done is acked again, as the ack must have been lost, anything else has to be sent again
+        if((uint8_t)(this->frame_seq - seq) <= 128) {
+            stream->printf("ack %02X %d\n", seq, credits());
+        } else {
+            stream->printf("nak %02X\n", this->frame_seq);
+        }
+        return;
+
+    } else {
+        SerialMessage line;
+        line.message.assign(frame + 3, etx);
+        line.stream = &this->framed_stream;
+        line.line = message.line;
+        THEKERNEL->call_event(ON_CONSOLE_LINE_RECEIVED, &line);
+        this->framed_stream.flush();
+    }
+
+    this->frame_seq = seq + 1;
+    stream->printf("ack %02X %d\n", seq, credits());
+}
+
+// returns the first character in [s, e) that is in set, or e if there is none
+static const char *find_first_of(const char *s, const char *e, const char *set)
+{
+    for (; s < e; ++s) {
+        if(strchr(set, *s) != nullptr) return s;
+    }
+    return e;
+}
+
+// returns the first character in [s, e) that is not in set, or e if there is none
+static const char *find_first_not_of(const char *s, const char *e, const char *set)
+{
+    for (; s < e; ++s) {
+        if(strchr(set, *s) == nullptr) return s;
+    }
+    return e;
 }
 
 // When a command is received, if it is a Gcode, dispatch it as an object via an event
+// The line is parsed in place, possible_command to end is the part of it still to be processed
 void GcodeDispatch::on_console_line_received(void *line)
 {
-    SerialMessage new_message = *static_cast<SerialMessage *>(line);
-    string possible_command = new_message.message;
+    // the queue running dry while a line is still being handled is an underrun, a host that has not sent the next one is not
+    THECONVEYOR->line_started();
+    handle_line(*static_cast<SerialMessage *>(line));
+    THECONVEYOR->line_finished();
+}
+
+void GcodeDispatch::handle_line(SerialMessage& new_message)
+{
+    const char *possible_command = new_message.message.c_str();
+    const char *end = possible_command + new_message.message.size();
+    string rewritten_line; // only used for the pycam syntax below
 
     int ln = 0;
     int cs = 0;
 
     // just reply ok to empty lines
-    if(possible_command.empty()) {
+    if(possible_command == end) {
         new_message.stream->printf("ok\r\n");
         return;
     }
 
+    if(possible_command[0] == FRAME_START) {
+        on_frame_received(new_message);
+        return;
+    }
+
 try_again:
 
     char first_char = possible_command[0];
@@ -85,7 +194,7 @@ try_again:
 
         //Get linenumber
         if ( first_char == 'N' ) {
-            Gcode full_line = Gcode(possible_command, new_message.stream, false);
+            Gcode full_line(possible_command, end - possible_command, new_message.stream, false);
             ln = (int) full_line.get_int('N');
             int chksum = (int) full_line.get_int('*');
 
@@ -99,25 +208,19 @@ try_again:
             }
 
             //Strip checksum value from possible_command
-            size_t chkpos = possible_command.find_first_of("*");
+            const char *chkpos = find_first_of(possible_command, end, "*");
 
 			//Calculate checksum
-            if ( chkpos != string::npos ) {
-				possible_command = possible_command.substr(0, chkpos);
-                for (auto c = possible_command.cbegin(); *c != '*' && c != possible_command.cend(); c++)
+            if ( chkpos != end ) {
+				end = chkpos;
+                for (const char *c = possible_command; c != end; c++)
                     cs = cs ^ *c;
                 cs &= 0xff;  // Defensive programming...
                 cs -= chksum;
 			}
 
-            //Strip line number value from possible_command
-			size_t lnsize = possible_command.find_first_not_of("N0123456789.,- ");
-			if(lnsize != string::npos) {
-				possible_command = possible_command.substr(lnsize);
-			}else{
-				// it is a blank line
-				possible_command.clear();
-			}
+            //Strip line number value from possible_command, if it is a blank line this leaves it empty
+			possible_command = find_first_not_of(possible_command, end, "N0123456789.,- ");
 
         } else {
             //Assume checks succeeded
@@ -126,10 +229,7 @@ try_again:
         }
 
         //Remove comments
-        size_t comment = possible_command.find_first_of(";(");
-        if( comment != string::npos ) {
-            possible_command = possible_command.substr(0, comment);
-        }
+        end = find_first_of(possible_command, end, ";(");
 
         //If checksum passes then process message, else request resend
         int nextline = currentline + 1;
@@ -139,22 +239,20 @@ try_again:
             }
 
             bool sent_ok= false; // used for G1 optimization
-            while(possible_command.size() > 0) {
+            while(possible_command < end) {
                 // assumes G or M are always the first on the line
-                size_t nextcmd = possible_command.find_first_of("GM", 2);
-                string single_command;
-                if(nextcmd == string::npos || first_char == 'T') {
-                    single_command = possible_command;
-                    possible_command = "";
-                } else {
-                    single_command = possible_command.substr(0, nextcmd);
-                    possible_command = possible_command.substr(nextcmd);
-                }
+                // single_command is the part up to the next G or M, the rest of the line follows it in the same buffer
+                const char *single_command = possible_command;
+                const char *nextcmd = (end - possible_command > 2) ? find_first_of(possible_command + 2, end, "GM") : end;
+                if(first_char == 'T') nextcmd = end;
+                size_t single_len = nextcmd - single_command;
+                possible_command = nextcmd;
 
 
                 if(!uploading || upload_stream != new_message.stream) {
-                    // Prepare gcode for dispatch
-                    Gcode *gcode = new Gcode(single_command, new_message.stream, false, new_message.line);
+                    // Prepare gcode for dispatch, the Gcode is on the stack and short commands are held inline so this does not allocate
+                    Gcode gc(single_command, single_len, new_message.stream, false, new_message.line);
+                    Gcode *gcode = &gc;
 
                     if(THEKERNEL->is_halted()) {
                         // we ignore all commands until M999, unless it is in the exceptions list (like M105 get temp)
@@ -164,7 +262,6 @@ try_again:
                                 new_message.stream->printf("WARNING: After HALT you should HOME as position is currently unknown\n");
                             }
                             new_message.stream->printf("ok\n");
-                            delete gcode;
                             return;
 
                         }else if(!is_allowed_mcode(gcode->m)) {
@@ -175,7 +272,6 @@ try_again:
                             }else{
                                 new_message.stream->printf("!!\r\n");
                             }
-                            delete gcode;
                             return;
                         }
                     }
@@ -184,11 +280,10 @@ try_again:
                         if(gcode->g == 53) { // G53 makes next movement command use machine coordinates
                             // this is ugly to implement as there may or may not be a G0/G1 on the same line
                             // valid version seem to include G53 G0 X1 Y2 Z3 G53 X1 Y2
-                            if(possible_command.empty()) {
+                            if(possible_command == end) {
                                 // use last gcode G1 or G0 if none on the line, and pass through as if it was a G0/G1
                                 // TODO it is really an error if the last is not G0 thru G3
                                 if(modal_group_1 > 3) {
-                                    delete gcode;
                                     new_message.stream->printf("ok - Invalid G53\r\n");
                                     return;
                                 }
@@ -196,13 +291,11 @@ try_again:
                                 gcode->g= modal_group_1;
 
                             }else{
-                                delete gcode;
                                 // extract next G0/G1 from the rest of the line, ignore if it is not one of these
-                                gcode = new Gcode(possible_command, new_message.stream);
-                                possible_command= "";
+                                gc = Gcode(possible_command, end - possible_command, new_message.stream);
+                                possible_command= end;
                                 if(!gcode->has_g || gcode->g > 1) {
                                     // not G0 or G1 so ignore it as it is invalid
-                                    delete gcode;
                                     new_message.stream->printf("ok - Invalid G53\r\n");
                                     return;
                                 }
@@ -218,8 +311,8 @@ try_again:
                             }
                         }
 
-                        // remember last modal group 1 code
-                        if(gcode->g < 4) {
+                        // remember last modal group 1 code, G7 rasters are modal too
+                        if(gcode->g < 4 || gcode->g == 7) {
                             modal_group_1= gcode->g;
                         }
                     }
@@ -227,9 +320,7 @@ try_again:
                     if(gcode->has_m) {
                         switch (gcode->m) {
                             case 28: // start upload command
-                                delete gcode;
-
-                                this->upload_filename = "/sd/" + single_command.substr(4); // rest of line is filename
+                                this->upload_filename = "/sd/" + string(single_command + std::min<size_t>(4, single_len), nextcmd); // rest of line is filename
                                 // open file
                                 upload_fd = fopen(this->upload_filename.c_str(), "w");
                                 if(upload_fd != NULL) {
@@ -264,13 +355,12 @@ try_again:
                                 // disables heaters and motors, ignores further incoming Gcode and clears block queue
                                 THEKERNEL->call_event(ON_HALT, nullptr);
                                 THEKERNEL->streams->printf("ok Emergency Stop Requested - reset or M999 required to exit HALT state\r\n");
-                                delete gcode;
                                 return;
 
                             case 115: { // M115 Get firmware version and capabilities
                                 Version vers;
 
-                                new_message.stream->printf("FIRMWARE_NAME:Smoothieware, FIRMWARE_URL:http%%3A//smoothieware.org, X-SOURCE_CODE_URL:https://github.com/Smoothieware/Smoothieware, FIRMWARE_VERSION:%s, X-FIRMWARE_BUILD_DATE:%s, X-SYSTEM_CLOCK:%ldMHz, X-AXES:%d, X-GRBL_MODE:%d", vers.get_build(), vers.get_build_date(), SystemCoreClock / 1000000, MAX_ROBOT_ACTUATORS, THEKERNEL->is_grbl_mode());
+                                new_message.stream->printf("FIRMWARE_NAME:Smoothieware, FIRMWARE_URL:http%%3A//smoothieware.org, X-SOURCE_CODE_URL:https://github.com/Smoothieware/Smoothieware, FIRMWARE_VERSION:%s, X-FIRMWARE_BUILD_DATE:%s, X-SYSTEM_CLOCK:%ldMHz, X-AXES:%d, X-GRBL_MODE:%d", vers.get_build(), vers.get_build_date(), (long)(SystemCoreClock / 1000000), MAX_ROBOT_ACTUATORS, THEKERNEL->is_grbl_mode());
 
                                 #ifdef CNC
                                 new_message.stream->printf(", X-CNC:1");
@@ -293,9 +383,8 @@ try_again:
 
                             case 117: // M117 is a special non compliant Gcode as it allows arbitrary text on the line following the command
                             {    // concatenate the command again and send to panel if enabled
-                                string str= single_command.substr(4) + possible_command;
+                                string str(single_command + std::min<size_t>(4, single_len), end);
                                 PublicData::set_value( panel_checksum, panel_display_message_checksum, &str );
-                                delete gcode;
                                 new_message.stream->printf("ok\r\n");
                                 return;
                             }
@@ -303,10 +392,9 @@ try_again:
                             case 1000: // M1000 is a special command that will pass thru the raw lowercased command to the simpleshell (for hosts that do not allow such things)
                             {
                                 // reconstruct entire command line again
-                                string str= single_command.substr(5) + possible_command;
-                                while(is_whitespace(str.front())){ str= str.substr(1); } // strip leading whitespace
-
-                                delete gcode;
+                                const char *s= single_command + std::min<size_t>(5, single_len);
+                                while(s < end && is_whitespace(*s)) { s++; } // strip leading whitespace
+                                string str(s, end);
 
                                 if(str.empty()) {
                                     SimpleShell::parse_command("help", "", new_message.stream);
@@ -338,7 +426,6 @@ try_again:
                                 // dispatch the M500 here so we can free up the stream when done
                                 THEKERNEL->call_event(ON_GCODE_RECEIVED, gcode );
                                 delete gcode->stream;
-                                delete gcode;
                                 __enable_irq();
                                 new_message.stream->printf("Settings Stored to %s\r\nok\r\n", THEKERNEL->config_override_filename());
                                 continue;
@@ -346,19 +433,17 @@ try_again:
                             case 501: // load config override
                             case 504: // save to specific config override file
                                 {
-                                    string arg= get_arguments(single_command + possible_command); // rest of line is filename
+                                    string arg= get_arguments(string(single_command, end)); // rest of line is filename
                                     if(arg.empty()) arg= "/sd/config-override";
                                     else arg= "/sd/config-override." + arg;
                                     //new_message.stream->printf("args: <%s>\n", arg.c_str());
                                     SimpleShell::parse_command((gcode->m == 501) ? "load_command" : "save_command", arg, new_message.stream);
                                 }
-                                delete gcode;
                                 new_message.stream->printf("ok\r\n");
                                 return;
 
                             case 502: // M502 deletes config-override so everything defaults to what is in config
                                 remove(THEKERNEL->config_override_filename());
-                                delete gcode;
                                 new_message.stream->printf("config override file deleted %s, reboot needed\r\nok\r\n", THEKERNEL->config_override_filename());
                                 continue;
 
@@ -414,7 +499,7 @@ try_again:
                         } else {
                             if(THEKERNEL->is_ok_per_line() || THEKERNEL->is_grbl_mode()) {
                                 // only send ok once per line if this is a multi g code line send ok on the last one
-                                if(possible_command.empty())
+                                if(possible_command == end)
                                     new_message.stream->printf("ok\r\n");
                             } else {
                                 // maybe should do the above for all hosts?
@@ -423,11 +508,9 @@ try_again:
                         }
                     }
 
-                    delete gcode;
-
                 } else {
                     // we are uploading and it is the upload stream so so save it
-                    if(single_command.substr(0, 3) == "M29") {
+                    if(single_len >= 3 && strncmp(single_command, "M29", 3) == 0) {
                         // done uploading, close file
                         fclose(upload_fd);
                         upload_fd = NULL;
@@ -444,8 +527,7 @@ try_again:
                         continue;
                     }
 
-                    single_command.append("\n");
-                    if(fwrite(single_command.c_str(), 1, single_command.size(), upload_fd) != single_command.size()) {
+                    if(fwrite(single_command, 1, single_len, upload_fd) != single_len || fputc('\n', upload_fd) == EOF) {
                         // error writing to file
                         new_message.stream->printf("Error:error writing to file.\r\n");
                         fclose(upload_fd);
@@ -468,7 +550,7 @@ try_again:
         // Ignore comments and blank lines
         new_message.stream->printf("ok\n");
 
-    } else if( (n=possible_command.find_first_of("XYZF")) == 0 || (first_char == ' ' && n != string::npos) ) {
+    } else if( (n=find_first_of(possible_command, end, "XYZF") - possible_command) == 0 || (first_char == ' ' && possible_command + n != end) ) {
         // handle pycam syntax, use last modal group 1 command and resubmit if an X Y Z or F is found on its own line
         char buf[6];
         if(possible_command[n] == 'F') {
@@ -478,7 +560,9 @@ try_again:
             // use last modal command (G1 or G0 etc)
             snprintf(buf, sizeof(buf), "G%d ", modal_group_1);
         }
-        possible_command.insert(0, buf);
+        rewritten_line.assign(buf).append(possible_command, end);
+        possible_command= rewritten_line.c_str();
+        end= possible_command + rewritten_line.size();
         goto try_again;
 
 
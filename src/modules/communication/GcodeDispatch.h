@@ -8,11 +8,13 @@
 #pragma once
 
 #include "libs/Module.h"
+#include "utils/FramedStream.h"
 
 #include <stdio.h>
 #include <string>
 
 class StreamOutput;
+struct SerialMessage;
 
 class GcodeDispatch : public Module
 {
@@ -24,11 +26,20 @@ public:
 
     uint8_t get_modal_command() const { return modal_group_1<4 ? modal_group_1 : 0; }
 private:
+    void on_frame_received(SerialMessage& message);
+    void handle_line(SerialMessage& new_message);
+
     int currentline;
     std::string upload_filename;
     FILE *upload_fd;
     StreamOutput* upload_stream{nullptr};
     uint8_t modal_group_1;
+
+    // framed streaming session, only one stream at a time
+    FramedStream framed_stream;
+    uint8_t frame_seq;      // sequence number expected next
+    uint8_t frame_window;   // Setting : most frames a host may have outstanding
+
     struct {
         bool uploading: 1;
     };
@@ -0,0 +1,60 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FramedStream.h"
+
+#include <string.h>
+
+int FramedStream::puts(const char *str)
+{
+    size_t n = strlen(str);
+    if(stream == nullptr) return n;
+
+    pending.append(str, n);
+
+    // pass on each complete line, other than ok, and the rest of the line after ok
+    size_t pos;
+    while((pos = pending.find('\n')) != std::string::npos) {
+        size_t len = pos;
+        if(len > 0 && pending[len - 1] == '\r') --len;
+
+        if(pending.compare(0, 2, "ok") == 0 && (len == 2 || pending[2] == ' ')) {
+            if(len > 3) {
+                pending[pos] = '\0';
+                stream->printf("%s\n", pending.c_str() + 3);
+            }
+        } else {
+            pending[pos] = '\0';
+            stream->printf("%s\n", pending.c_str());
+        }
+        pending.erase(0, pos + 1);
+    }
+
+    return n;
+}
+
+// send anything left that did not end with a newline
+void FramedStream::flush()
+{
+    if(!pending.empty() && stream != nullptr) {
+        stream->puts(pending.c_str());
+    }
+    pending.clear();
+}
+
+// CRC-16/CCITT-FALSE, polynomial 0x1021 initial value 0xFFFF
+uint16_t FramedStream::crc16(const char *buf, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= (uint8_t)buf[i] << 8;
+        for (int b = 0; b < 8; ++b) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
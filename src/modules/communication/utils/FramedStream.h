@@ -0,0 +1,39 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "StreamOutput.h"
+
+#include <string>
+
+// Framed streaming, a host sends each line as a frame so it does not have to wait for an ok before sending the next one
+//   STX, 2 hex digit sequence number, the line, ETX, 4 hex digit CRC-16/CCITT of the sequence number and the line, NL
+// every frame is answered with "ack <seq> <credits>" once it has been processed, or "nak <seq>" with the sequence number
+// expected next if it was bad, the host then sends everything again from there. credits is how many frames the host may
+// have outstanding, it follows the free space in the block queue. An empty frame with sequence number 0 starts a session.
+#define FRAME_START '\x02'
+#define FRAME_END '\x03'
+
+// The replies to the lines in a frame go through here, the plain oks are dropped as the ack replaces them
+// and everything else is passed through to the stream the frame came from
+class FramedStream : public StreamOutput {
+    public:
+        FramedStream() : stream(nullptr) {}
+
+        void set_stream(StreamOutput *s) { stream = s; }
+        StreamOutput *get_stream() const { return stream; }
+        int puts(const char *str);
+        void flush();
+        bool ready() { return stream == nullptr || stream->ready(); }
+
+        static uint16_t crc16(const char *buf, size_t len);
+
+    private:
+        StreamOutput *stream;
+        std::string pending; // the part of a line that has no newline yet
+};
@@ -10,13 +10,20 @@
 #include "libs/StreamOutput.h"
 #include "utils.h"
 #include <stdlib.h>
+#include <string.h>
 #include <algorithm>
 
 // This is a gcode object. It represents a GCode string/command, and caches some important values about that command for the sake of performance.
 // It gets passed around in events, and attached to the queue ( that'll change )
+// The command is tokenized once when it is set, so looking up the value of a letter does not rescan the string
 Gcode::Gcode(const string &command, StreamOutput *stream, bool strip, unsigned int line)
+    : Gcode(command.c_str(), command.size(), stream, strip, line)
 {
-    this->command= strdup(command.c_str());
+}
+
+Gcode::Gcode(const char *cmd, size_t len, StreamOutput *stream, bool strip, unsigned int line)
+{
+    set_command(cmd, len);
     this->m= 0;
     this->g= 0;
     this->subcode= 0;
@@ -30,61 +37,141 @@ Gcode::Gcode(const string &command, StreamOutput *stream, bool strip, unsigned i
 
 Gcode::~Gcode()
 {
-    if(command != nullptr) {
-        // TODO we can reference count this so we share copies, may save more ram than the extra count we need to store
+    if(command != inline_command) {
         free(command);
     }
 }
 
 Gcode::Gcode(const Gcode &to_copy)
 {
-    this->command               = strdup(to_copy.command); // TODO we can reference count this so we share copies, may save more ram than the extra count we need to store
+    copy_from(to_copy);
+}
+
+Gcode &Gcode::operator= (const Gcode &to_copy)
+{
+    if( this != &to_copy ) {
+        if(command != inline_command) free(command);
+        copy_from(to_copy);
+    }
+    return *this;
+}
+
+void Gcode::copy_from(const Gcode &to_copy)
+{
+    set_command(to_copy.command, strlen(to_copy.command));
     this->has_m                 = to_copy.has_m;
     this->has_g                 = to_copy.has_g;
     this->m                     = to_copy.m;
     this->g                     = to_copy.g;
+    this->line                  = to_copy.line;
     this->subcode               = to_copy.subcode;
     this->add_nl                = to_copy.add_nl;
+    this->stripped              = to_copy.stripped;
     this->is_error              = to_copy.is_error;
     this->stream                = to_copy.stream;
     this->txt_after_ok.assign( to_copy.txt_after_ok );
+
+    // the command is the same so the offsets still apply
+    memcpy(this->values, to_copy.values, sizeof(values));
+    memcpy(this->offsets, to_copy.offsets, sizeof(offsets));
+    this->letters               = to_copy.letters;
+    this->valued                = to_copy.valued;
+    this->args                  = to_copy.args;
+    this->num_args              = to_copy.num_args;
+    this->first_arg             = to_copy.first_arg;
 }
 
-Gcode &Gcode::operator= (const Gcode &to_copy)
+// copy the command, short ones go in the inline buffer so no allocation is needed
+void Gcode::set_command(const char *cmd, size_t len)
 {
-    if( this != &to_copy ) {
-        this->command               = strdup(to_copy.command); // TODO we can reference count this so we share copies, may save more ram than the extra count we need to store
-        this->has_m                 = to_copy.has_m;
-        this->has_g                 = to_copy.has_g;
-        this->m                     = to_copy.m;
-        this->g                     = to_copy.g;
-        this->subcode               = to_copy.subcode;
-        this->add_nl                = to_copy.add_nl;
-        this->is_error              = to_copy.is_error;
-        this->stream                = to_copy.stream;
-        this->txt_after_ok.assign( to_copy.txt_after_ok );
+    if(len < GCODE_INLINE_SIZE) {
+        command= inline_command;
+    }else{
+        command= (char *)malloc(len + 1);
+    }
+    memcpy(command, cmd, len);
+    command[len]= '\0';
+}
+
+// one pass over the command recording which letters are present and the first value each one has
+void Gcode::tokenize()
+{
+    letters= 0;
+    valued= 0;
+    args= 0;
+    num_args= 0;
+    first_arg= 0;
+
+    // a letter straight after the same letter is not looked at for a value, this matches the way a scan for a letter steps over the character after it
+    const char *skip= nullptr;
+    for (const char *cs = command; *cs; cs++) {
+        char c= *cs;
+        if(c < 'A' || c > 'Z') continue;
+
+        uint32_t bit= 1 << (c - 'A');
+        letters |= bit;
+
+        if(c != 'T') {
+            if(cs == command) {
+                first_arg= c;
+            }else{
+                args |= bit;
+                if(num_args < 255) num_args++;
+            }
+        }
+
+        // offsets are 8 bit, anything further in is found by get_value() scanning for it
+        size_t off= cs + 1 - command;
+        if((valued & bit) == 0 && off <= 255 && !(cs == skip && c == cs[-1])) {
+            skip= cs + 1;
+            char *cn;
+            float r= strtof(cs + 1, &cn);
+            if(cn > cs + 1) {
+                valued |= bit;
+                values[c - 'A']= r;
+                offsets[c - 'A']= off;
+            }
+        }
     }
-    return *this;
 }
 
+// returns where the value for the letter starts, nullptr if it is not known from the token table
+const char *Gcode::find_value(char letter) const
+{
+    if(letter < 'A' || letter > 'Z') return nullptr;
+    if((valued & (1 << (letter - 'A'))) == 0) return nullptr;
+    return command + offsets[letter - 'A'];
+}
 
 // Whether or not a Gcode has a letter
 bool Gcode::has_letter( char letter ) const
 {
-    for (size_t i = 0; i < strlen(this->command); ++i) {
-        if( command[i] == letter ) {
-            return true;
-        }
+    if(letter >= 'A' && letter <= 'Z') {
+        return (letters & (1 << (letter - 'A'))) != 0;
     }
-    return false;
+    return strchr(this->command, letter) != nullptr;
 }
 
+// true if the letter can not be in the command at all, so there is no need to scan for it
+#define NOT_PRESENT(letter) (letter >= 'A' && letter <= 'Z' && (letters & (1 << (letter - 'A'))) == 0)
+
 // Retrieve the value for a given letter
 float Gcode::get_value( char letter, char **ptr ) const
 {
-    const char *cs = command;
+    const char *cs = find_value(letter);
+    if(cs != nullptr) {
+        if(ptr != nullptr) strtof(cs, ptr);
+        return values[letter - 'A'];
+    }
+
+    if(NOT_PRESENT(letter)) {
+        if(ptr != nullptr) *ptr= nullptr;
+        return 0;
+    }
+
+    // not in the token table, eg a letter without a value or a value too far into the command
     char *cn = NULL;
-    for (; *cs; cs++) {
+    for (cs = command; *cs; cs++) {
         if( letter == *cs ) {
             cs++;
             float r = strtof(cs, &cn);
@@ -99,9 +186,23 @@ float Gcode::get_value( char letter, char **ptr ) const
 
 int Gcode::get_int( char letter, char **ptr ) const
 {
-    const char *cs = command;
     char *cn = NULL;
-    for (; *cs; cs++) {
+    const char *cs = find_value(letter);
+    if(cs != nullptr) {
+        int r = strtol(cs, &cn, 10);
+        if (cn > cs) {
+            if(ptr != nullptr) *ptr= cn;
+            return r;
+        }
+    }
+
+    if(NOT_PRESENT(letter)) {
+        if(ptr != nullptr) *ptr= nullptr;
+        return 0;
+    }
+
+    // the first value found is not an integer, or not in the token table, so scan for it
+    for (cs = command; *cs; cs++) {
         if( letter == *cs ) {
             cs++;
             int r = strtol(cs, &cn, 10);
@@ -116,9 +217,22 @@ int Gcode::get_int( char letter, char **ptr ) const
 
 uint32_t Gcode::get_uint( char letter, char **ptr ) const
 {
-    const char *cs = command;
     char *cn = NULL;
-    for (; *cs; cs++) {
+    const char *cs = find_value(letter);
+    if(cs != nullptr) {
+        int r = strtoul(cs, &cn, 10);
+        if (cn > cs) {
+            if(ptr != nullptr) *ptr= cn;
+            return r;
+        }
+    }
+
+    if(NOT_PRESENT(letter)) {
+        if(ptr != nullptr) *ptr= nullptr;
+        return 0;
+    }
+
+    for (cs = command; *cs; cs++) {
         if( letter == *cs ) {
             cs++;
             int r = strtoul(cs, &cn, 10);
@@ -133,23 +247,17 @@ uint32_t Gcode::get_uint( char letter, char **ptr ) const
 
 int Gcode::get_num_args() const
 {
-    int count = 0;
-    for(size_t i = stripped?0:1; i < strlen(command); i++) {
-        if( this->command[i] >= 'A' && this->command[i] <= 'Z' ) {
-            if(this->command[i] == 'T') continue;
-            count++;
-        }
-    }
-    return count;
+    return num_args + ((stripped && first_arg != 0) ? 1 : 0);
 }
 
 std::map<char,float> Gcode::get_args() const
 {
     std::map<char,float> m;
-    for(size_t i = stripped?0:1; i < strlen(command); i++) {
-        char c= this->command[i];
-        if( c >= 'A' && c <= 'Z' ) {
-            if(c == 'T') continue;
+    uint32_t a = args;
+    if(stripped && first_arg != 0) a |= 1 << (first_arg - 'A');
+    for (int i = 0; i < 26; ++i) {
+        if(a & (1 << i)) {
+            char c= 'A' + i;
             m[c]= get_value(c);
         }
     }
@@ -159,10 +267,11 @@ std::map<char,float> Gcode::get_args() const
 std::map<char,int> Gcode::get_args_int() const
 {
     std::map<char,int> m;
-    for(size_t i = stripped?0:1; i < strlen(command); i++) {
-        char c= this->command[i];
-        if( c >= 'A' && c <= 'Z' ) {
-            if(c == 'T') continue;
+    uint32_t a = args;
+    if(stripped && first_arg != 0) a |= 1 << (first_arg - 'A');
+    for (int i = 0; i < 26; ++i) {
+        if(a & (1 << i)) {
+            char c= 'A' + i;
             m[c]= get_int(c);
         }
     }
@@ -174,6 +283,8 @@ void Gcode::prepare_cached_values(bool strip)
 {
     char *p= nullptr;
 
+    tokenize();
+
     if( this->has_letter('G') ) {
         this->has_g = true;
         this->g = this->get_int('G', &p);
@@ -205,9 +316,9 @@ void Gcode::prepare_cached_values(bool strip)
 
     // remove the Gxxx or Mxxx from string
     if (p != nullptr) {
-        char *n= strdup(p); // create new string starting at end of the numeric value
-        free(command);
-        command= n;
+        // move the rest of the string down to the start, it is never longer so this is done in place
+        memmove(command, p, strlen(p) + 1);
+        tokenize();
     }
 }
 
@@ -215,15 +326,16 @@ void Gcode::prepare_cached_values(bool strip)
 void Gcode::strip_parameters()
 {
     if(has_g && g < 4){
-        // strip the command of the XYZIJK parameters
-        string newcmd;
+        // strip the command of the XYZIJK parameters, the result is never longer so this is done in place
+        char *out= command;
         char *cn= command;
         // find the start of each parameter
         char *pch= strpbrk(cn, "XYZIJK");
         while (pch != nullptr) {
             if(pch > cn) {
-                // copy non parameters to new string
-                newcmd.append(cn, pch-cn);
+                // copy non parameters down
+                memmove(out, cn, pch-cn);
+                out += pch-cn;
             }
             // find the end of the parameter and its value
             char *eos;
@@ -232,14 +344,11 @@ void Gcode::strip_parameters()
             pch= strpbrk(cn, "XYZIJK"); // find next parameter
         }
         // append anything left on the line
-        newcmd.append(cn);
+        memmove(out, cn, strlen(cn) + 1);
 
         // strip whitespace to save even more, this causes problems so don't do it
         //newcmd.erase(std::remove_if(newcmd.begin(), newcmd.end(), ::isspace), newcmd.end());
 
-        // release the old one
-        free(command);
-        // copy the new shortened one
-        command= strdup(newcmd.c_str());
+        tokenize();
     }
 }
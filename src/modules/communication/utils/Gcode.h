@@ -10,15 +10,21 @@
 #define GCODE_H
 #include <string>
 #include <map>
+#include <stdint.h>
+#include <stddef.h>
 
 using std::string;
 
 class StreamOutput;
 
+// commands shorter than this are held in the Gcode itself, only longer ones are put on the heap
+#define GCODE_INLINE_SIZE 64
+
 // Object to represent a Gcode command
 class Gcode {
     public:
         Gcode(const string&, StreamOutput*, bool strip = true, unsigned int line = 0);
+        Gcode(const char *cmd, size_t len, StreamOutput*, bool strip = true, unsigned int line = 0);
         Gcode(const Gcode& to_copy);
         Gcode& operator= (const Gcode& to_copy);
         ~Gcode();
@@ -52,7 +58,22 @@ class Gcode {
         string txt_after_ok;
 
     private:
+        void set_command(const char *cmd, size_t len);
+        void copy_from(const Gcode& to_copy);
+        void tokenize();
         void prepare_cached_values(bool strip=true);
+        const char *find_value(char letter) const;
+
         char *command;
+        char inline_command[GCODE_INLINE_SIZE];
+
+        // filled in by tokenize() in one pass over the command, indexed by letter - 'A'
+        float values[26];       // value following the first occurrence of the letter that has one
+        uint8_t offsets[26];    // offset of that value in command
+        uint32_t letters;       // letters that appear anywhere in the command
+        uint32_t valued;        // letters that have an entry in values and offsets
+        uint32_t args;          // letters other than T after the first character, these are the arguments when not stripped
+        uint8_t num_args;       // number of those letters including repeats
+        char first_arg;         // the first character if it would be an argument when stripped
 };
 #endif
@@ -36,6 +36,9 @@ double Block::fp_scale= 0;
 Block::Block()
 {
     tick_info= nullptr;
+    jerk_info= nullptr;
+    arc_info= nullptr;
+    raster_info= nullptr;
     line = 0;
     clear();
 }
@@ -59,9 +62,12 @@ void Block::clear()
     entry_speed         = 0.0F;
     exit_speed          = 0.0F;
     acceleration        = 100.0F; // we don't want to get divide by zeroes if this is not set
+    jerk                = 0.0F;
     initial_rate        = 0.0F;
     accelerate_until    = 0;
     decelerate_after    = 0;
+    accel_jerk_ticks    = 0;
+    decel_jerk_ticks    = 0;
     direction_bits      = 0;
     recalculate_flag    = false;
     nominal_length_flag = false;
@@ -69,6 +75,9 @@ void Block::clear()
     is_ticking          = false;
     is_g123             = false;
     locked              = false;
+    s_curve             = false;
+    is_arc              = false;
+    is_raster           = false;
     s_value             = 0.0F;
 
     total_move_ticks= 0;
@@ -95,19 +104,22 @@ void Block::clear()
 
 void Block::debug() const
 {
-    THEKERNEL->streams->printf("%p: steps-X:%lu Y:%lu Z:%lu ", this, this->steps[0], this->steps[1], this->steps[2]);
+    THEKERNEL->streams->printf("%p: steps-X:%lu Y:%lu Z:%lu ", this, (unsigned long)this->steps[0], (unsigned long)this->steps[1], (unsigned long)this->steps[2]);
     for (size_t i = E_AXIS; i < n_actuators; ++i) {
-        THEKERNEL->streams->printf("%c:%lu ", 'A' + i-E_AXIS, this->steps[i]);
+        THEKERNEL->streams->printf("%c:%lu ", (char)('A' + i-E_AXIS), (unsigned long)this->steps[i]);
     }
-    THEKERNEL->streams->printf("(max:%lu) nominal:r%1.4f/s%1.4f mm:%1.4f acc:%1.2f accu:%lu decu:%lu ticks:%lu rates:%1.4f/%1.4f entry/max:%1.4f/%1.4f exit:%1.4f primary:%d ready:%d locked:%d ticking:%d recalc:%d nomlen:%d time:%f\r\n",
-                               this->steps_event_count,
+    THEKERNEL->streams->printf("(max:%lu) nominal:r%1.4f/s%1.4f mm:%1.4f acc:%1.2f jerk:%1.2f/%lu/%lu accu:%lu decu:%lu ticks:%lu rates:%1.4f/%1.4f entry/max:%1.4f/%1.4f exit:%1.4f primary:%d ready:%d locked:%d ticking:%d recalc:%d nomlen:%d time:%f\r\n",
+                               (unsigned long)this->steps_event_count,
                                this->nominal_rate,
                                this->nominal_speed,
                                this->millimeters,
                                this->acceleration,
-                               this->accelerate_until,
-                               this->decelerate_after,
-                               this->total_move_ticks,
+                               this->jerk,
+                               (unsigned long)this->accel_jerk_ticks,
+                               (unsigned long)this->decel_jerk_ticks,
+                               (unsigned long)this->accelerate_until,
+                               (unsigned long)this->decelerate_after,
+                               (unsigned long)this->total_move_ticks,
                                this->initial_rate,
                                this->maximum_rate,
                                this->entry_speed,
@@ -138,6 +150,11 @@ void Block::calculate_trapezoid( float entryspeed, float exitspeed )
     // if block is currently executing, don't touch anything!
     if (is_ticking) return;
 
+    if(this->jerk > 0.0F) {
+        calculate_s_curve(entryspeed, exitspeed);
+        return;
+    }
+
     float initial_rate = this->nominal_rate * (entryspeed / this->nominal_speed); // steps/sec
     float final_rate = this->nominal_rate * (exitspeed / this->nominal_speed);
     //printf("Initial rate: %f, final_rate: %f\n", initial_rate, final_rate);
@@ -216,6 +233,10 @@ void Block::calculate_trapezoid( float entryspeed, float exitspeed )
     // Theorically, if accel is done per tick, the speed curve should be perfect.
     this->total_move_ticks = total_move_ticks;
 
+    this->accel_jerk_ticks = 0;
+    this->decel_jerk_ticks = 0;
+    this->s_curve = false;
+
     this->initial_rate = initial_rate;
     this->exit_speed = exitspeed;
 
@@ -225,11 +246,130 @@ void Block::calculate_trapezoid( float entryspeed, float exitspeed )
     this->locked= false;
 }
 
+// With a jerk set each ramp is jerk up, constant acceleration, jerk down, and neither the peak acceleration nor the jerk
+// go over the settings. The ramps take longer than a trapezoid's for the same speed change, the planner allows for that
+// in max_allowable_speed() so the entry and exit speeds can be reached, here the plateau is shortened or lowered to fit
+void Block::calculate_s_curve(float entryspeed, float exitspeed)
+{
+    // the highest speed the block can reach and still fit both ramps, the planner made sure the higher of the entry and
+    // exit speeds fits so it is found between that and the nominal speed
+    float maximum_speed = this->nominal_speed;
+    if(ramp_millimeters(entryspeed, maximum_speed) + ramp_millimeters(exitspeed, maximum_speed) > this->millimeters) {
+        float lo = std::max(entryspeed, exitspeed), hi = maximum_speed;
+        for (int i = 0; i < 16; ++i) {
+            float v = (lo + hi) / 2.0F;
+            if(ramp_millimeters(entryspeed, v) + ramp_millimeters(exitspeed, v) > this->millimeters) hi = v;
+            else lo = v;
+        }
+        maximum_speed = lo;
+    }
+
+    float time_to_accelerate = ramp_time(maximum_speed - entryspeed);
+    float time_to_decelerate = ramp_time(maximum_speed - exitspeed);
+    float plateau_distance = this->millimeters - ramp_millimeters(entryspeed, maximum_speed) - ramp_millimeters(exitspeed, maximum_speed);
+    float plateau_time = (plateau_distance > 0.0F) ? plateau_distance / maximum_speed : 0.0F;
+
+    float steps_per_mm = this->nominal_rate / this->nominal_speed;
+    float initial_rate = entryspeed * steps_per_mm; // steps/sec
+    float final_rate = exitspeed * steps_per_mm;
+    this->maximum_rate = maximum_speed * steps_per_mm;
+
+    // the ramps are rounded up to an even number of ticks, and a tick longer, so the jerk phases can be rounded up
+    // to whole ticks and still keep the acceleration and the jerk within the settings
+    uint32_t acceleration_ticks = (time_to_accelerate > 0.0F) ? 2 * (uint32_t)ceilf((time_to_accelerate * STEP_TICKER_FREQUENCY + 1.0F) / 2.0F) : 0;
+    uint32_t deceleration_ticks = (time_to_decelerate > 0.0F) ? 2 * (uint32_t)ceilf((time_to_decelerate * STEP_TICKER_FREQUENCY + 1.0F) / 2.0F) : 0;
+    uint32_t total_move_ticks = acceleration_ticks + deceleration_ticks + (uint32_t)floorf(plateau_time * STEP_TICKER_FREQUENCY);
+
+    // the average acceleration over each ramp, prepare() works out the jerk from it and the jerk phases
+    float acceleration_in_steps = (acceleration_ticks > 0) ? (this->maximum_rate - initial_rate) * STEP_TICKER_FREQUENCY / acceleration_ticks : 0;
+    float deceleration_in_steps = (deceleration_ticks > 0) ? (this->maximum_rate - final_rate) * STEP_TICKER_FREQUENCY / deceleration_ticks : 0;
+
+    float jerk_per_second = this->jerk * steps_per_mm; // steps/s³
+
+    // see calculate_trapezoid() for why this is locked
+    this->locked= true;
+    this->accelerate_until = acceleration_ticks;
+    this->decelerate_after = total_move_ticks - deceleration_ticks;
+    this->total_move_ticks = total_move_ticks;
+    this->accel_jerk_ticks = jerk_ticks(this->maximum_rate - initial_rate, acceleration_ticks, jerk_per_second);
+    this->decel_jerk_ticks = jerk_ticks(this->maximum_rate - final_rate, deceleration_ticks, jerk_per_second);
+    this->s_curve = (this->accel_jerk_ticks != 0 || this->decel_jerk_ticks != 0);
+
+    this->initial_rate = initial_rate;
+    this->exit_speed = exitspeed;
+
+    this->prepare(acceleration_in_steps, deceleration_in_steps);
+
+    this->locked= false;
+}
+
+// the time in seconds a ramp takes to change the speed by speed_change (mm/s) within the acceleration and the jerk.
+// if the speed change is too small to reach the full acceleration the ramp is just the two jerk phases
+float Block::ramp_time(float speed_change) const
+{
+    if(speed_change <= 0.0F) return 0.0F;
+    if(this->jerk <= 0.0F) return speed_change / this->acceleration;
+
+    if(speed_change >= this->acceleration * this->acceleration / this->jerk) {
+        return (speed_change / this->acceleration) + (this->acceleration / this->jerk);
+    }
+    return 2.0F * sqrtf(speed_change / this->jerk);
+}
+
+// the distance in mm a ramp between the two speeds takes, the S-curve is point symmetric so it covers the same
+// distance as going at the mean speed for the time of the ramp
+float Block::ramp_millimeters(float speed_a, float speed_b) const
+{
+    return (speed_a + speed_b) / 2.0F * ramp_time(fabsf(speed_b - speed_a));
+}
+
+// Returns how many ticks each jerk phase of a ramp takes to change the rate by rate_change (steps/sec) in ramp_ticks
+// The peak acceleration a has to satisfy a²/jerk - a*t + rate_change = 0 for the ramp to take t seconds,
+// if there is no solution the jerk is too low to reach a constant acceleration and the ramp is all jerk phases.
+// The jerk phases are rounded up, a longer jerk phase lowers the jerk and the ramp is long enough that the
+// acceleration still stays under the setting
+uint32_t Block::jerk_ticks(float rate_change, uint32_t ramp_ticks, float jerk_per_second) const
+{
+    if(ramp_ticks < 2 || rate_change <= 0.0F) return 0;
+
+    float ramp_time = ramp_ticks / STEP_TICKER_FREQUENCY;
+    float d = (ramp_time * ramp_time) - (4.0F * rate_change / jerk_per_second);
+    float jerk_time = (d > 0.0F) ? (ramp_time - sqrtf(d)) / 2.0F : ramp_time / 2.0F;
+
+    uint32_t ticks = ceilf(jerk_time * STEP_TICKER_FREQUENCY);
+    if(ticks < 1) ticks = 1;
+    if(ticks > ramp_ticks / 2) ticks = ramp_ticks / 2;
+    return ticks;
+}
+
 // Calculates the maximum allowable speed at this point when you must be able to reach target_velocity using the
 // acceleration within the allotted distance.
-float Block::max_allowable_speed(float acceleration, float target_velocity, float distance)
+float Block::max_allowable_speed(float acceleration, float target_velocity, float distance) const
 {
-    return sqrtf(target_velocity * target_velocity - 2.0F * acceleration * distance);
+    if(this->jerk <= 0.0F) return sqrtf(target_velocity * target_velocity - 2.0F * acceleration * distance);
+    if(distance <= 0.0F) return target_velocity;
+
+    // an S-curve ramp from target_velocity up by dv is (2 * target_velocity + dv) / 2 * ramp_time(dv) long,
+    // solved for dv in whichever form ramp_time() takes, both are rearranged so nothing cancels at high speeds
+    float a = -acceleration;
+    float j = this->jerk;
+    float v = target_velocity;
+    float dv;
+    if(distance >= (2.0F * v + (a * a / j)) * a / j) {
+        // the full acceleration is reached: dv²/a + dv * (2v/a + a/j) + 2va/j - 2 * distance = 0
+        float b = (2.0F * v / a) + (a / j);
+        float c = (2.0F * v * a / j) - (2.0F * distance);
+        dv = -2.0F * c / (b + sqrtf((b * b) - (4.0F * c / a)));
+    } else {
+        // only the jerk phases: s³ + 2v * s - distance * sqrt(j) = 0 with s = sqrt(dv), by Cardano's formula
+        float p = 2.0F * v;
+        float q = distance * sqrtf(j);
+        float w = cbrtf((q / 2.0F) + sqrtf((q * q / 4.0F) + (p * p * p / 27.0F)));
+        float u = p / (3.0F * w);
+        float s = q / ((w * w) + (w * u) + (u * u));
+        dv = s * s;
+    }
+    return v + dv;
 }
 
 // Called by Planner::recalculate() when scanning the plan from last to first entry.
@@ -317,6 +457,28 @@ void Block::prepare(float acceleration_in_steps, float deceleration_in_steps)
     double acceleration_per_tick = acceleration_in_steps * fp_scale; // this is now scaled to fit a 2.30 fixed point number
     double deceleration_per_tick = deceleration_in_steps * fp_scale;
 
+    // for an S-curve ramp of N ticks with jerk phases of k ticks the acceleration_change goes up by the jerk each tick
+    // for k ticks, holds for N-2k and comes back down for k, this gives the same speed change as the linear ramp when
+    // jerk = acceleration * N / ((N-k) * k)
+    double accel_jerk_per_tick = 0;
+    double decel_jerk_per_tick = 0;
+    if(this->accel_jerk_ticks != 0) {
+        uint32_t n = this->accelerate_until;
+        accel_jerk_per_tick = acceleration_per_tick * n / ((double)(n - this->accel_jerk_ticks) * this->accel_jerk_ticks);
+    }
+    if(this->decel_jerk_ticks != 0) {
+        uint32_t n = this->total_move_ticks - this->decelerate_after;
+        decel_jerk_per_tick = deceleration_per_tick * n / ((double)(n - this->decel_jerk_ticks) * this->decel_jerk_ticks);
+    }
+
+    if(this->s_curve && jerk_info == nullptr) {
+        // we create this once for this block, and only if it is ever used for an S-curve
+        jerk_info= new jerkinfo_t[n_actuators];
+        if(jerk_info == nullptr) {
+            __debugbreak();
+        }
+    }
+
     for (uint8_t m = 0; m < n_actuators; m++) {
         uint32_t steps = this->steps[m];
         this->tick_info[m].steps_to_move = steps;
@@ -349,6 +511,19 @@ void Block::prepare(float acceleration_in_steps, float deceleration_in_steps)
         this->tick_info[m].deceleration_change= -(int64_t)round(deceleration_per_tick * aratio);
         this->tick_info[m].plateau_rate= (int64_t)round(((this->maximum_rate * aratio) / STEP_TICKER_FREQUENCY) * STEPTICKER_FPSCALE);
 
+        if(this->s_curve) {
+            // an S-curve ramp starts with no acceleration and stepticker builds it up from the jerk
+            if(this->accel_jerk_ticks != 0 && this->accelerate_until != 0) {
+                this->tick_info[m].acceleration_change= 0;
+            }
+            if(this->decel_jerk_ticks != 0) {
+                if(this->accelerate_until == 0 && this->decelerate_after == 0) this->tick_info[m].acceleration_change= 0;
+                this->tick_info[m].deceleration_change= 0;
+            }
+            this->jerk_info[m].accel_jerk= (int64_t)round(accel_jerk_per_tick * aratio);
+            this->jerk_info[m].decel_jerk= (int64_t)round(decel_jerk_per_tick * aratio);
+        }
+
         #if 0
         THEKERNEL->streams->printf("spt: %08lX %08lX, ac: %08lX %08lX, dc: %08lX %08lX, pr: %08lX %08lX\n",
             (uint32_t)(this->tick_info[m].steps_per_tick>>32), // 2.62 fixed point
@@ -362,11 +537,88 @@ void Block::prepare(float acceleration_in_steps, float deceleration_in_steps)
         );
         #endif
     }
+
+    if(this->is_arc) {
+        // the plane motors of an arc may change direction, so they just keep going until the last segment of the block is done
+        for (int i = 0; i < 2; ++i) {
+            uint8_t m = this->arc_info->motor[i];
+            this->tick_info[m].steps_to_move = UINT32_MAX;
+            this->tick_info[m].step_count = 0;
+        }
+    }
+}
+
+// returns the tick at which stepticker moves to the given jerk phase of an S-curve block
+// phases 0-3 are the acceleration ramp and 4-6 the deceleration ramp, each is jerk up, hold, jerk down, then 3 holds
+// the plateau and 7 keeps decelerating should the block run past its last tick.
+// a linear ramp has no jerk phases so these ticks are all the same and its acceleration_change is left alone
+uint32_t Block::get_jerk_event_tick(uint8_t phase) const
+{
+    // the deceleration starts on the tick after decelerate_after, unless the block starts off decelerating
+    uint32_t decel_start = (decelerate_after == 0) ? 0 : decelerate_after + 1;
+    uint32_t decel_ticks = total_move_ticks - decelerate_after;
+
+    switch(phase) {
+        case 0: return 0;
+        case 1: return accel_jerk_ticks;
+        case 2: return accelerate_until - accel_jerk_ticks;
+        case 3: return accelerate_until;
+        case 4: return decel_start;
+        case 5: return decel_start + decel_jerk_ticks;
+        case 6: return decel_start + decel_ticks - decel_jerk_ticks;
+        case 7: return decel_start + decel_ticks;
+    }
+    return UINT32_MAX;
+}
+
+// distance in steps covered u ticks into a ramp of n ticks going from va to vb steps/tick, k is the length of the jerk phases
+// at each end of an S-curve ramp or 0 for a linear one. The S-curve is point symmetric so it covers the same distance overall
+static float ramp_distance(float u, float n, float k, float va, float vb)
+{
+    if(k == 0) return (va * u) + ((vb - va) * u * u / (2.0F * n));
+
+    float a = (vb - va) / (n - k); // the acceleration reached after the first jerk phase
+    if(u <= k) return (va * u) + (a * u * u * u / (6.0F * k));
+
+    if(u <= n - k) {
+        float d = u - k;
+        return (va * k) + (a * k * k / 6.0F) + ((va + a * k / 2.0F) * d) + (a * d * d / 2.0F);
+    }
+
+    // the last jerk phase mirrors the first one, take what is left to go off the total
+    float r = n - u;
+    return ((va + vb) / 2.0F * n) - ((vb * r) - (a * r * r * r / (6.0F * k)));
+}
+
+// returns how many steps the longest axis has moved at the given tick of this block, following the same profile stepticker would
+// used to cut the block into segments when segmented_stepping is enabled
+float Block::steps_at_tick(uint32_t tick) const
+{
+    float initial = this->initial_rate / STEP_TICKER_FREQUENCY; // steps/tick
+    float maximum = this->maximum_rate / STEP_TICKER_FREQUENCY;
+    float final = (this->nominal_speed > 0.0F) ? (this->nominal_rate * (this->exit_speed / this->nominal_speed)) / STEP_TICKER_FREQUENCY : 0.0F;
+
+    if(tick <= this->accelerate_until) {
+        return ramp_distance(tick, this->accelerate_until, this->accel_jerk_ticks, initial, maximum);
+    }
+
+    float s = (initial + maximum) / 2.0F * this->accelerate_until;
+    if(tick <= this->decelerate_after) {
+        return s + maximum * (tick - this->accelerate_until);
+    }
+
+    s += maximum * (this->decelerate_after - this->accelerate_until);
+    return s + ramp_distance(tick - this->decelerate_after, this->total_move_ticks - this->decelerate_after, this->decel_jerk_ticks, maximum, final);
 }
 
 // returns current rate (steps/sec) for the given actuator
 float Block::get_trapezoid_rate(int i) const
 {
+    if(THEKERNEL->step_ticker->is_segmented()) {
+        // the segment being stepped only has the rate for the longest axis, scale it for this actuator
+        return THEKERNEL->step_ticker->get_segment_rate() * this->steps[i] / this->steps_event_count;
+    }
+
     // convert steps per tick from fixed point to float and convert to steps/sec
     // FIXME steps_per_tick can change at any time, potential race condition if it changes while being read here
     return STEPTICKER_FROMFP(tick_info[i].steps_per_tick) * STEP_TICKER_FREQUENCY;
@@ -10,6 +10,9 @@
 #include <bitset>
 #include "ActuatorCoordinates.h"
 
+// the most pixels one raster scanline block can carry, as two hex digits each they fit in a console line
+#define BLOCK_RASTER_MAX_PIXELS 100
+
 class Block {
     public:
         Block();
@@ -25,10 +28,16 @@ class Block {
         void ready() { is_ready= true; }
         void clear();
         float get_trapezoid_rate(int i) const;
+        float max_allowable_speed( float acceleration, float target_velocity, float distance) const;
+        uint32_t get_jerk_event_tick(uint8_t phase) const;
+        float steps_at_tick(uint32_t tick) const;
 
     private:
-        float max_allowable_speed( float acceleration, float target_velocity, float distance);
+        void calculate_s_curve(float entry_speed, float exit_speed);
+        float ramp_time(float speed_change) const;
+        float ramp_millimeters(float speed_a, float speed_b) const;
         void prepare(float acceleration_in_steps, float deceleration_in_steps);
+        uint32_t jerk_ticks(float rate_change, uint32_t ramp_ticks, float jerk_per_second) const;
 
         static double fp_scale; // optimize to store this as it does not change
 
@@ -41,6 +50,7 @@ class Block {
         float entry_speed;
         float exit_speed;
         float acceleration;       // the acceleration for this block
+        float jerk;               // the jerk for this block in mm/s³, 0 is a plain trapezoid, else acceleration is the peak
         float initial_rate;       // Initial rate in steps per second
         float maximum_rate;
 
@@ -51,6 +61,8 @@ class Block {
         uint32_t accelerate_until;
         uint32_t decelerate_after;
         uint32_t total_move_ticks;
+        uint32_t accel_jerk_ticks; // length of the jerk phases at each end of the acceleration ramp, 0 if it is linear
+        uint32_t decel_jerk_ticks; // length of the jerk phases at each end of the deceleration ramp, 0 if it is linear
         std::bitset<k_max_actuators> direction_bits;     // Direction for each axis in bit form, relative to the direction port's mask
 
         // this is the data needed to determine when each motor needs to be issued a step
@@ -68,6 +80,38 @@ class Block {
         // need info for each active motor
         tickinfo_t *tick_info;
 
+        // the change of acceleration_change per tick during the jerk phases of an S-curve ramp
+        using jerkinfo_t= struct {
+            int64_t accel_jerk; // 2.62 fixed point
+            int64_t decel_jerk; // 2.62 fixed point
+        };
+
+        // only allocated once the block is used for an S-curve
+        jerkinfo_t *jerk_info;
+
+        // a native arc, only queued when segmented stepping, the plane motors follow the arc as it is cut into segments
+        // and the other motors move linearly with the distance along it. steps_event_count is then the steps along the arc
+        using arcinfo_t= struct {
+            float offset[2];          // from the start to the center in mm
+            float angular_travel;     // in radians, positive is counter clockwise
+            float steps_per_mm[2];
+            int32_t end_steps[2];     // from the start to the end, the last segment ends exactly here
+            uint8_t motor[2];         // the motors for the two plane axis
+        };
+
+        // only allocated once the block is used for an arc
+        arcinfo_t *arc_info;
+
+        // a raster scanline, the laser power of each pixel spread evenly along the block
+        using rasterinfo_t= struct {
+            uint8_t power[BLOCK_RASTER_MAX_PIXELS]; // fraction of the S value, 255 is all of it
+            uint8_t pixels;
+            uint8_t motor;            // the motor with the most steps, its step count gives the pixel
+        };
+
+        // only allocated once the block is used for a raster scanline
+        rasterinfo_t *raster_info;
+
         static uint8_t n_actuators;
 
         struct {
@@ -78,6 +122,9 @@ class Block {
             bool is_g123:1;                      // set if this is a G1, G2 or G3
             volatile bool is_ticking:1;          // set when this block is being actively ticked by the stepticker
             volatile bool locked:1;              // set to true when the critical data is being updated, stepticker will have to skip if this is set
+            bool s_curve:1;                      // set if either ramp has jerk phases, stepticker then follows get_jerk_event_tick()
+            bool is_arc:1;                       // set if this is a native arc, arc_info is then valid
+            bool is_raster:1;                    // set if this is a raster scanline, raster_info is then valid
             uint16_t s_value:12;                 // for laser 1.11 Fixed point
         };
 };
@@ -150,6 +150,12 @@ bool BlockQueue::is_empty() const
     return r;
 }
 
+unsigned int BlockQueue::get_count() const
+{
+    unsigned int h = head_i, t = tail_i;
+    return h >= t ? h - t : h + length - t;
+}
+
 /*
  * resize
  */
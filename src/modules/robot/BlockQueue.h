@@ -37,6 +37,8 @@ public:
      */
     bool is_empty(void) const;
     bool is_full(void) const;
+    unsigned int get_count(void) const; // number of blocks queued, not yet freed
+    unsigned int get_length(void) const { return length; }
 
     /*
      * resize
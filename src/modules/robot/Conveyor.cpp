@@ -22,13 +22,21 @@
 #include "StepTicker.h"
 #include "Robot.h"
 #include "StepperMotor.h"
+#include "StreamOutput.h"
 
 #include <functional>
+#include <algorithm>
+#include <math.h>
 
 #include "mbed.h"
 
 #define planner_queue_size_checksum CHECKSUM("planner_queue_size")
 #define queue_delay_time_ms_checksum CHECKSUM("queue_delay_time_ms")
+#define queue_delay_adaptive_checksum CHECKSUM("queue_delay_adaptive")
+#define queue_delay_min_ms_checksum CHECKSUM("queue_delay_min_ms")
+#define queue_delay_max_ms_checksum CHECKSUM("queue_delay_max_ms")
+#define segmented_stepping_checksum CHECKSUM("segmented_stepping")
+#define step_segment_time_ms_checksum CHECKSUM("step_segment_time_ms")
 
 /*
  * The conveyor holds the queue of blocks, takes care of creating them, and starting the executing chain of blocks
@@ -63,6 +71,9 @@ Conveyor::Conveyor()
     running = false;
     allow_fetch = false;
     flush= false;
+    segmented= false;
+    adaptive_delay= false;
+    synced= false;
 }
 
 void Conveyor::on_module_loaded()
@@ -74,6 +85,18 @@ void Conveyor::on_module_loaded()
     //THEKERNEL->step_ticker->finished_fnc = std::bind( &Conveyor::all_moves_finished, this);
     queue_size = THEKERNEL->config->value(planner_queue_size_checksum)->by_default(32)->as_number();
     queue_delay_time_ms = THEKERNEL->config->value(queue_delay_time_ms_checksum)->by_default(100)->as_number();
+
+    // let the delay follow how fast the queue refills, starting from queue_delay_time_ms
+    adaptive_delay = THEKERNEL->config->value(queue_delay_adaptive_checksum)->by_default(false)->as_bool();
+    queue_delay_min_ms = THEKERNEL->config->value(queue_delay_min_ms_checksum)->by_default(10)->as_number();
+    queue_delay_max_ms = THEKERNEL->config->value(queue_delay_max_ms_checksum)->by_default(1000)->as_number();
+    if(queue_delay_max_ms < queue_delay_min_ms) queue_delay_max_ms = queue_delay_min_ms;
+
+    // instead of working out each motors rate on every tick stepticker can step short constant rate segments made here
+    segmented = THEKERNEL->config->value(segmented_stepping_checksum)->by_default(false)->as_bool();
+    float segment_time_ms = THEKERNEL->config->value(step_segment_time_ms_checksum)->by_default(1.0F)->as_number();
+    segment_ticks = std::max(1.0F, floorf(segment_time_ms * THEKERNEL->step_ticker->get_frequency() / 1000.0F));
+    segment_ahead = std::min<uint32_t>(STEP_SEGMENT_QUEUE_SIZE / 2, std::max(2.0F, ceilf(STEP_SEGMENT_AHEAD_MS / segment_time_ms)));
 }
 
 // we allocate the queue here after config is completed so we do not run out of memory during config
@@ -81,6 +104,14 @@ void Conveyor::start(uint8_t n)
 {
     Block::init(n); // set the number of motors which determines how big the tick info vector is
     queue.resize(queue_size);
+
+    if(segmented) {
+        segments = new TSRingBuffer<StepSegment, STEP_SEGMENT_QUEUE_SIZE>();
+        segment_block_i = queue.head_i;
+        THEKERNEL->step_ticker->set_segmented(true);
+    }
+
+    last_time_check = us_ticker_read();
     running = true;
 }
 
@@ -109,6 +140,10 @@ void Conveyor::on_idle(void*)
             queue.consume_tail();
         }
     }
+
+    if (segmented && !flush && !THEKERNEL->is_halted()) {
+        fill_segments();
+    }
 }
 
 // see if we are idle
@@ -129,6 +164,9 @@ bool Conveyor::is_idle() const
 // Wait for the queue to be empty and for all the jobs to finish in step ticker
 void Conveyor::wait_for_idle(bool wait_for_motors)
 {
+    // a blended move still held back by the robot has to be queued before it can be waited for
+    THEROBOT->flush_blend();
+
     // wait for the job queue to empty, this means cycling everything on the block queue into the job queue
     // forcing them to be jobs
     running = false; // stops on_idle calling check_queue
@@ -144,6 +182,7 @@ void Conveyor::wait_for_idle(bool wait_for_motors)
         }
     }
 
+    synced = true;
     running = true;
     // returning now means that everything has totally finished
 }
@@ -166,6 +205,26 @@ void Conveyor::queue_head_block()
         return; // if we got a halt then we are done here
     }
 
+    // the block arrived after stepticker had run out of blocks
+    if(ran_dry) {
+        ran_dry = false;
+        if(dry_while_fed && !synced) {
+            // the queue ran dry while the job was still sending blocks, so it was starved rather than finished
+            ++underruns;
+            empty_us += us_ticker_read() - empty_since;
+            if(adaptive_delay) {
+                // the blocks are being used up faster than they arrive, so wait for more of them before starting again
+                queue_delay_time_ms = std::min(queue_delay_max_ms, queue_delay_time_ms + queue_delay_time_ms / 2 + 1);
+            }
+        }
+        if(adaptive_delay) {
+            // nothing is left to fetch, start over with the delay so the queue gets a chance to fill up again
+            allow_fetch = false;
+            last_time_check = us_ticker_read();
+        }
+    }
+    synced = false;
+
     queue.produce_head();
 
     // not sure if this is the correct place but we need to turn on the motors if they were not already on
@@ -174,8 +233,6 @@ void Conveyor::queue_head_block()
 
 void Conveyor::check_queue(bool force)
 {
-    static uint32_t last_time_check = us_ticker_read();
-
     if(queue.is_empty()) {
         allow_fetch = false;
         last_time_check = us_ticker_read(); // reset timeout
@@ -184,13 +241,46 @@ void Conveyor::check_queue(bool force)
 
     // if we have been waiting for more than the required waiting time and the queue is not empty, or the queue is full, then allow stepticker to get the tail
     // we do this to allow an idle system to pre load the queue a bit so the first few blocks run smoothly.
-    if(force || queue.is_full() || (us_ticker_read() - last_time_check) >= (queue_delay_time_ms * 1000)) {
+    uint32_t waited = us_ticker_read() - last_time_check;
+    if(force || queue.is_full() || waited >= (queue_delay_time_ms * 1000)) {
+        // the queue filled before the delay was up, it refills fast enough that starting sooner will not run it dry
+        if(adaptive_delay && !force && !allow_fetch && waited < queue_delay_time_ms * 1000) {
+            queue_delay_time_ms = std::max(queue_delay_min_ms, (queue_delay_time_ms * 3) / 4);
+        }
         last_time_check = us_ticker_read(); // reset timeout
         if(!flush) allow_fetch = true;
         return;
     }
 }
 
+// how far ahead the planner can see when the block at i starts to be stepped
+void Conveyor::record_fill(unsigned int i)
+{
+    unsigned int n = (queue.head_i + queue.length - i) % queue.length;
+    unsigned int b = (n * CONVEYOR_FILL_HISTOGRAM_SIZE) / queue.length;
+    ++fill_histogram[b < CONVEYOR_FILL_HISTOGRAM_SIZE ? b : CONVEYOR_FILL_HISTOGRAM_SIZE - 1];
+}
+
+void Conveyor::reset_queue_stats()
+{
+    underruns = 0;
+    empty_us = 0;
+    for (auto &h : fill_histogram) h = 0;
+}
+
+void Conveyor::report_queue_stats(StreamOutput *stream) const
+{
+    stream->printf("queue underruns %lu, empty for %1.3f s, delay %lu ms%s\n", (unsigned long)underruns, empty_us / 1000000.0F,
+                   (unsigned long)queue_delay_time_ms, adaptive_delay ? " (adaptive)" : "");
+    stream->printf("blocks queued when a block started, of %u:\n", queue.length - 1);
+    for (int i = 0; i < CONVEYOR_FILL_HISTOGRAM_SIZE; ++i) {
+        unsigned int from = (i * queue.length + CONVEYOR_FILL_HISTOGRAM_SIZE - 1) / CONVEYOR_FILL_HISTOGRAM_SIZE;
+        unsigned int to = ((i + 1) * queue.length + CONVEYOR_FILL_HISTOGRAM_SIZE - 1) / CONVEYOR_FILL_HISTOGRAM_SIZE - 1;
+        if(to >= queue.length) to = queue.length - 1;
+        stream->printf("  %3u-%3u: %lu\n", from, to, (unsigned long)fill_histogram[i]);
+    }
+}
+
 // called from step ticker ISR
 bool Conveyor::get_next_block(Block **block)
 {
@@ -216,6 +306,7 @@ bool Conveyor::get_next_block(Block **block)
 
         b->is_ticking= true;
         b->recalculate_flag= false;
+        record_fill(queue.isr_tail_i);
         this->current_feedrate= b->nominal_speed;
         *block= b;
         return true;
@@ -224,11 +315,149 @@ bool Conveyor::get_next_block(Block **block)
     return false;
 }
 
+// called from step ticker ISR when segmented, returns the next segment to step
+bool Conveyor::get_next_segment(StepSegment &segment)
+{
+    if (flush) {
+        // drop whatever was cut into segments and mark entire queue for GC, fill_segments() is not called while flushing
+        while (segments->get(segment)) ;
+        while (queue.isr_tail_i != queue.head_i) {
+            queue.isr_tail_i = queue.next(queue.isr_tail_i);
+        }
+    }
+
+    if(THEKERNEL->is_halted() || !segments->get(segment)) {
+        this->current_feedrate= 0;
+        return false;
+    }
+
+    this->current_feedrate= segment.block->nominal_speed;
+    return true;
+}
+
+// called in on_idle when segmented, cuts the blocks stepticker is allowed to have into segments until the segment queue is full
+// once a block has been started here it is ticking as far as the planner is concerned and will no longer be changed, so the
+// next block is only started when the stepper is close to needing it and the rest stay with the planner for lookahead
+void Conveyor::fill_segments()
+{
+    while(!segments->full()) {
+        if(segment_block == nullptr) {
+            if(!allow_fetch || segment_block_i == queue.head_i) return;
+            size_t queued= segments->size();
+            if(queued >= segment_ahead) return;
+            // the newest block is planned to stop, while more lines are coming its exit speed can still go up
+            if(queue.next(segment_block_i) == queue.head_i && queued > 1 && (playing || lines_in_hand > 0)) return;
+
+            Block *b= queue.item_ref(segment_block_i);
+            if(b->locked) return;
+            if(!b->is_ready) __debugbreak(); // should never happen
+
+            b->is_ticking= true;
+            b->recalculate_flag= false;
+            record_fill(segment_block_i);
+            segment_block= b;
+            segment_block_i= queue.next(segment_block_i);
+            segment_tick= 0;
+            segment_steps= 0;
+            segment_arc_steps[0]= segment_arc_steps[1]= 0;
+
+        } else if(!segment_block->is_ticking) {
+            // stepticker stopped it early and it has already been cleared
+            segment_block= nullptr;
+            continue;
+        }
+
+        StepSegment seg;
+        seg.block= segment_block;
+        seg.first= (segment_tick == 0 && segment_steps == 0);
+
+        // find the end of this segment, it is made longer if the block is moving too slowly to make a step in one segment time
+        uint32_t total_steps= segment_block->steps_event_count;
+        uint32_t end_tick= segment_tick;
+        uint32_t end_steps;
+        do {
+            end_tick += segment_ticks;
+            if(end_tick >= segment_block->total_move_ticks) {
+                end_tick= segment_block->total_move_ticks;
+                end_steps= total_steps;
+                break;
+            }
+
+            float s= segment_block->steps_at_tick(end_tick);
+            end_steps= (s <= 0) ? 0 : (s >= total_steps) ? total_steps : floorf(s);
+        } while(end_steps <= segment_steps);
+
+        uint32_t ticks= (end_tick > segment_tick) ? end_tick - segment_tick : 1;
+        seg.steps= end_steps - segment_steps;
+        seg.last= (end_steps == total_steps);
+        if(segment_block->is_arc) arc_segment(seg, end_steps);
+
+        // rounded up so the segment never takes longer than the ticks it was given, it is finished by its step count
+        uint64_t rate= (((uint64_t)seg.steps << 32) + ticks - 1) / ticks;
+        seg.rate= (rate > 0xFFFFFFFFULL) ? 0xFFFFFFFF : rate;
+
+        segments->put(seg);
+
+        if(seg.last) {
+            segment_block= nullptr;
+        } else {
+            segment_tick= end_tick;
+            segment_steps= end_steps;
+        }
+    }
+}
+
+// work out how far the plane motors of an arc move in this segment, they are at the point on the arc the same fraction of
+// the way along it as end_steps is of the block, or exactly at its end for the last segment
+void Conveyor::arc_segment(StepSegment &seg, uint32_t end_steps)
+{
+    const Block::arcinfo_t *arc= segment_block->arc_info;
+    int32_t target[2];
+
+    if(seg.last) {
+        target[0]= arc->end_steps[0];
+        target[1]= arc->end_steps[1];
+
+    } else {
+        // rotate the radius vector from the center to the start
+        float theta= arc->angular_travel * end_steps / segment_block->steps_event_count;
+        float cos_t= cosf(theta);
+        float sin_t= sinf(theta);
+        float r0= -arc->offset[0] * cos_t + arc->offset[1] * sin_t;
+        float r1= -arc->offset[0] * sin_t - arc->offset[1] * cos_t;
+        target[0]= lroundf((arc->offset[0] + r0) * arc->steps_per_mm[0]);
+        target[1]= lroundf((arc->offset[1] + r1) * arc->steps_per_mm[1]);
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        int32_t d= target[i] - segment_arc_steps[i];
+        int32_t n= seg.steps;
+        if(d > n || d < -n) {
+            if(seg.last) {
+                // rounding left more steps than the segment has, so stretch it to fit them
+                seg.steps= (d < 0) ? -d : d;
+            } else {
+                // rounding, the rest are made up in the next segment
+                d= (d < 0) ? -n : n;
+            }
+        }
+        seg.arc_steps[i]= d;
+        segment_arc_steps[i] += d;
+    }
+}
+
 // called from step ticker ISR when block is finished, do not do anything slow here
 void Conveyor::block_finished()
 {
     // we increment the isr_tail_i so we can get the next block
     queue.isr_tail_i= queue.next(queue.isr_tail_i);
+
+    if(queue.isr_tail_i == queue.head_i && !flush) {
+        // nothing left to step, queue_head_block() sees if this was an underrun when the next block arrives
+        empty_since= us_ticker_read();
+        dry_while_fed= playing || lines_in_hand > 0;
+        ran_dry= true;
+    }
 }
 
 /*
@@ -248,6 +477,10 @@ void Conveyor::flush_queue()
     // now wait until the block queue has been flushed
     wait_for_idle(false);
 
+    // anything that was being cut into segments is gone
+    segment_block= nullptr;
+    segment_block_i= queue.head_i;
+
     flush= false;
 }
 
@@ -9,8 +9,14 @@
 
 #include "libs/Module.h"
 #include "BlockQueue.h"
+#include "StepSegment.h"
+#include "TSRingBuffer.h"
 
 class Block;
+class StreamOutput;
+
+// buckets in the histogram of how full the queue is when a block starts to be stepped
+#define CONVEYOR_FILL_HISTOGRAM_SIZE 8
 
 class Conveyor : public Module
 {
@@ -25,34 +31,75 @@ public:
     void wait_for_idle(bool wait_for_motors=true);
     bool is_queue_empty() { return queue.is_empty(); };
     bool is_queue_full() { return queue.is_full(); };
+    // how full the block queue is, 0 to 1
+    float get_queue_fill() const { return (float)queue.get_count() / (queue.get_length() - 1); }
+    unsigned int get_free_blocks() const { return queue.get_length() - 1 - queue.get_count(); }
     bool is_idle() const;
 
     // returns next available block writes it to block and returns true
     bool get_next_block(Block **block);
+    bool get_next_segment(StepSegment &segment);
     void block_finished();
+    bool is_flushing() const { return flush; }
 
     void dump_queue(void);
     void flush_queue(void);
     float get_current_feedrate() const { return current_feedrate; }
     void force_queue() { check_queue(true); }
 
+    void report_queue_stats(StreamOutput *stream) const;
+    void reset_queue_stats();
+    // the queue running dry is only an underrun while something is feeding it, a file being played or a line being handled
+    void set_playing(bool p) { playing = p; }
+    void line_started() { ++lines_in_hand; }
+    void line_finished() { --lines_in_hand; }
+
     friend class Planner; // for queue
 
 private:
     void check_queue(bool force= false);
     void queue_head_block(void);
+    void fill_segments(void);
+    void arc_segment(StepSegment &seg, uint32_t end_steps);
+    void record_fill(unsigned int i);
 
     using  Queue_t= BlockQueue;
     Queue_t queue;  // Queue of Blocks
 
     uint32_t queue_delay_time_ms;
+    uint32_t last_time_check;        // when the delay started
+    uint32_t queue_delay_min_ms;     // limits of queue_delay_time_ms when it is adaptive
+    uint32_t queue_delay_max_ms;
     size_t queue_size;
     float current_feedrate{0}; // actual nominal feedrate that current block is running at in mm/sec
 
+    // segmented stepping, blocks are cut into segments in on_idle and handed to stepticker through this queue
+    TSRingBuffer<StepSegment, STEP_SEGMENT_QUEUE_SIZE> *segments{nullptr};
+    Block *segment_block{nullptr};  // block being cut into segments
+    unsigned int segment_block_i{0}; // index of the next block to cut into segments
+    uint32_t segment_tick;           // tick of segment_block the next segment starts at
+    uint32_t segment_steps;          // steps of the longest axis of segment_block already in segments
+    uint32_t segment_ticks;          // length of a segment in ticks
+    uint32_t segment_ahead;          // the next block is only started with fewer than this many segments queued
+    int32_t segment_arc_steps[2];    // steps of the plane motors of an arc already in segments, from the start of the block
+
+    // queue telemetry
+    uint32_t underruns{0};           // times the queue ran dry while a job was still sending blocks
+    uint64_t empty_us{0};            // total time the queue was empty during those underruns
+    volatile uint32_t empty_since;   // when stepticker last ran out of blocks
+    volatile bool ran_dry{false};    // set by stepticker when it runs out of blocks, kept out of the bit fields as it is written in the ISR
+    volatile bool dry_while_fed{false}; // and whether a file or a line was still feeding the queue when it did
+    volatile bool playing{false};    // a file is being played
+    volatile uint8_t lines_in_hand{0}; // console lines being handled, they nest when a command issues more lines
+    uint32_t fill_histogram[CONVEYOR_FILL_HISTOGRAM_SIZE]{};
+
     struct {
         volatile bool running:1;
         volatile bool allow_fetch:1;
         bool flush:1;
+        bool segmented:1;
+        bool adaptive_delay:1;
+        bool synced:1;               // the queue was emptied on purpose by wait_for_idle, so it is not an underrun
     };
 
 };
@@ -28,6 +28,7 @@ using namespace std;
 #define junction_deviation_checksum    CHECKSUM("junction_deviation")
 #define z_junction_deviation_checksum  CHECKSUM("z_junction_deviation")
 #define minimum_planner_speed_checksum CHECKSUM("minimum_planner_speed")
+#define s_curve_jerk_checksum          CHECKSUM("s_curve_jerk")
 
 // The Planner does the acceleration math for the queue of Blocks ( movements ).
 // It makes sure the speed stays within the configured constraints ( acceleration, junction_deviation, etc )
@@ -45,11 +46,12 @@ void Planner::config_load()
     this->junction_deviation = THEKERNEL->config->value(junction_deviation_checksum)->by_default(0.05F)->as_number();
     this->z_junction_deviation = THEKERNEL->config->value(z_junction_deviation_checksum)->by_default(NAN)->as_number(); // disabled by default
     this->minimum_planner_speed = THEKERNEL->config->value(minimum_planner_speed_checksum)->by_default(0.0f)->as_number();
+    this->jerk = THEKERNEL->config->value(s_curve_jerk_checksum)->by_default(0.0F)->as_number(); // 0 disables S-curve ramps
 }
 
 
 // Append a block to the queue, compute it's speed factors
-bool Planner::append_block( ActuatorCoordinates &actuator_pos, uint8_t n_motors, float rate_mm_s, float distance, float *unit_vec, float acceleration, float s_value, bool g123, unsigned int _line)
+bool Planner::append_block( ActuatorCoordinates &actuator_pos, uint8_t n_motors, float rate_mm_s, float distance, float *unit_vec, float acceleration, float s_value, bool g123, unsigned int _line, const Block::arcinfo_t *arc, const float *exit_unit_vec, const Block::rasterinfo_t *raster)
 {
     // Create ( recycle ) a new block
     Block* block = THECONVEYOR->queue.head_ref();
@@ -72,7 +74,8 @@ bool Planner::append_block( ActuatorCoordinates &actuator_pos, uint8_t n_motors,
     }
 
     // sometimes even though there is a detectable movement it turns out there are no steps to be had from such a small move
-    if(!has_steps) {
+    // a full circle has no steps between its start and end but still has to be done
+    if(!has_steps && arc == nullptr) {
         block->clear();
         // we still return true so the tiny move will still be accumulated and eventually create steps
         return true;
@@ -87,7 +90,7 @@ bool Planner::append_block( ActuatorCoordinates &actuator_pos, uint8_t n_motors,
 
     // use either regular junction deviation or z specific and see if a primary axis move
     block->primary_axis = true;
-    if(block->steps[ALPHA_STEPPER] == 0 && block->steps[BETA_STEPPER] == 0) {
+    if(arc == nullptr && block->steps[ALPHA_STEPPER] == 0 && block->steps[BETA_STEPPER] == 0) {
         if(block->steps[GAMMA_STEPPER] != 0) {
             // z only move
             if(!isnan(this->z_junction_deviation)) junction_deviation = this->z_junction_deviation;
@@ -108,11 +111,40 @@ bool Planner::append_block( ActuatorCoordinates &actuator_pos, uint8_t n_motors,
     }
 
     block->acceleration = acceleration; // save in block
+    block->jerk = this->jerk;
 
     // Max number of steps, for all axes
     auto mi = std::max_element(block->steps.begin(), block->steps.end());
     block->steps_event_count = *mi;
 
+    if(arc != nullptr) {
+        if(block->arc_info == nullptr) {
+            // we create this once for this block, and only if it is ever used for an arc
+            block->arc_info= new Block::arcinfo_t;
+        }
+        *block->arc_info = *arc;
+        for (int i = 0; i < 2; ++i) {
+            uint8_t m = arc->motor[i];
+            block->arc_info->end_steps[i] = block->direction_bits[m] ? -(int32_t)block->steps[m] : block->steps[m];
+        }
+        block->is_arc = true;
+
+        // count steps along the arc at the resolution of the finest plane axis, so neither plane motor ever needs more
+        // than one step per step of the arc, the other motors are then spread over the arc just like the shorter axis of a line
+        float spm = std::max(arc->steps_per_mm[0], arc->steps_per_mm[1]);
+        block->steps_event_count = std::max(block->steps_event_count, (uint32_t)ceilf(distance * spm));
+    }
+
+    if(raster != nullptr) {
+        if(block->raster_info == nullptr) {
+            // we create this once for this block, and only if it is ever used for a raster scanline
+            block->raster_info= new Block::rasterinfo_t;
+        }
+        *block->raster_info = *raster;
+        block->raster_info->motor = mi - block->steps.begin();
+        block->is_raster = true;
+    }
+
     block->millimeters = distance;
 
     // Calculate speed in mm/sec for each axis. No divide by zero due to previous checks.
@@ -175,7 +207,7 @@ bool Planner::append_block( ActuatorCoordinates &actuator_pos, uint8_t n_motors,
     block->max_entry_speed = vmax_junction;
 
     // Initialize block entry speed. Compute based on deceleration to user-defined minimum_planner_speed.
-    float v_allowable = max_allowable_speed(-acceleration, minimum_planner_speed, block->millimeters);
+    float v_allowable = block->max_allowable_speed(-acceleration, minimum_planner_speed, block->millimeters);
     block->entry_speed = std::min(vmax_junction, v_allowable);
 
     // Initialize planner efficiency flags
@@ -192,8 +224,10 @@ bool Planner::append_block( ActuatorCoordinates &actuator_pos, uint8_t n_motors,
     // Always calculate trapezoid for new block
     block->recalculate_flag = true;
 
-    // Update previous path unit_vector and nominal speed
-    if(unit_vec != nullptr) {
+    // Update previous path unit_vector and nominal speed, an arc leaves in a different direction from the one it started in
+    if(exit_unit_vec != nullptr) {
+        memcpy(previous_unit_vec, exit_unit_vec, sizeof(previous_unit_vec));
+    } else if(unit_vec != nullptr) {
         memcpy(previous_unit_vec, unit_vec, sizeof(previous_unit_vec)); // previous_unit_vec[] = unit_vec[]
     } else {
         memset(previous_unit_vec, 0, sizeof(previous_unit_vec));
@@ -296,14 +330,3 @@ void Planner::recalculate()
     // which has not had calculate_trapezoid run yet
     current->calculate_trapezoid(current->entry_speed, minimum_planner_speed);
 }
-
-
-// Calculates the maximum allowable speed at this point when you must be able to reach target_velocity using the
-// acceleration within the allotted distance.
-float Planner::max_allowable_speed(float acceleration, float target_velocity, float distance)
-{
-    // Was acceleration*60*60*distance, in case this breaks, but here we prefer to use seconds instead of minutes
-    return(sqrtf(target_velocity * target_velocity - 2.0F * acceleration * distance));
-}
-
-
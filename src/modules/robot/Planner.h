@@ -9,24 +9,24 @@
 #define PLANNER_H
 
 #include "ActuatorCoordinates.h"
-class Block;
+#include "Block.h"
 
 class Planner
 {
 public:
     Planner();
-    float max_allowable_speed( float acceleration, float target_velocity, float distance);
 
-    friend class Robot; // for acceleration, junction deviation, minimum_planner_speed
+    friend class Robot; // for acceleration, junction deviation, minimum_planner_speed, jerk
 
 private:
-    bool append_block(ActuatorCoordinates &target, uint8_t n_motors, float rate_mm_s, float distance, float unit_vec[], float accleration, float s_value, bool g123, unsigned int _line);
+    bool append_block(ActuatorCoordinates &target, uint8_t n_motors, float rate_mm_s, float distance, float unit_vec[], float accleration, float s_value, bool g123, unsigned int _line, const Block::arcinfo_t *arc= nullptr, const float *exit_unit_vec= nullptr, const Block::rasterinfo_t *raster= nullptr);
     void recalculate();
     void config_load();
     float previous_unit_vec[N_PRIMARY_AXIS];
     float junction_deviation;    // Setting
     float z_junction_deviation;  // Setting
     float minimum_planner_speed; // Setting
+    float jerk;                  // Setting, mm/s³ 0 uses a trapezoid
 };
 
 
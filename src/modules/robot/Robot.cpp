@@ -50,6 +50,7 @@
 #define  mm_per_arc_segment_checksum         CHECKSUM("mm_per_arc_segment")
 #define  mm_max_arc_error_checksum           CHECKSUM("mm_max_arc_error")
 #define  arc_correction_checksum             CHECKSUM("arc_correction")
+#define  native_arcs_checksum                CHECKSUM("native_arcs")
 #define  x_axis_max_speed_checksum           CHECKSUM("x_axis_max_speed")
 #define  y_axis_max_speed_checksum           CHECKSUM("y_axis_max_speed")
 #define  z_axis_max_speed_checksum           CHECKSUM("z_axis_max_speed")
@@ -101,6 +102,9 @@
 
 #define PI 3.14159265358979323846F // force to be float, do not use M_PI
 
+// how many segment ends of a cut up line are put through the arm solution in one call
+#define SEGMENT_BATCH 8
+
 //#define DEBUG_PRINTF THEKERNEL->streams->printf
 #define DEBUG_PRINTF(...)
 
@@ -119,12 +123,16 @@ Robot::Robot()
     seconds_per_minute = 60.0F;
     this->clearToolOffset();
     this->compensationTransform = nullptr;
+    this->compensationBoundary = nullptr;
     this->get_e_scale_fnc= nullptr;
     this->wcs_offsets.fill(wcs_t(0.0F, 0.0F, 0.0F));
     this->g92_offset = wcs_t(0.0F, 0.0F, 0.0F);
     this->next_command_is_MCS = false;
     this->disable_segmentation= false;
     this->disable_arm_solution= false;
+    this->blend_pending= false;
+    this->blend_since= 0;
+    this->blend_tolerance= 0;
     this->n_motors= 0;
 }
 
@@ -132,6 +140,7 @@ Robot::Robot()
 void Robot::on_module_loaded()
 {
     this->register_for_event(ON_GCODE_RECEIVED);
+    this->register_for_event(ON_IDLE);
 
     // Configuration
     this->load_config();
@@ -154,6 +163,7 @@ void Robot::load_config()
     // Here we read the config to find out which arm solution to use
     if (this->arm_solution) delete this->arm_solution;
     int solution_checksum = get_checksum(THEKERNEL->config->value(arm_solution_checksum)->by_default("cartesian")->as_string());
+    this->is_cartesian= false;
     // Note checksums are not const expressions when in debug mode, so don't use switch
     if(solution_checksum == hbot_checksum || solution_checksum == corexy_checksum) {
         this->arm_solution = new HBotSolution(THEKERNEL->config);
@@ -175,9 +185,11 @@ void Robot::load_config()
 
     } else if(solution_checksum == cartesian_checksum) {
         this->arm_solution = new CartesianSolution(THEKERNEL->config);
+        this->is_cartesian= true;
 
     } else {
         this->arm_solution = new CartesianSolution(THEKERNEL->config);
+        this->is_cartesian= true;
     }
 
     this->feed_rate           = THEKERNEL->config->value(default_feed_rate_checksum   )->by_default(  100.0F)->as_number();
@@ -187,6 +199,8 @@ void Robot::load_config()
     this->mm_per_arc_segment  = THEKERNEL->config->value(mm_per_arc_segment_checksum  )->by_default(    0.0f)->as_number();
     this->mm_max_arc_error    = THEKERNEL->config->value(mm_max_arc_error_checksum    )->by_default(   0.01f)->as_number();
     this->arc_correction      = THEKERNEL->config->value(arc_correction_checksum      )->by_default(    5   )->as_number();
+    // the step generator can only follow an arc directly if each plane axis is one motor
+    this->native_arcs         = THEKERNEL->config->value(native_arcs_checksum         )->by_default(false )->as_bool() && this->is_cartesian;
 
     // in mm/sec but specified in config as mm/min
     this->max_speeds[X_AXIS]  = THEKERNEL->config->value(x_axis_max_speed_checksum    )->by_default(60000.0F)->as_number() / 60.0F;
@@ -237,7 +251,7 @@ void Robot::load_config()
 
         if(!pins[0].connected() || !pins[1].connected()) { // step and dir must be defined, but enable is optional
             if(a <= Z_AXIS) {
-                THEKERNEL->streams->printf("FATAL: motor %c is not defined in config\n", 'X'+a);
+                THEKERNEL->streams->printf("FATAL: motor %c is not defined in config\n", (char)('X'+a));
                 n_motors= a; // we only have this number of motors
                 return;
             }
@@ -249,7 +263,7 @@ void Robot::load_config()
         uint8_t n= register_motor(sm);
         if(n != a) {
             // this is a fatal error
-            THEKERNEL->streams->printf("FATAL: motor %d does not match index %d\n", n, a);
+            THEKERNEL->streams->printf("FATAL: motor %d does not match index %d\n", n, (int)a);
             return;
         }
 
@@ -457,25 +471,40 @@ void Robot::check_max_actuator_speeds()
         float step_freq = actuators[i]->get_max_rate() * actuators[i]->get_steps_per_mm();
         if (step_freq > THEKERNEL->base_stepping_frequency) {
             actuators[i]->set_max_rate(floorf(THEKERNEL->base_stepping_frequency / actuators[i]->get_steps_per_mm()));
-            THEKERNEL->streams->printf("WARNING: actuator %d rate exceeds base_stepping_frequency * ..._steps_per_mm: %f, setting to %f\n", i, step_freq, actuators[i]->get_max_rate());
+            THEKERNEL->streams->printf("WARNING: actuator %d rate exceeds base_stepping_frequency * ..._steps_per_mm: %f, setting to %f\n", (int)i, step_freq, actuators[i]->get_max_rate());
         }
     }
 }
 
 //A GCode has been received
 //See if the current Gcode line has some orders for us
+// a blended move is held back while the moves after it can be merged into it, once the queue runs dry or no move has come
+// for a while (eg the host is waiting for an ok) there is no point waiting any longer
+void Robot::on_idle(void *argument)
+{
+    if(blend_pending && (THECONVEYOR->is_queue_empty() || us_ticker_read() - blend_since >= BLEND_FLUSH_MS * 1000)) {
+        flush_blend();
+    }
+}
+
 void Robot::on_gcode_received(void *argument)
 {
     Gcode *gcode = static_cast<Gcode *>(argument);
 
     enum MOTION_MODE_T motion_mode= NONE;
 
+    // anything other than a move that can be merged into a pending blended move has to wait for it to be queued
+    if(blend_pending && !is_blendable(gcode)) {
+        flush_blend();
+    }
+
     if( gcode->has_g) {
         switch( gcode->g ) {
             case 0:  motion_mode = SEEK;    break;
             case 1:  motion_mode = LINEAR;  break;
             case 2:  motion_mode = CW_ARC;  break;
             case 3:  motion_mode = CCW_ARC; break;
+            case 7:  motion_mode = RASTER;  break;
             case 4: { // G4 Dwell
                 uint32_t delay_ms = 0;
                 if (gcode->has_letter('P')) {
@@ -562,6 +591,14 @@ void Robot::on_gcode_received(void *argument)
             case 20: this->inch_mode = true;   break;
             case 21: this->inch_mode = false;   break;
 
+            case 61: // G61 exact path, moves are never merged
+                this->blend_tolerance = 0;
+                break;
+
+            case 64: // G64 Pnnn merge moves into one as long as the path stays within nnn of the programmed path, no P is the same as G61
+                this->blend_tolerance = gcode->has_letter('P') ? std::max(0.0F, this->to_millimeters(gcode->get_value('P'))) : 0;
+                break;
+
             case 54: case 55: case 56: case 57: case 58: case 59:
                 // select WCS 0-8: G54..G59, G59.1, G59.2, G59.3
                 current_wcs = gcode->g - 54;
@@ -679,7 +716,7 @@ void Robot::on_gcode_received(void *argument)
                     }
 
                     THEKERNEL->conveyor->wait_for_idle();
-                    THEKERNEL->call_event(ON_ENABLE, (void *)bm);
+                    THEKERNEL->call_event(ON_ENABLE, (void *)(uintptr_t)bm);
                     break;
                 }
                 // fall through
@@ -722,12 +759,12 @@ void Robot::on_gcode_received(void *argument)
             case 203: // M203 Set maximum feedrates in mm/sec, M203.1 set maximum actuator feedrates
                     if(gcode->get_num_args() == 0) {
                         for (size_t i = X_AXIS; i <= Z_AXIS; i++) {
-                            gcode->stream->printf(" %c: %g ", 'X' + i, gcode->subcode == 0 ? this->max_speeds[i] : actuators[i]->get_max_rate());
+                            gcode->stream->printf(" %c: %g ", (char)('X' + i), gcode->subcode == 0 ? this->max_speeds[i] : actuators[i]->get_max_rate());
                         }
                         if(gcode->subcode == 1) {
                             for (size_t i = A_AXIS; i < n_motors; i++) {
                                 if(actuators[i]->is_extruder()) continue; //extruders handle this themselves
-                                gcode->stream->printf(" %c: %g ", 'A' + i - A_AXIS, actuators[i]->get_max_rate());
+                                gcode->stream->printf(" %c: %g ", (char)('A' + i - A_AXIS), actuators[i]->get_max_rate());
                             }
                         }else{
                             gcode->stream->printf(" S: %g ", this->max_speed);
@@ -794,7 +831,7 @@ void Robot::on_gcode_received(void *argument)
                 }
                 break;
 
-            case 205: // M205 Xnnn - set junction deviation, Z - set Z junction deviation, Snnn - Set minimum planner speed
+            case 205: // M205 Xnnn - set junction deviation, Z - set Z junction deviation, Snnn - Set minimum planner speed, Jnnn - set S-curve jerk
                 if (gcode->has_letter('X')) {
                     float jd = gcode->get_value('X');
                     // enforce minimum
@@ -816,6 +853,13 @@ void Robot::on_gcode_received(void *argument)
                         mps = 0.0F;
                     THEKERNEL->planner->minimum_planner_speed = mps;
                 }
+                if (gcode->has_letter('J')) {
+                    float j = gcode->get_value('J');
+                    // enforce minimum, 0 disables S-curve ramps
+                    if (j < 0.0F)
+                        j = 0.0F;
+                    THEKERNEL->planner->jerk = j;
+                }
                 break;
 
             case 211: // M211 Sn turns soft endstops on/off
@@ -877,7 +921,7 @@ void Robot::on_gcode_received(void *argument)
                 }
                 gcode->stream->printf("\n");
 
-                gcode->stream->printf(";X- Junction Deviation, Z- Z junction deviation, S - Minimum Planner speed mm/sec:\nM205 X%1.5f Z%1.5f S%1.5f\n", THEKERNEL->planner->junction_deviation, isnan(THEKERNEL->planner->z_junction_deviation)?-1:THEKERNEL->planner->z_junction_deviation, THEKERNEL->planner->minimum_planner_speed);
+                gcode->stream->printf(";X- Junction Deviation, Z- Z junction deviation, S - Minimum Planner speed mm/sec, J - S-curve jerk mm/sec³:\nM205 X%1.5f Z%1.5f S%1.5f J%1.5f\n", THEKERNEL->planner->junction_deviation, isnan(THEKERNEL->planner->z_junction_deviation)?-1:THEKERNEL->planner->z_junction_deviation, THEKERNEL->planner->minimum_planner_speed, THEKERNEL->planner->jerk);
 
                 gcode->stream->printf(";Max cartesian feedrates in mm/sec:\nM203 X%1.5f Y%1.5f Z%1.5f S%1.5f\n", this->max_speeds[X_AXIS], this->max_speeds[Y_AXIS], this->max_speeds[Z_AXIS], this->max_speed);
 
@@ -1091,7 +1135,11 @@ void Robot::process_move(Gcode *gcode, enum MOTION_MODE_T motion_mode)
             break;
 
         case LINEAR:
-            moved= this->append_line(gcode, target, this->feed_rate / seconds_per_minute, delta_e );
+            if(this->blend_tolerance > 0.0F && is_blendable(gcode)) {
+                moved= this->blend_line(gcode, target, this->feed_rate / seconds_per_minute);
+            } else {
+                moved= this->append_line(gcode, target, this->feed_rate / seconds_per_minute, delta_e );
+            }
             break;
 
         case CW_ARC:
@@ -1099,6 +1147,10 @@ void Robot::process_move(Gcode *gcode, enum MOTION_MODE_T motion_mode)
             // Note arcs are not currently supported by extruder based machines, as 3D slicers do not use arcs (G2/G3)
             moved= this->compute_arc(gcode, offset, target, motion_mode);
             break;
+
+        case RASTER:
+            moved= this->append_raster(gcode, target, this->feed_rate / seconds_per_minute, delta_e);
+            break;
     }
 
     // needed to act as start of next arc command
@@ -1167,6 +1219,9 @@ void Robot::reset_actuator_position(const ActuatorCoordinates &ac)
 // TODO maybe we should only reset axis that are being homed unless this is due to a ON_HALT
 void Robot::reset_position_from_current_actuator_position()
 {
+    // after a halt or abort any blended move that was not queued yet is dropped along with the rest of the queue
+    blend_pending= false;
+
     ActuatorCoordinates actuator_pos;
     for (size_t i = X_AXIS; i < n_motors; i++) {
         // NOTE actuator::current_position is curently NOT the same as actuator::machine_position after an abrupt abort
@@ -1203,17 +1258,19 @@ void Robot::reset_position_from_current_actuator_position()
 // Convert target (in machine coordinates) to machine_position, then convert to actuator position and append this to the planner
 // target is in machine coordinates without the compensation transform, however we save a compensated_machine_position that includes
 // all transforms and is what we actually convert to actuator positions
-bool Robot::append_milestone(const float target[], float rate_mm_s, unsigned int line)
+// if actuator_target is given the target has already been through the compensation transform and that is its actuator position
+bool Robot::append_milestone(const float target[], float rate_mm_s, unsigned int line, const Block::arcinfo_t *arc, const Block::rasterinfo_t *raster, const ActuatorCoordinates *actuator_target)
 {
     float deltas[n_motors];
     float transformed_target[n_motors]; // adjust target for bed compensation
     float unit_vec[N_PRIMARY_AXIS];
+    float exit_unit_vec[N_PRIMARY_AXIS]; // only used by arcs
 
     // unity transform by default
     memcpy(transformed_target, target, n_motors*sizeof(float));
 
     // check function pointer and call if set to transform the target to compensate for bed
-    if(compensationTransform) {
+    if(compensationTransform && actuator_target == nullptr) {
         // some compensation strategies can transform XYZ, some just change Z
         compensationTransform(transformed_target, false);
     }
@@ -1267,11 +1324,11 @@ bool Robot::append_milestone(const float target[], float rate_mm_s, unsigned int
         }
     }
 
-    // nothing moved
-    if(!move) return false;
+    // nothing moved, unless it is a full circle
+    if(!move && arc == nullptr) return false;
 
     // see if this is a primary axis move or not
-    bool auxilliary_move= true;
+    bool auxilliary_move= (arc == nullptr);
     for (int i = 0; i < N_PRIMARY_AXIS; ++i) {
         if(fabsf(deltas[i]) >= 0.00001F) {
             auxilliary_move= false;
@@ -1282,18 +1339,42 @@ bool Robot::append_milestone(const float target[], float rate_mm_s, unsigned int
     // total movement, use XYZ if a primary axis otherwise we calculate distance for E after scaling to mm
     float distance= auxilliary_move ? 0 : sqrtf(sos);
 
+    // an arc moves along its length not the chord
+    float radius= 0, plane_distance= 0;
+    if(arc != nullptr) {
+        radius= hypotf(arc->offset[0], arc->offset[1]);
+        plane_distance= fabsf(arc->angular_travel) * radius;
+        distance= hypotf(plane_distance, deltas[plane_axis_2]);
+    }
+
     // it is unlikely but we need to protect against divide by zero, so ignore insanely small moves here
     // as the last milestone won't be updated we do not actually lose any moves as they will be accounted for in the next move
     if(!auxilliary_move && distance < 0.00001F) return false;
 
     if(!auxilliary_move) {
-         for (size_t i = X_AXIS; i < N_PRIMARY_AXIS; i++) {
+        if(arc != nullptr) {
+            // the junctions are at the tangents to the ends of the arc
+            memset(unit_vec, 0, sizeof(unit_vec));
+            memset(exit_unit_vec, 0, sizeof(exit_unit_vec));
+            float d = (arc->angular_travel < 0 ? -plane_distance : plane_distance) / (radius * distance);
+            float cos_t = cosf(arc->angular_travel);
+            float sin_t = sinf(arc->angular_travel);
+            float r0 = -arc->offset[0], r1 = -arc->offset[1];
+            unit_vec[plane_axis_0] = -r1 * d;
+            unit_vec[plane_axis_1] = r0 * d;
+            exit_unit_vec[plane_axis_0] = -(r0 * sin_t + r1 * cos_t) * d;
+            exit_unit_vec[plane_axis_1] = (r0 * cos_t - r1 * sin_t) * d;
+            unit_vec[plane_axis_2] = exit_unit_vec[plane_axis_2] = deltas[plane_axis_2] / distance;
+        }
+
+        for (size_t i = X_AXIS; i < N_PRIMARY_AXIS; i++) {
             // find distance unit vector for primary axis only
-            unit_vec[i] = deltas[i] / distance;
+            if(arc == nullptr) unit_vec[i] = deltas[i] / distance;
 
             // Do not move faster than the configured cartesian limits for XYZ
             if ( i <= Z_AXIS && max_speeds[i] > 0 ) {
-                float axis_speed = fabsf(unit_vec[i] * rate_mm_s);
+                // somewhere along an arc each plane axis may be moving at the full speed in the plane
+                float axis_speed = (arc != nullptr && i != plane_axis_2) ? plane_distance / distance * rate_mm_s : fabsf(unit_vec[i] * rate_mm_s);
 
                 if (axis_speed > max_speeds[i])
                     rate_mm_s *= ( max_speeds[i] / axis_speed );
@@ -1307,7 +1388,10 @@ bool Robot::append_milestone(const float target[], float rate_mm_s, unsigned int
 
     // find actuator position given the machine position, use actual adjusted target
     ActuatorCoordinates actuator_pos;
-    if(!disable_arm_solution) {
+    if(actuator_target != nullptr) {
+        actuator_pos= *actuator_target;
+
+    }else if(!disable_arm_solution) {
         arm_solution->cartesian_to_actuator( transformed_target, actuator_pos );
 
     }else{
@@ -1350,6 +1434,7 @@ bool Robot::append_milestone(const float target[], float rate_mm_s, unsigned int
     // check per-actuator speed limits
     for (size_t actuator = 0; actuator < n_motors; actuator++) {
         float d = fabsf(actuator_pos[actuator] - actuators[actuator]->get_last_milestone());
+        if(arc != nullptr && (actuator == arc->motor[0] || actuator == arc->motor[1])) d = plane_distance; // assume the worst case
         if(d < 0.00001F || !actuators[actuator]->is_selected()) continue; // no realistic movement for this actuator
 
         float actuator_rate= d * isecs;
@@ -1373,6 +1458,12 @@ bool Robot::append_milestone(const float target[], float rate_mm_s, unsigned int
         }
     }
 
+    if(arc != nullptr) {
+        // limit the centripetal acceleration in the plane to the acceleration
+        float vmax = sqrtf(acceleration * radius) * distance / plane_distance;
+        if(rate_mm_s > vmax) rate_mm_s = vmax;
+    }
+
     // if we are in feed hold wait here until it is released, this means that even segmented lines will pause
     while(THEKERNEL->get_feed_hold()) {
         THEKERNEL->call_event(ON_IDLE, this);
@@ -1383,7 +1474,7 @@ bool Robot::append_milestone(const float target[], float rate_mm_s, unsigned int
     // Append the block to the planner
     // NOTE that distance here should be either the distance travelled by the XYZ axis, or the E mm travel if a solo E move
     // NOTE this call will bock until there is room in the block queue, on_idle will continue to be called
-    if(THEKERNEL->planner->append_block( actuator_pos, n_motors, rate_mm_s, distance, auxilliary_move ? nullptr : unit_vec, acceleration, s_value, is_g123, line)) {
+    if(THEKERNEL->planner->append_block( actuator_pos, n_motors, rate_mm_s, distance, auxilliary_move ? nullptr : unit_vec, acceleration, s_value, is_g123, line, arc, arc != nullptr ? exit_unit_vec : nullptr, raster)) {
         // this is the new compensated machine position
         memcpy(this->compensated_machine_position, transformed_target, n_motors*sizeof(float));
         return true;
@@ -1435,30 +1526,40 @@ bool Robot::append_line(Gcode *gcode, const float target[], float rate_mm_s, flo
     // Find out the distance for this move in XYZ in MCS
     float millimeters_of_travel = sqrtf(powf( target[X_AXIS] - machine_position[X_AXIS], 2 ) +  powf( target[Y_AXIS] - machine_position[Y_AXIS], 2 ) +  powf( target[Z_AXIS] - machine_position[Z_AXIS], 2 ));
 
-    if(millimeters_of_travel < 0.00001F) {
-        // we have no movement in XYZ, probably E only extrude or retract
-        return this->append_milestone(target, rate_mm_s, gcode->line);
-    }
-
     /*
         For extruders, we need to do some extra work to limit the volumetric rate if specified...
         If using volumetric limts we need to be using volumetric extrusion for this to work as Ennn needs to be in mm³ not mm
         We ask Extruder to do all the work but we need to pass in the relevant data.
         NOTE we need to do this before we segment the line (for deltas)
     */
-    if(!isnan(delta_e) && gcode->has_g && gcode->g == 1) {
+    if(millimeters_of_travel >= 0.00001F && !isnan(delta_e) && gcode->has_g && gcode->g == 1) {
         float data[2]= {delta_e, rate_mm_s / millimeters_of_travel};
         if(PublicData::set_value(extruder_checksum, target_checksum, data)) {
             rate_mm_s *= data[1]; // adjust the feedrate
         }
     }
 
+    return append_line(target, rate_mm_s, gcode->line, gcode->has_letter('X') || gcode->has_letter('Y'));
+}
+
+// Append a line from machine_position to target to the queue ( cutting it into segments as needed )
+// xy_move is set if X or Y was given, otherwise segment_z_moves decides if it gets cut up
+bool Robot::append_line(const float target[], float rate_mm_s, unsigned int line, bool xy_move)
+{
+    // Find out the distance for this move in XYZ in MCS
+    float millimeters_of_travel = sqrtf(powf( target[X_AXIS] - machine_position[X_AXIS], 2 ) +  powf( target[Y_AXIS] - machine_position[Y_AXIS], 2 ) +  powf( target[Z_AXIS] - machine_position[Z_AXIS], 2 ));
+
+    if(millimeters_of_travel < 0.00001F) {
+        // we have no movement in XYZ, probably E only extrude or retract
+        return this->append_milestone(target, rate_mm_s, line);
+    }
+
     // We cut the line into smaller segments. This is only needed on a cartesian robot for zgrid, but always necessary for robots with rotational axes like Deltas.
     // In delta robots either mm_per_line_segment can be used OR delta_segments_per_second
     // The latter is more efficient and avoids splitting fast long lines into very small segments, like initial z move to 0, it is what Johanns Marlin delta port does
     uint16_t segments;
 
-    if(this->disable_segmentation || (!segment_z_moves && !gcode->has_letter('X') && !gcode->has_letter('Y'))) {
+    if(this->disable_segmentation || (!segment_z_moves && !xy_move)) {
         segments= 1;
 
     } else if(this->delta_segments_per_second > 1.0F) {
@@ -1470,6 +1571,9 @@ bool Robot::append_line(Gcode *gcode, const float target[], float rate_mm_s, flo
         segments = max(1.0F, ceilf(this->delta_segments_per_second * seconds));
         // TODO if we are only moving in Z on a delta we don't really need to segment at all
 
+    } else if(compensationTransform && compensationBoundary) {
+        segments = 0; // cut where the compensation says, below
+
     } else {
         if(this->mm_per_line_segment == 0.0F) {
             segments = 1; // don't split it up
@@ -1479,7 +1583,23 @@ bool Robot::append_line(Gcode *gcode, const float target[], float rate_mm_s, flo
     }
 
     bool moved= false;
-    if (segments > 1) {
+    if (segments == 0) {
+        // each cut is compensated and put through the arm solution by append_milestone
+        float segment_end[n_motors];
+        float t= 0;
+        for (;;) {
+            float next= compensationBoundary(machine_position, target, t);
+            if(!(next > t && next < 1.0F)) break;
+            t= next;
+
+            if(THEKERNEL->is_halted()) return false; // don't queue any more segments
+
+            for (int j = 0; j < n_motors; j++)
+                segment_end[j] = machine_position[j] + (target[j] - machine_position[j]) * t;
+            if(this->append_milestone(segment_end, rate_mm_s, line)) moved= true;
+        }
+
+    } else if (segments > 1) {
         // A vector to keep track of the endpoint of each segment
         float segment_delta[n_motors];
         float segment_end[n_motors];
@@ -1489,28 +1609,202 @@ bool Robot::append_line(Gcode *gcode, const float target[], float rate_mm_s, flo
         for (int i = 0; i < n_motors; i++)
             segment_delta[i] = (target[i] - machine_position[i]) / segments;
 
+        // the segment ends are compensated and put through the arm solution a batch at a time, so it can share the work between them
+        float transformed[SEGMENT_BATCH][n_motors];
+        float xyz[SEGMENT_BATCH][3];
+        ActuatorCoordinates actuator_pos[SEGMENT_BATCH];
+
         // segment 0 is already done - it's the end point of the previous move so we start at segment 1
         // We always add another point after this loop so we stop at segments-1, ie i < segments
-        for (int i = 1; i < segments; i++) {
-            if(THEKERNEL->is_halted()) return false; // don't queue any more segments
-            for (int j = 0; j < n_motors; j++)
-                segment_end[j] += segment_delta[j];
+        for (int i = 1; i < segments; i += SEGMENT_BATCH) {
+            int n= std::min(SEGMENT_BATCH, segments - i);
+            for (int k = 0; k < n; k++) {
+                for (int j = 0; j < n_motors; j++)
+                    segment_end[j] += segment_delta[j];
+                memcpy(transformed[k], segment_end, n_motors*sizeof(float));
+                if(compensationTransform) compensationTransform(transformed[k], false);
+                memcpy(xyz[k], transformed[k], sizeof(xyz[k]));
+            }
 
-            // Append the end of this segment to the queue
-            // this can block waiting for free block queue or if in feed hold
-            bool b= this->append_milestone(segment_end, rate_mm_s, gcode->line);
-            moved= moved || b;
+            if(!disable_arm_solution) {
+                arm_solution->cartesian_to_actuators(xyz, actuator_pos, n);
+            }else{
+                for (int k = 0; k < n; k++) {
+                    for (int j = X_AXIS; j <= Z_AXIS; j++) actuator_pos[k][j] = xyz[k][j];
+                }
+            }
+
+            for (int k = 0; k < n; k++) {
+                if(THEKERNEL->is_halted()) return false; // don't queue any more segments
+
+                // Append the end of this segment to the queue
+                // this can block waiting for free block queue or if in feed hold
+                bool b= this->append_milestone(transformed[k], rate_mm_s, line, nullptr, nullptr, &actuator_pos[k]);
+                moved= moved || b;
+            }
         }
     }
 
     // Append the end of this full move to the queue
-    if(this->append_milestone(target, rate_mm_s, gcode->line)) moved= true;
+    if(this->append_milestone(target, rate_mm_s, line)) moved= true;
 
     this->next_command_is_MCS = false; // always reset this
 
     return moved;
 }
 
+static int hex_digit(char c)
+{
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// G7 X.. Y.. F.. S.. Dhhhh.. is one raster scanline, a straight move with the laser power set for each pixel along it.
+// each pixel is two lowercase hex digits, 00 is off and ff is the full S value, they are spread evenly over the move.
+// the move is queued as one block so it is not segmented, longer scanlines are sent as several G7 in a row.
+// G7 is modal, a move without pixels is a plain G1
+bool Robot::append_raster(Gcode *gcode, const float target[], float rate_mm_s, float delta_e)
+{
+    const char *p= strchr(gcode->get_command(), 'D');
+    if(p == nullptr) return this->append_line(gcode, target, rate_mm_s, delta_e);
+
+    // the pixels are spread evenly over the steps of one motor, so the actuators must move in a straight line,
+    // and the whole scanline is one block so it could not follow the compensation between grid points
+    if(!this->is_cartesian || compensationTransform) {
+        gcode->is_error= true;
+        gcode->txt_after_ok= (!this->is_cartesian ? "G7 needs cartesian kinematics" : "G7 cannot be used with bed leveling");
+        return false;
+    }
+
+    if(rate_mm_s <= 0.0F) {
+        gcode->is_error= true;
+        gcode->txt_after_ok= (rate_mm_s == 0 ? "Undefined feed rate" : "feed rate < 0");
+        return false;
+    }
+
+    // the pixels are lowercase so they are not taken for parameters when the command is tokenized
+    Block::rasterinfo_t raster;
+    raster.pixels= 0;
+    for (++p; hex_digit(p[0]) >= 0 && hex_digit(p[1]) >= 0; p += 2) {
+        if(raster.pixels == BLOCK_RASTER_MAX_PIXELS) {
+            gcode->is_error= true;
+            gcode->txt_after_ok= "Too many raster pixels";
+            return false;
+        }
+        raster.power[raster.pixels++]= (hex_digit(p[0]) << 4) | hex_digit(p[1]);
+    }
+
+    if(raster.pixels == 0) {
+        gcode->is_error= true;
+        gcode->txt_after_ok= "No raster pixels";
+        return false;
+    }
+
+    this->next_command_is_MCS = false;
+    return this->append_milestone(target, rate_mm_s, gcode->line, nullptr, &raster);
+}
+
+// a G1 that only moves XY and Z at the modal feedrate can be merged with the moves around it
+bool Robot::is_blendable(Gcode *gcode) const
+{
+    if(!gcode->has_g || gcode->g != 1 || gcode->subcode != 0 || next_command_is_MCS) return false;
+    if(gcode->has_letter('S') || gcode->has_letter('E')) return false;
+    #if MAX_ROBOT_ACTUATORS > 3
+    for (int i = A_AXIS; i < n_motors; ++i) {
+        if(gcode->has_letter('A'+i-A_AXIS)) return false;
+    }
+    #endif
+    return gcode->has_letter('X') || gcode->has_letter('Y') || gcode->has_letter('Z');
+}
+
+// distance from p to the line a-b
+static float distance_to_line(const float p[], const float a[], const float b[])
+{
+    float ab[3], ap[3];
+    float ab2 = 0, t = 0;
+    for (int i = 0; i < 3; ++i) {
+        ab[i] = b[i] - a[i];
+        ap[i] = p[i] - a[i];
+        ab2 += ab[i] * ab[i];
+        t += ab[i] * ap[i];
+    }
+
+    t = (ab2 > 0.0F) ? std::min(1.0F, std::max(0.0F, t / ab2)) : 0.0F;
+
+    float d2 = 0;
+    for (int i = 0; i < 3; ++i) {
+        float d = ap[i] - t * ab[i];
+        d2 += d * d;
+    }
+    return sqrtf(d2);
+}
+
+// G64 path blending, the move to target is merged into the pending move if the straight line from the start of the pending move
+// to target passes within blend_tolerance of every point it replaces, otherwise the pending move is queued and this one becomes pending
+bool Robot::blend_line(Gcode *gcode, const float target[], float rate_mm_s)
+{
+    // catch negative or zero feed rates and return the same error as GRBL does
+    if(rate_mm_s <= 0.0F) {
+        flush_blend();
+        return append_line(gcode, target, rate_mm_s, NAN);
+    }
+
+    float millimeters_of_travel = sqrtf(powf( target[X_AXIS] - machine_position[X_AXIS], 2 ) +  powf( target[Y_AXIS] - machine_position[Y_AXIS], 2 ) +  powf( target[Z_AXIS] - machine_position[Z_AXIS], 2 ));
+    if(millimeters_of_travel < 0.00001F) return false;
+
+    if(blend_pending) {
+        bool merge = rate_mm_s == blend_rate && blend_n_points < BLEND_MAX_POINTS;
+        if(merge) {
+            // the end of the pending move becomes one of the points the merged line has to pass
+            merge = distance_to_line(blend_target, blend_start, target) <= blend_tolerance;
+            for (int i = 0; merge && i < blend_n_points; ++i) {
+                merge = distance_to_line(blend_points[i], blend_start, target) <= blend_tolerance;
+            }
+        }
+
+        if(merge) {
+            memcpy(blend_points[blend_n_points++], blend_target, sizeof(blend_points[0]));
+            memcpy(blend_target, target, n_motors*sizeof(float));
+            blend_gcode_line = gcode->line;
+            blend_since = us_ticker_read();
+            return true;
+        }
+
+        flush_blend();
+    }
+
+    // this move is held back in case the next ones can be merged into it
+    memcpy(blend_start, machine_position, sizeof(blend_start));
+    memcpy(blend_target, target, n_motors*sizeof(float));
+    blend_n_points = 0;
+    blend_rate = rate_mm_s;
+    blend_gcode_line = gcode->line;
+    blend_since = us_ticker_read();
+    blend_pending = true;
+    return true;
+}
+
+// queue the pending blended move, machine_position already is its end so is put back to its start while it is added
+void Robot::flush_blend()
+{
+    if(!blend_pending) return;
+    blend_pending = false;
+
+    if(THEKERNEL->is_halted()) return;
+
+    float end[n_motors];
+    memcpy(end, machine_position, n_motors*sizeof(float));
+    memcpy(machine_position, blend_start, sizeof(blend_start));
+
+    bool g123 = is_g123;
+    is_g123 = true;
+    append_line(blend_target, blend_rate, blend_gcode_line, true);
+    is_g123 = g123;
+
+    memcpy(machine_position, end, n_motors*sizeof(float));
+}
+
 
 // Append an arc to the queue ( cutting it into segments as needed )
 // TODO does not support any E parameters so cannot be used for 3D printing.
@@ -1562,6 +1856,29 @@ bool Robot::append_arc(Gcode * gcode, const float target[], const float offset[]
         return false;
     }
 
+    // the step generator can follow the arc itself so it is queued as one block, unless the path has to be compensated, it
+    // needs to be checked against the soft endstops at more than its ends,
+    // or a plane axis is too slow for the feedrate, as the whole arc then has to go at that speed where segments would not
+    bool plane_fast_enough = true;
+    uint8_t plane_axis[2] = {this->plane_axis_0, this->plane_axis_1};
+    for (int i = 0; i < 2; ++i) {
+        uint8_t a = plane_axis[i];
+        if((max_speeds[a] > 0 && rate_mm_s > max_speeds[a]) || rate_mm_s > actuators[a]->get_max_rate()) plane_fast_enough = false;
+    }
+    if(this->native_arcs && THEKERNEL->step_ticker->is_segmented() && !compensationTransform && !disable_arm_solution && plane_fast_enough &&
+       arc_within_soft_endstops(center_axis0, center_axis1, radius, atan2f(r_axis1, r_axis0), angular_travel)) {
+        Block::arcinfo_t arc;
+        // the arc starts from where we actually are, which may differ from arc_milestone by tiny moves that were skipped
+        arc.offset[0] = center_axis0 - this->compensated_machine_position[this->plane_axis_0];
+        arc.offset[1] = center_axis1 - this->compensated_machine_position[this->plane_axis_1];
+        arc.angular_travel = angular_travel;
+        arc.motor[0] = this->plane_axis_0;
+        arc.motor[1] = this->plane_axis_1;
+        arc.steps_per_mm[0] = actuators[this->plane_axis_0]->get_steps_per_mm();
+        arc.steps_per_mm[1] = actuators[this->plane_axis_1]->get_steps_per_mm();
+        return this->append_milestone(target, rate_mm_s, gcode->line, &arc);
+    }
+
     // limit segments by maximum arc error
     float arc_segment = this->mm_per_arc_segment;
     if ((this->mm_max_arc_error > 0) && (2 * radius > this->mm_max_arc_error)) {
@@ -1680,6 +1997,34 @@ bool Robot::compute_arc(Gcode * gcode, const float offset[], const float target[
 }
 
 
+// true if no point on the arc is past a soft endstop of a homed plane axis, the ends are checked when the arc is queued
+// the only points that can be further out than the ends are where the arc crosses one of the axis through its center
+bool Robot::arc_within_soft_endstops(float center0, float center1, float radius, float start_angle, float angular_travel) const
+{
+    if(!soft_endstop_enabled) return true;
+
+    float a0 = std::min(start_angle, start_angle + angular_travel);
+    float a1 = std::max(start_angle, start_angle + angular_travel);
+    for (int k = ceilf(a0 / (PI / 2)); k * (PI / 2) <= a1; ++k) {
+        // the extreme for each quarter turn
+        float p[2] = {center0, center1};
+        switch(k & 3) {
+            case 0: p[0] += radius; break;
+            case 1: p[1] += radius; break;
+            case 2: p[0] -= radius; break;
+            case 3: p[1] -= radius; break;
+        }
+
+        uint8_t axis[2] = {plane_axis_0, plane_axis_1};
+        for (int i = 0; i < 2; ++i) {
+            if(!is_homed(axis[i])) continue;
+            if((!isnan(soft_endstop_min[axis[i]]) && p[i] < soft_endstop_min[axis[i]]) || (!isnan(soft_endstop_max[axis[i]]) && p[i] > soft_endstop_max[axis[i]])) return false;
+        }
+    }
+
+    return true;
+}
+
 float Robot::theta(float x, float y)
 {
     float t = atanf(x / fabs(y));
@@ -18,6 +18,7 @@ using std::string;
 #include "libs/Module.h"
 #include "ActuatorCoordinates.h"
 #include "nuts_bolts.h"
+#include "Block.h"
 
 class Gcode;
 class BaseSolution;
@@ -26,12 +27,18 @@ class StepperMotor;
 // 9 WCS offsets
 #define MAX_WCS 9UL
 
+// most moves that can be merged into one when path blending
+#define BLEND_MAX_POINTS 16
+// how long a blended move waits for another move to be merged into it before it is queued anyway
+#define BLEND_FLUSH_MS 20
+
 class Robot : public Module {
     public:
         using wcs_t= std::tuple<float, float, float>;
         Robot();
         void on_module_loaded();
         void on_gcode_received(void* argument);
+        void on_idle(void* argument);
 
         void reset_axis_position(float position, int axis);
         void reset_axis_position(float x, float y, float z);
@@ -53,6 +60,7 @@ class Robot : public Module {
         void get_axis_position(float position[], size_t n= 3) const { memcpy(position, this->machine_position, n*sizeof(float)); }
         wcs_t get_axis_position() const { return wcs_t(machine_position[X_AXIS], machine_position[Y_AXIS], machine_position[Z_AXIS]); }
         void get_current_machine_position(float *pos) const;
+        void flush_blend();
         void print_position(uint8_t subcode, std::string& buf, bool ignore_extruders=false) const;
         uint8_t get_current_wcs() const { return current_wcs; }
         std::vector<wcs_t> get_wcs_state() const;
@@ -69,6 +77,9 @@ class Robot : public Module {
 
         // set by a leveling strategy to transform the target of a move according to the current plan
         std::function<void(float*, bool)> compensationTransform;
+        // optionally set with it, lines are then only cut where the compensation changes instead of every mm_per_line_segment
+        // given the start and end of a line and a fraction t along it, returns the fraction of the next cut after t, 1 if there are no more
+        std::function<float(const float*, const float*, float)> compensationBoundary;
         // set by an active extruder, returns the amount to scale the E parameter by (to convert mm³ to mm)
         std::function<float(void)> get_e_scale_fnc;
 
@@ -91,6 +102,9 @@ class Robot : public Module {
             bool is_g123:1;
             bool soft_endstop_enabled:1;
             bool soft_endstop_halt:1;
+            bool blend_pending:1;                             // set when there is a blended move that has not been queued yet
+            bool native_arcs:1;                               // Setting : queue arcs as one block when segmented stepping, cartesian only
+            bool is_cartesian:1;                              // the arm solution is cartesian, needed for native arcs and G7
             uint8_t plane_axis_0:2;                           // Current plane ( XY, XZ, YZ )
             uint8_t plane_axis_1:2;
             uint8_t plane_axis_2:2;
@@ -102,14 +116,20 @@ class Robot : public Module {
             SEEK, // G0
             LINEAR, // G1
             CW_ARC, // G2
-            CCW_ARC // G3
+            CCW_ARC, // G3
+            RASTER // G7
         };
 
         void load_config();
-        bool append_milestone(const float target[], float rate_mm_s, unsigned int line);
+        bool append_milestone(const float target[], float rate_mm_s, unsigned int line, const Block::arcinfo_t *arc= nullptr, const Block::rasterinfo_t *raster= nullptr, const ActuatorCoordinates *actuator_target= nullptr);
         bool append_line( Gcode* gcode, const float target[], float rate_mm_s, float delta_e);
+        bool append_line( const float target[], float rate_mm_s, unsigned int line, bool xy_move);
+        bool append_raster(Gcode* gcode, const float target[], float rate_mm_s, float delta_e);
+        bool is_blendable(Gcode* gcode) const;
+        bool blend_line(Gcode* gcode, const float target[], float rate_mm_s);
         bool append_arc( Gcode* gcode, const float target[], const float offset[], float radius, bool is_clockwise );
         bool compute_arc(Gcode* gcode, const float offset[], const float target[], enum MOTION_MODE_T motion_mode);
+        bool arc_within_soft_endstops(float center0, float center1, float radius, float start_angle, float angular_travel) const;
         void process_move(Gcode *gcode, enum MOTION_MODE_T);
         bool is_homed(uint8_t i) const;
 
@@ -141,6 +161,16 @@ class Robot : public Module {
         float s_value;                                       // modal S value
         float arc_milestone[3];                              // used as start of an arc command
 
+        // G64 P path blending, consecutive G1 moves that stay within blend_tolerance of a straight line are queued as one move
+        float blend_tolerance;                               // 0 is exact path (G61)
+        float blend_start[3];                                // start of the pending move
+        float blend_target[k_max_actuators];                 // end of the pending move
+        float blend_points[BLEND_MAX_POINTS][3];             // the ends of the moves that were merged into it
+        uint8_t blend_n_points;
+        float blend_rate;
+        unsigned int blend_gcode_line;
+        uint32_t blend_since;                                // us_ticker_read() when the pending move last changed
+
         // Number of arc generation iterations by small angle approximation before exact arc trajectory
         // correction. This parameter may be decreased if there are issues with the accuracy of the arc
         // generations. In general, the default value is more than enough for the intended CNC applications
@@ -0,0 +1,30 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+class Block;
+
+// number of segments the conveyor can have queued up ahead of the step ticker
+#define STEP_SEGMENT_QUEUE_SIZE 64
+// about how far ahead of the stepper the next block is started, a started block can no longer be replanned so this is kept short
+#define STEP_SEGMENT_AHEAD_MS 4
+
+// A short part of a block that is stepped at a constant rate, used when segmented_stepping is enabled.
+// The rate is for the longest axis of the block, the other motors follow it with Bresenham.
+struct StepSegment {
+    Block *block;
+    uint32_t rate;  // steps per tick for the longest axis, 0.32 fixed point
+    uint32_t steps; // steps of the longest axis in this segment
+    int32_t arc_steps[2]; // for an arc the signed steps of each plane motor in this segment, at most one per step of the longest axis
+    struct {
+        bool first:1; // first segment of the block, stepticker starts the block on this one
+        bool last:1;  // the block is finished after this one
+    };
+};
@@ -14,6 +14,10 @@ class BaseSolution {
         virtual ~BaseSolution() {};
         virtual void cartesian_to_actuator(const float[], ActuatorCoordinates &) const = 0;
         virtual void actuator_to_cartesian(const ActuatorCoordinates &, float[]) const = 0;
+        // converts n XYZ positions at once, solutions that can share work between them override this
+        virtual void cartesian_to_actuators(const float cartesian_mm[][3], ActuatorCoordinates actuator_mm[], size_t n) const {
+            for (size_t i = 0; i < n; i++) cartesian_to_actuator(cartesian_mm[i], actuator_mm[i]);
+        }
         typedef std::map<char, float> arm_options_t;
         virtual bool set_optional(const arm_options_t& options) { return false; };
         virtual bool get_optional(arm_options_t& options, bool force_all= false) const { return false; };
@@ -73,6 +73,25 @@ void LinearDeltaSolution::cartesian_to_actuator(const float cartesian_mm[], Actu
                                       ) + cartesian_mm[Z_AXIS];
 }
 
+// the same as cartesian_to_actuator for each position, with the tower positions held in registers across the whole batch
+void LinearDeltaSolution::cartesian_to_actuators(const float cartesian_mm[][3], ActuatorCoordinates actuator_mm[], size_t n) const
+{
+    const float l2 = this->arm_length_squared;
+    const float t1x = delta_tower1_x, t1y = delta_tower1_y;
+    const float t2x = delta_tower2_x, t2y = delta_tower2_y;
+    const float t3x = delta_tower3_x, t3y = delta_tower3_y;
+
+    for (size_t i = 0; i < n; i++) {
+        const float x = cartesian_mm[i][X_AXIS], y = cartesian_mm[i][Y_AXIS], z = cartesian_mm[i][Z_AXIS];
+        float dx1 = t1x - x, dy1 = t1y - y;
+        float dx2 = t2x - x, dy2 = t2y - y;
+        float dx3 = t3x - x, dy3 = t3y - y;
+        actuator_mm[i][ALPHA_STEPPER] = sqrtf(l2 - dx1 * dx1 - dy1 * dy1) + z;
+        actuator_mm[i][BETA_STEPPER ] = sqrtf(l2 - dx2 * dx2 - dy2 * dy2) + z;
+        actuator_mm[i][GAMMA_STEPPER] = sqrtf(l2 - dx3 * dx3 - dy3 * dy3) + z;
+    }
+}
+
 void LinearDeltaSolution::actuator_to_cartesian(const ActuatorCoordinates &actuator_mm, float cartesian_mm[] ) const
 {
     // from http://en.wikipedia.org/wiki/Circumscribed_circle#Barycentric_coordinates_from_cross-_and_dot-products
@@ -107,6 +107,34 @@ void MorganSCARASolution::cartesian_to_actuator(const float cartesian_mm[], Actu
     actuator_mm[GAMMA_STEPPER] = cartesian_mm[Z_AXIS];            // No inverse kinematics on Z - Position to add bed offset?
 }
 
+// the same as cartesian_to_actuator for each position, with the arm length terms worked out once for the batch
+void MorganSCARASolution::cartesian_to_actuators(const float cartesian_mm[][3], ActuatorCoordinates actuator_mm[], size_t n) const
+{
+    const float l1 = this->arm1_length, l2 = this->arm2_length;
+    const float c2_offset = (l1 == l2) ? 2.0f * l1 * l1 : l1 * l1 + l2 * l2;
+    const float c2_scale = 1.0f / ((l1 == l2) ? 2.0f * l1 * l1 : 2.0f * l1 * l2);
+    const float degrees = 180.0F / 3.14159265359f;
+
+    for (size_t i = 0; i < n; i++) {
+        float px = (cartesian_mm[i][X_AXIS] - this->morgan_offset_x) * this->morgan_scaling_x;
+        float py = (cartesian_mm[i][Y_AXIS] * this->morgan_scaling_y - this->morgan_offset_y);
+
+        float c2 = (px * px + py * py - c2_offset) * c2_scale;
+        if (c2 > this->morgan_undefined_max)
+            c2 = this->morgan_undefined_max;
+        else if (c2 < -this->morgan_undefined_min)
+            c2 = -this->morgan_undefined_min;
+
+        float s2 = sqrtf(1.0f - c2 * c2);
+        float theta = -(atan2f(px, py) - atan2f(l1 + l2 * c2, l2 * s2));
+        float psi = atan2f(s2, c2);
+
+        actuator_mm[i][ALPHA_STEPPER] = theta * degrees;
+        actuator_mm[i][BETA_STEPPER ] = real_scara ? 180 - psi * degrees : (theta + psi) * degrees;
+        actuator_mm[i][GAMMA_STEPPER] = cartesian_mm[i][Z_AXIS];
+    }
+}
+
 void MorganSCARASolution::actuator_to_cartesian(const ActuatorCoordinates &actuator_mm, float cartesian_mm[] ) const
 {
     // Perform forward kinematics, and place results in cartesian_mm[]
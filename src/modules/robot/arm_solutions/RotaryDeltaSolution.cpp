@@ -196,6 +196,56 @@ void RotaryDeltaSolution::cartesian_to_actuator(const float cartesian_mm[], Actu
 
 }
 
+// the same as cartesian_to_actuator for each position, the parts of delta_calcAngleYZ() that only depend on the arm lengths
+// are worked out once for the batch, and the divide by z once for all three arms
+void RotaryDeltaSolution::cartesian_to_actuators(const float cartesian_mm[][3], ActuatorCoordinates actuator_mm[], size_t n) const
+{
+    if(debug_flag) {
+        BaseSolution::cartesian_to_actuators(cartesian_mm, actuator_mm, n);
+        return;
+    }
+
+    const float y1 = -0.5F * tan30 * delta_f;
+    const float e_shift = 0.5F * tan30 * delta_e;
+    const float k = delta_rf * delta_rf - delta_re * delta_re - y1 * y1;
+    const float rf = delta_rf;
+
+    for (size_t i = 0; i < n; i++) {
+        float x0 = cartesian_mm[i][X_AXIS];
+        float y0 = cartesian_mm[i][Y_AXIS];
+        if(mirror_xy) {
+            x0= -x0;
+            y0= -y0;
+        }
+
+        const float z0 = cartesian_mm[i][Z_AXIS] + z_calc_offset;
+        const float inv_z0 = 1.0F / z0;
+        const float xx[3] = {x0, x0 * cos120 + y0 * sin120, x0 * cos120 - y0 * sin120};
+        const float yy[3] = {y0, y0 * cos120 - x0 * sin120, y0 * cos120 + x0 * sin120};
+
+        float theta[3];
+        bool ok = true;
+        for (int j = 0; j < 3 && ok; j++) {
+            float y = yy[j] - e_shift;
+            float a = (xx[j] * xx[j] + y * y + z0 * z0 + k) * 0.5F * inv_z0;
+            float b = (y1 - y) * inv_z0;
+            float d = -(a + b * y1) * (a + b * y1) + rf * (b * b * rf + rf);
+            if (d < 0.0F) {
+                ok = false;
+                break;
+            }
+            float yj = (y1 - a * b - sqrtf(d)) / (b * b + 1.0F);
+            float zj = a + b * yj;
+            theta[j] = 180.0F * atanf(-zj / (y1 - yj)) / pi + ((yj > y1) ? 180.0F : 0.0F);
+        }
+
+        // force an impossible position to the home position as cartesian_to_actuator does
+        actuator_mm[i][ALPHA_STEPPER] = ok ? theta[0] : 0;
+        actuator_mm[i][BETA_STEPPER ] = ok ? theta[1] : 0;
+        actuator_mm[i][GAMMA_STEPPER] = ok ? theta[2] : 0;
+    }
+}
+
 void RotaryDeltaSolution::actuator_to_cartesian(const ActuatorCoordinates &actuator_mm, float cartesian_mm[] ) const
 {
     float x, y, z;
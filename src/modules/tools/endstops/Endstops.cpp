@@ -18,6 +18,7 @@
 #include "Robot.h"
 #include "Config.h"
 #include "SlowTicker.h"
+#include "InterruptIn.h" // mbed
 #include "Planner.h"
 #include "checksumm.h"
 #include "utils.h"
@@ -60,6 +61,7 @@ enum DEFNS {MIN_PIN, MAX_PIN, MAX_TRAVEL, FAST_RATE, SLOW_RATE, RETRACT, DIRECTI
 
 #define endstop_debounce_count_checksum  CHECKSUM("endstop_debounce_count")
 #define endstop_debounce_ms_checksum     CHECKSUM("endstop_debounce_ms")
+#define endstop_interrupt_checksum       CHECKSUM("endstop_interrupt")
 
 #define home_z_first_checksum            CHECKSUM("home_z_first")
 #define homing_order_checksum            CHECKSUM("homing_order")
@@ -91,6 +93,8 @@ enum DEFNS {MIN_PIN, MAX_PIN, MAX_TRAVEL, FAST_RATE, SLOW_RATE, RETRACT, DIRECTI
 #define cover_endstop_checksum              CHECKSUM("cover_endstop")
 
 #define STEPPER THEROBOT->actuators
+// how long an endstop the interrupt stopped at is given to settle, it stops right at the trip point where the contacts bounce
+#define LATCHED_SETTLE_MS 100
 #define STEPS_PER_MM(a) (STEPPER[a]->get_steps_per_mm())
 
 
@@ -132,6 +136,21 @@ void Endstops::on_module_loaded()
     register_for_event(ON_GET_PUBLIC_DATA);
     register_for_event(ON_SET_PUBLIC_DATA);
 
+    // homing endstops can stop their motor from an edge interrupt instead of waiting to be polled, only pins on port 0 and 2 can do this
+    if(THEKERNEL->config->value(endstop_interrupt_checksum)->by_default(false)->as_bool()) {
+        for(auto& e : homing_axis) {
+            if(e.pin_info == nullptr || e.pin_info->has_irq) continue;
+            Pin irq_pin= e.pin_info->pin;
+            mbed::InterruptIn *irq= irq_pin.interrupt_pin();
+            if(irq == nullptr) {
+                THEKERNEL->streams->printf("Error: endstop %c cannot interrupt, only pins on port 0 or 2 can, it will be polled instead\n", e.axis);
+                continue;
+            }
+            irq->rise(this, &Endstops::on_endstop_edge);
+            irq->fall(this, &Endstops::on_endstop_edge);
+            e.pin_info->has_irq= true;
+        }
+    }
 
     THEKERNEL->slow_ticker->attach(1000, this, &Endstops::read_endstops);
 }
@@ -191,6 +210,9 @@ bool Endstops::load_old_config()
 
             // init struct
             info->debounce= 0;
+            info->triggered= false;
+            info->has_irq= false;
+            info->latched= false;
             info->axis= 'X'+i;
             info->axis_index= i;
 
@@ -293,6 +315,9 @@ bool Endstops::load_config()
 
         // init pin struct
         pin_info->debounce= 0;
+        pin_info->triggered= false;
+        pin_info->has_irq= false;
+        pin_info->latched= false;
         pin_info->axis= toupper(axis[0]);
         pin_info->axis_index= i;
 
@@ -585,22 +610,29 @@ uint32_t Endstops::read_endstops(uint32_t dummy)
         // for corexy homing in X or Y we must only check the associated endstop, works as we only home one axis at a time for corexy
         if(is_corexy && (m == X_AXIS || m == Y_AXIS) && !axis_to_home[m]) continue;
 
-        if(STEPPER[m]->is_moving()) {
+        if(e.pin_info->latched) {
+            // the interrupt has already stopped the motor, it is only taken as triggered if it stays that way for the debounce time
+            if(e.pin_info->triggered) continue;
+            if(e.pin_info->pin.get()) {
+                if(e.pin_info->debounce < debounce_ms) {
+                    e.pin_info->debounce++;
+                } else {
+                    e.pin_info->triggered= true;
+                }
+            } else {
+                e.pin_info->debounce= 0;
+            }
+
+        } else if(STEPPER[m]->is_moving()) {
             // if it is moving then we check the associated endstop, and debounce it
+            // pins with an interrupt are checked too, as it only sees edges, a switch that was already closed when the move
+            // started or that closed before the move did is found here
             if(e.pin_info->pin.get()) {
                 if(e.pin_info->debounce < debounce_ms) {
                     e.pin_info->debounce++;
 
                 } else {
-                    if(is_corexy && (m == X_AXIS || m == Y_AXIS)) {
-                        // corexy when moving in X or Y we need to stop both the X and Y motors
-                        STEPPER[X_AXIS]->stop_moving();
-                        STEPPER[Y_AXIS]->stop_moving();
-
-                    }else{
-                        // we signal the motor to stop, which will preempt any moves on that axis
-                        STEPPER[m]->stop_moving();
-                    }
+                    stop_homing_axis(m);
                     e.pin_info->triggered= true;
                 }
 
@@ -614,6 +646,37 @@ uint32_t Endstops::read_endstops(uint32_t dummy)
     return 0;
 }
 
+// called from the pin interrupt on either edge of any homing endstop that has one, stops the motor as soon as its endstop triggers
+void Endstops::on_endstop_edge()
+{
+    if(this->status != MOVING_TO_ENDSTOP_SLOW && this->status != MOVING_TO_ENDSTOP_FAST) return;
+
+    for(auto& e : homing_axis) {
+        if(e.pin_info == nullptr || !e.pin_info->has_irq || e.pin_info->latched) continue;
+        int m= e.axis_index;
+        if(is_corexy && (m == X_AXIS || m == Y_AXIS) && !axis_to_home[m]) continue;
+
+        if(STEPPER[m]->is_moving() && e.pin_info->pin.get()) {
+            stop_homing_axis(m);
+            e.pin_info->debounce= 0;
+            e.pin_info->latched= true;
+        }
+    }
+}
+
+// we signal the motor to stop, which will preempt any moves on that axis
+void Endstops::stop_homing_axis(int m)
+{
+    if(is_corexy && (m == X_AXIS || m == Y_AXIS)) {
+        // corexy when moving in X or Y we need to stop both the X and Y motors
+        STEPPER[X_AXIS]->stop_moving();
+        STEPPER[Y_AXIS]->stop_moving();
+
+    }else{
+        STEPPER[m]->stop_moving();
+    }
+}
+
 void Endstops::home_xy()
 {
     if(axis_to_home[X_AXIS] && axis_to_home[Y_AXIS]) {
@@ -647,6 +710,7 @@ void Endstops::home(axis_bitmap_t a)
     for(auto& e : endstops) {
        e->debounce= 0;
        e->triggered= false;
+       e->latched= false;
     }
 
     if (is_scara) {
@@ -689,6 +753,12 @@ void Endstops::home(axis_bitmap_t a)
         }
     }
 
+    // an endstop that stopped its motor from the interrupt only counts once read_endstops() has seen it stay triggered for
+    // the debounce time, an open reading restarts that count but is taken as bounce until the settle time is up
+    for(auto& e : endstops) {
+        for (uint32_t ms = 0; e->latched && !e->triggered && ms < debounce_ms + LATCHED_SETTLE_MS; ++ms) safe_delay_ms(1);
+    }
+
     // check that the endstops were hit and it did not stop short for some reason
     // if the endstop is not triggered then enter ALARM state
     // with deltas we check all three axis were triggered, but at least one of XYZ must be set to home
@@ -742,7 +812,8 @@ void Endstops::home(axis_bitmap_t a)
     // wait until finished
     THECONVEYOR->wait_for_idle();
 
-    // Start moving the axes towards the endstops slowly
+    // Start moving the axes towards the endstops slowly, the interrupts stop this approach too
+    for(auto& e : endstops) e->latched= false;
     this->status = MOVING_TO_ENDSTOP_SLOW;
     for (auto& i : homing_axis) {
         int c= i.axis_index;
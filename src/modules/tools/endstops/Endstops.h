@@ -40,6 +40,8 @@ class Endstops : public Module{
         void process_home_command(Gcode* gcode);
         void set_homing_offset(Gcode* gcode);
         uint32_t read_endstops(uint32_t dummy);
+        void on_endstop_edge();
+        void stop_homing_axis(int m);
         void handle_park();
 
         // global settings
@@ -61,6 +63,8 @@ class Endstops : public Module{
                 uint8_t axis_index:3;
                 bool limit_enable:1;
                 bool triggered:1;
+                bool has_irq:1;   // the pin interrupts on either edge so it stops the motor without waiting to be polled
+                bool latched:1;   // the interrupt stopped the motor, triggered is set once it is debounced
             };
         };
 
@@ -37,6 +37,7 @@
 #define laser_module_minimum_power_checksum     CHECKSUM("laser_module_minimum_power")
 #define laser_module_max_power_checksum         CHECKSUM("laser_module_max_power")
 #define laser_module_maximum_s_value_checksum   CHECKSUM("laser_module_maximum_s_value")
+#define laser_module_step_sync_checksum         CHECKSUM("laser_module_step_sync")
 
 
 Laser::Laser()
@@ -44,6 +45,9 @@ Laser::Laser()
     laser_on = false;
     scale = 1;
     testing = false;
+    step_sync = false;
+    step_power = false;
+    power_block = nullptr;
 }
 
 void Laser::on_module_loaded()
@@ -114,6 +118,21 @@ void Laser::on_module_loaded()
     // no point in updating the power more than the PWM frequency, but not faster than 1KHz
     ms_per_tick = 1000 / std::min(1000UL, 1000000 / period);
     THEKERNEL->slow_ticker->attach(std::min(1000UL, 1000000 / period), this, &Laser::set_proportional_power);
+
+    // the step ticker updates the power of raster scanlines, and of every move when step_sync is set, as they are stepped,
+    // once per PWM period but no more often than every 50us
+    this->step_sync = THEKERNEL->config->value(laser_module_step_sync_checksum)->by_default(false)->as_bool();
+    this->step_power_ticks = std::max(period, 50UL) * StepTicker::getInstance()->get_frequency() / 1000000;
+    if (this->step_sync) start_step_power();
+}
+
+// the step ticker only calls set_step_power() once it is needed, from the start with step_sync or from the first raster
+// scanline, so it adds nothing to the step ticks of a laser that uses neither
+void Laser::start_step_power()
+{
+    if (this->step_power) return;
+    this->step_power = true;
+    StepTicker::getInstance()->set_speed_fnc([this](const Block *block, float ratio) { set_step_power(block, ratio); }, step_power_ticks);
 }
 
 void Laser::on_console_line_received( void *argument )
@@ -180,6 +199,9 @@ void Laser::on_gcode_received(void *argument)
 {
     Gcode *gcode = static_cast<Gcode *>(argument);
 
+    // a raster scanline needs the power set as it is stepped
+    if (gcode->has_g && gcode->g == 7) start_step_power();
+
     // M codes execute immediately
     if (gcode->has_m) {
     	if (gcode->m == 3 && THEKERNEL->get_laser_mode())
@@ -228,6 +250,14 @@ float Laser::current_speed_ratio(const Block *block) const
     return ratio;
 }
 
+// the power for the block when it is moving at ratio of its nominal speed, adjusted to the minimum and maximum power
+float Laser::proportional_power(const Block *block, float ratio) const
+{
+    float requested_power = ((float)block->s_value / (1 << 11)) / this->laser_maximum_s_value; // s_value is 1.11 Fixed point
+    float power = requested_power * ratio * scale;
+    return ( (this->laser_maximum_power - this->laser_minimum_power) * power ) + this->laser_minimum_power;
+}
+
 // get laser power for the currently executing block, returns false if nothing running or a G0
 bool Laser::get_laser_power(float& power) const
 {
@@ -235,17 +265,49 @@ bool Laser::get_laser_power(float& power) const
 
     // Note to avoid a race condition where the block is being cleared we check the is_ready flag which gets cleared first,
     // as this is an interrupt if that flag is not clear then it cannot be cleared while this is running and the block will still be valid (albeit it may have finished)
-    if(block != nullptr && block->is_ready && block->is_g123) {
-        float requested_power = ((float)block->s_value / (1 << 11)) / this->laser_maximum_s_value; // s_value is 1.11 Fixed point
-        float ratio = current_speed_ratio(block);
-        power = requested_power * ratio * scale;
-
+    if(block != nullptr && block->is_ready && block->is_g123 && !block->is_raster) {
+        power = proportional_power(block, current_speed_ratio(block));
         return true;
     }
 
     return false;
 }
 
+// called from the step ticker ISR, block is nullptr once nothing is moving
+void Laser::set_step_power(const Block *block, float ratio)
+{
+    if (!THEKERNEL->get_laser_mode() || this->testing) return;
+
+    if (!laser_on || block == nullptr || !block->is_g123) {
+        power_block = nullptr;
+        set_laser_power(0);
+        return;
+    }
+
+    if (block != power_block) {
+        // the divides are done once for each block, so each update is just a multiply and add
+        power_block = block;
+        power_span = proportional_power(block, 1.0F) - this->laser_minimum_power;
+        if (block->is_raster) {
+            // pixels for each step of the motor with the most steps, 8.24 fixed point as there are at most 255 pixels
+            const Block::rasterinfo_t *raster = block->raster_info;
+            pixels_per_step = ((uint64_t)raster->pixels << 24) / block->steps[raster->motor];
+            power_span /= 255.0F;
+        }
+    }
+
+    if (block->is_raster) {
+        // the pixel under the laser is found from how far along the block the motor with the most steps is
+        const Block::rasterinfo_t *raster = block->raster_info;
+        uint32_t i = ((uint64_t)block->tick_info[raster->motor].step_count * pixels_per_step) >> 24;
+        if (i >= raster->pixels) i = raster->pixels - 1;
+        set_laser_power(this->laser_minimum_power + power_span * ratio * raster->power[i]);
+
+    } else if (step_sync) {
+        set_laser_power(this->laser_minimum_power + power_span * ratio);
+    }
+}
+
 // called every millisecond from timer ISR
 uint32_t Laser::set_proportional_power(uint32_t dummy)
 {
@@ -257,11 +319,13 @@ uint32_t Laser::set_proportional_power(uint32_t dummy)
         return 0;
     }
 
+    // the step ticker looks after the power while there is a block
+    if (step_sync && laser_on) return 0;
+
     float power;
     if (laser_on && get_laser_power(power)) {
         // adjust power to maximum power and actual velocity
-        float proportional_power = ( (this->laser_maximum_power - this->laser_minimum_power) * power ) + this->laser_minimum_power;
-        set_laser_power(proportional_power);
+        set_laser_power(power);
     } else if (!laser_on) {
         // turn laser off
         set_laser_power(0);
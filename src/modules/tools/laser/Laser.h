@@ -33,6 +33,9 @@ class Laser : public Module{
 
     private:
         uint32_t set_proportional_power(uint32_t dummy);
+        void set_step_power(const Block *block, float ratio);
+        void start_step_power();
+        float proportional_power(const Block *block, float ratio) const;
         bool get_laser_power(float& power) const;
         float current_speed_ratio(const Block *block) const;
 
@@ -44,7 +47,13 @@ class Laser : public Module{
         float laser_minimum_power; // value used to tickle the laser on moves.  Also minimum value for auto-scaling
         float laser_maximum_s_value; // Value of S code that will represent max power
         float scale;
+        // the block set_step_power() last worked out the power for, and its power above minimum at the nominal speed,
+        // for a raster it is for each of the 255 levels of a pixel
+        const Block *power_block;
+        float power_span;
+        uint32_t pixels_per_step; // 8.24 fixed point, for a raster
         int32_t ms_per_tick; // ms between each ticks, depends on PWM frequency
+        uint32_t step_power_ticks; // step ticks between each call of set_step_power()
 
         struct {
             bool laser_on:1;      // set if the laser is on
@@ -52,5 +61,7 @@ class Laser : public Module{
             bool ttl_used:1;        // stores whether we have a TTL output
             bool ttl_inverting:1;   // stores whether the TTL output should be inverted
             bool testing:1;     // set when manually firing
+            bool step_sync:1;   // the power of every move follows the speed from the step ticker, not just raster scanlines
+            bool step_power:1;  // set_step_power() has been given to the step ticker
         };
 };
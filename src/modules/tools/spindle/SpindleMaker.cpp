@@ -63,7 +63,7 @@ void SpindleMaker::load_spindle(){
             spindle->register_for_event(ON_HALT);
         }
 
-        THEKERNEL->add_module( spindle );
+        THEKERNEL->add_module( spindle, "Spindle" );
     }
 
 }
@@ -28,7 +28,7 @@ void SwitchPool::load_tools()
         // If module is enabled
         if( THEKERNEL->config->value(switch_checksum, modules[i], enable_checksum )->as_bool() == true ) {
             Switch *controller = new Switch(modules[i]);
-            THEKERNEL->add_module(controller);
+            THEKERNEL->add_module(controller, "Switch");
         }
     }
 
@@ -15,6 +15,7 @@
 #include "StreamOutputPool.h"
 
 #define e3d_amplifier_pin_checksum  CHECKSUM("e3d_amplifier_pin")
+#define adc_filter_checksum         CHECKSUM("adc_filter")
 
 PT100_E3D::PT100_E3D()
 {
@@ -29,7 +30,7 @@ void PT100_E3D::UpdateConfig(uint16_t module_checksum, uint16_t name_checksum)
 {
 	// Pin used for ADC readings
     this->amplifier_pin.from_string(THEKERNEL->config->value(module_checksum, name_checksum, e3d_amplifier_pin_checksum)->required()->as_string());
-    THEKERNEL->adc->enable_pin(&amplifier_pin);
+    THEKERNEL->adc->enable_pin(&amplifier_pin, Adc::filter_from_string(THEKERNEL->config->value(module_checksum, name_checksum, adc_filter_checksum)->by_default("sorted")->as_string()));
 }
 
 float PT100_E3D::get_temperature()
@@ -20,6 +20,7 @@
 #include "predefined_thermistors.h"
 
 #include <fastmath.h>
+#include <algorithm>
 
 #include "MRI_Hooks.h"
 
@@ -34,6 +35,7 @@
 #define r1_checksum                        CHECKSUM("r1")
 #define r2_checksum                        CHECKSUM("r2")
 #define thermistor_pin_checksum            CHECKSUM("thermistor_pin")
+#define adc_filter_checksum                CHECKSUM("adc_filter")
 #define rt_curve_checksum                  CHECKSUM("rt_curve")
 #define coefficients_checksum              CHECKSUM("coefficients")
 #define use_beta_table_checksum            CHECKSUM("use_beta_table")
@@ -44,9 +46,17 @@ Thermistor::Thermistor()
     this->bad_config = false;
     this->use_steinhart_hart= false;
     this->beta= 0.0F; // not used by default
+    this->r0= 100000;
+    this->t0= 25;
+    this->r1= 0;
+    this->r2= 4700;
     min_temp= 999;
     max_temp= 0;
     this->thermistor_number= 0; // not a predefined thermistor
+    this->use_table= false;
+    this->max_adc_value= 0;
+    this->table_end= 0;
+    this->open_adc_value= 0;
 }
 
 Thermistor::~Thermistor()
@@ -63,6 +73,9 @@ void Thermistor::UpdateConfig(uint16_t module_checksum, uint16_t name_checksum)
     this->r2   = 4700;
     this->beta = 4066;
 
+    // set before any return for a bad config, as a later M305 builds the table with it
+    this->max_adc_value= THEKERNEL->adc->get_max_value();
+
     // force use of beta perdefined thermistor table based on betas
     bool use_beta_table= THEKERNEL->config->value(module_checksum, name_checksum, use_beta_table_checksum)->by_default(false)->as_bool();
 
@@ -124,7 +137,7 @@ void Thermistor::UpdateConfig(uint16_t module_checksum, uint16_t name_checksum)
 
     // Thermistor pin for ADC readings
     this->thermistor_pin.from_string(THEKERNEL->config->value(module_checksum, name_checksum, thermistor_pin_checksum )->required()->as_string());
-    THEKERNEL->adc->enable_pin(&thermistor_pin);
+    THEKERNEL->adc->enable_pin(&thermistor_pin, Adc::filter_from_string(THEKERNEL->config->value(module_checksum, name_checksum, adc_filter_checksum)->by_default("sorted")->as_string()));
 
     // specify the three Steinhart-Hart coefficients
     // specified as three comma separated floats, no spaces
@@ -180,6 +193,7 @@ void Thermistor::UpdateConfig(uint16_t module_checksum, uint16_t name_checksum)
         return;
     }
 
+    build_table(this->max_adc_value);
 }
 
 // print out predefined thermistors
@@ -280,17 +294,66 @@ void Thermistor::get_raw()
     min_temp= max_temp= t;
 }
 
-float Thermistor::adc_value_to_temperature(uint32_t adc_value)
+// index of the table node at or below v, which must be at least THERMISTOR_TABLE_STEPS, along with the node value and the gap to the next one
+static inline uint32_t table_index(uint32_t v, uint32_t &base, uint32_t &width)
 {
-    const uint32_t max_adc_value= THEKERNEL->adc->get_max_value();
-    if ((adc_value >= max_adc_value) || (adc_value == 0))
-        return infinityf();
+    uint32_t sh= (31 - __builtin_clz(v)) - THERMISTOR_TABLE_STEP_BITS;
+    width= 1 << sh;
+    base= (v >> sh) << sh;
+    return (sh << THERMISTOR_TABLE_STEP_BITS) + ((v >> sh) & (THERMISTOR_TABLE_STEPS - 1));
+}
+
+// the value a table node is at, the inverse of table_index()
+static inline uint32_t table_node(uint32_t i)
+{
+    return (THERMISTOR_TABLE_STEPS + (i & (THERMISTOR_TABLE_STEPS - 1))) << (i >> THERMISTOR_TABLE_STEP_BITS);
+}
+
+void Thermistor::build_table(uint32_t max_adc_value)
+{
+    use_table= false;
+    this->max_adc_value= max_adc_value;
+
+    // with r1 in parallel the resistance can only be measured below the reading where the divider would be r1
+    table_end= max_adc_value;
+    if(r1 > 0) table_end= ((uint64_t)max_adc_value * r1) / (r1 + r2);
+
+    // the resistance goes up with the reading so find the first reading that would be over 800k
+    uint32_t lo= 1, hi= table_end;
+    while(lo < hi) {
+        uint32_t mid= (lo + hi) / 2;
+        if(adc_value_to_resistance(mid) > this->r0 * 8) hi= mid; else lo= mid + 1;
+    }
+    open_adc_value= lo;
+
+    if(bad_config || table_end <= 2 * THERMISTOR_TABLE_STEPS) return;
+
+    uint32_t half= table_end / 2;
+    uint32_t base, width;
+    uint32_t n= table_index(std::max(half, table_end - half), base, width) + 2;
+    if(n > THERMISTOR_TABLE_HALF) return; // a bigger ADC than the table was sized for
+
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t v= table_node(i);
+        table[i]= calculate_temperature(v);
+        table[THERMISTOR_TABLE_HALF + i]= calculate_temperature(table_end - v);
+        if(!isfinite(table[i]) || !isfinite(table[THERMISTOR_TABLE_HALF + i])) return;
+    }
 
-    // resistance of the thermistor in ohms
+    use_table= true;
+}
+
+// resistance of the thermistor in ohms
+float Thermistor::adc_value_to_resistance(uint32_t adc_value) const
+{
     float r = r2 / (((float)max_adc_value / adc_value) - 1.0F);
     if (r1 > 0.0F) r = (r1 * r) / (r1 - r);
+    return r;
+}
 
-    if(r > this->r0 * 8) return infinityf(); // 800k is probably open circuit
+float Thermistor::calculate_temperature(uint32_t adc_value) const
+{
+    float r = adc_value_to_resistance(adc_value);
 
     float t;
     if(this->use_steinhart_hart) {
@@ -304,6 +367,27 @@ float Thermistor::adc_value_to_temperature(uint32_t adc_value)
     return t;
 }
 
+float Thermistor::adc_value_to_temperature(uint32_t adc_value)
+{
+    if ((adc_value >= max_adc_value) || (adc_value == 0))
+        return infinityf();
+
+    if(adc_value >= open_adc_value) return infinityf(); // 800k is probably open circuit
+
+    if(use_table) {
+        uint32_t half= table_end / 2;
+        bool upper= adc_value > half;
+        uint32_t v= upper ? table_end - adc_value : adc_value;
+        if(v >= THERMISTOR_TABLE_STEPS) {
+            uint32_t base, width;
+            const float *t= &table[table_index(v, base, width) + (upper ? THERMISTOR_TABLE_HALF : 0)];
+            return t[0] + (t[1] - t[0]) * (v - base) / width;
+        }
+    }
+
+    return calculate_temperature(adc_value);
+}
+
 int Thermistor::new_thermistor_reading()
 {
     // filtering now done in ADC
@@ -352,6 +436,7 @@ bool Thermistor::set_optional(const sensor_options_t& options) {
             calc_jk();
             thermistor_number= predefined;
             this->bad_config= false;
+            build_table(max_adc_value);
             return true;
 
         }else {
@@ -370,6 +455,7 @@ bool Thermistor::set_optional(const sensor_options_t& options) {
             use_steinhart_hart= true;
             thermistor_number= predefined;
             this->bad_config= false;
+            build_table(max_adc_value);
             return true;
         }
     }
@@ -397,6 +483,7 @@ bool Thermistor::set_optional(const sensor_options_t& options) {
 
     if(this->bad_config) this->bad_config= false;
 
+    build_table(max_adc_value);
     return true;
 }
 
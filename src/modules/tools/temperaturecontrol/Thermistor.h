@@ -16,6 +16,15 @@
 
 #define QUEUE_LEN 32
 
+// The temperature is looked up in a table built from the closed form rather than calling logf and powf for every reading.
+// The nodes are spaced 1/8 of an octave apart counting up from ADC 0 for the lower half of the range and down from the top
+// for the upper half, so they are closest together where the curve is steepest. 8 steps per octave keeps the interpolation
+// within about 0.25°C of the closed form up to 400°C, the few ADC values next to either end use the closed form.
+#define THERMISTOR_TABLE_STEP_BITS 3
+#define THERMISTOR_TABLE_STEPS (1 << THERMISTOR_TABLE_STEP_BITS)
+// entries in each half of the table, enough for the 14 bit oversampled ADC
+#define THERMISTOR_TABLE_HALF 81
+
 class StreamOutput;
 
 class Thermistor : public TempSensor
@@ -33,9 +42,15 @@ class Thermistor : public TempSensor
         static std::tuple<float,float,float> calculate_steinhart_hart_coefficients(float t1, float r1, float t2, float r2, float t3, float r3);
         static void print_predefined_thermistors(StreamOutput*);
 
+        // builds the lookup table, called whenever the settings change, max_adc_value is the reading at full scale
+        void build_table(uint32_t max_adc_value);
+        float adc_value_to_temperature(uint32_t adc_value);
+        // the closed form the table is built from
+        float calculate_temperature(uint32_t adc_value) const;
+
     private:
         int new_thermistor_reading();
-        float adc_value_to_temperature(uint32_t adc_value);
+        float adc_value_to_resistance(uint32_t adc_value) const;
         void calc_jk();
 
         // Thermistor computation settings using beta, not used if using Steinhart-Hart
@@ -62,10 +77,17 @@ class Thermistor : public TempSensor
 
         Pin  thermistor_pin;
 
+        // the lower half of the table is indexed by the ADC value, the upper half by table_end less the ADC value
+        float table[2 * THERMISTOR_TABLE_HALF];
+        uint32_t max_adc_value;
+        uint32_t table_end;      // full scale, or where the resistance with r1 in parallel would be infinite
+        uint32_t open_adc_value; // readings from here up are an open circuit
+
         float min_temp, max_temp;
         struct {
             bool bad_config:1;
             bool use_steinhart_hart:1;
+            bool use_table:1;
         };
         uint8_t thermistor_number;
 };
@@ -61,6 +61,21 @@
         leveling-strategy.rectangular-grid.before_probe_gcode M280
         leveling-strategy.rectangular-grid.after_probe_gcode M281
 
+    On a cartesian machine lines are normally cut every mm_per_line_segment so the compensation can follow the grid, they can be cut
+    only where they cross from one grid cell to the next instead, which is far fewer segments for long moves over a fine grid.
+    The surface is still followed exactly along X or Y, a diagonal within a cell follows the straight line between its ends.
+        leveling-strategy.rectangular-grid.segment_at_cells  true
+
+    The surface between the grid points can be bicubic instead of bilinear, so it is smooth across the grid lines rather than
+    creased along them. Then segment_at_cells is not used as the surface curves within a cell.
+        leveling-strategy.rectangular-grid.bicubic  true
+
+    Grids too big to hold in memory, like 50x50 for milling PCBs, can be kept in a binary file on the sd card instead and
+    only some rows of it held in memory. The grid is written to /sd/cartesian_paged.grid as it is probed so M374 is not needed,
+    M375 loads it again, and a probe that does not complete leaves the saved grid as it was. The rows around the current
+    position are read in as the head moves, at least 4 must be kept.
+        leveling-strategy.rectangular-grid.cache_rows  8
+
 
     Usage
     -----
@@ -125,18 +140,33 @@
 #define dampening_start_checksum     CHECKSUM("dampening_start")
 #define before_probe_gcode_checksum  CHECKSUM("before_probe_gcode")
 #define after_probe_gcode_checksum   CHECKSUM("after_probe_gcode")
+#define segment_at_cells_checksum    CHECKSUM("segment_at_cells")
+#define bicubic_checksum             CHECKSUM("bicubic")
+#define cache_rows_checksum          CHECKSUM("cache_rows")
 
 #define GRIDFILE "/sd/cartesian.grid"
 #define GRIDFILE_NM "/sd/cartesian_nm.grid"
+#define GRIDFILE_PAGED "/sd/cartesian_paged.grid"
+// a paged grid is probed into this and only replaces the saved one when the probe completes
+#define GRIDFILE_PAGED_NEW "/sd/cartesian_paged.new"
+// x and y grid size, x and y bed size, then the grid a row at a time
+#define GRIDFILE_PAGED_HEADER (2 * sizeof(uint8_t) + 2 * sizeof(float))
 
 CartGridStrategy::CartGridStrategy(ZProbe *zprobe) : LevelingStrategy(zprobe)
 {
     grid = nullptr;
+    cells = nullptr;
+    grid_file = nullptr;
+    cached_row = nullptr;
+    grid_file_is_new = false;
 }
 
 CartGridStrategy::~CartGridStrategy()
 {
     if(grid != nullptr) AHB0.dealloc(grid);
+    if(cells != nullptr) AHB0.dealloc(cells);
+    close_grid_file();
+    if(cached_row != nullptr) delete [] cached_row;
 }
 
 bool CartGridStrategy::handleConfig()
@@ -155,6 +185,11 @@ bool CartGridStrategy::handleConfig()
     only_by_two_corners = THEKERNEL->config->value(leveling_strategy_checksum, cart_grid_leveling_strategy_checksum, only_by_two_corners_checksum)->by_default(false)->as_bool();
     human_readable = THEKERNEL->config->value(leveling_strategy_checksum, cart_grid_leveling_strategy_checksum, human_readable_checksum)->by_default(false)->as_bool();
     do_manual_attach = THEKERNEL->config->value(leveling_strategy_checksum, cart_grid_leveling_strategy_checksum, m_attach_checksum)->by_default(false)->as_bool();
+    segment_at_cells = THEKERNEL->config->value(leveling_strategy_checksum, cart_grid_leveling_strategy_checksum, segment_at_cells_checksum)->by_default(false)->as_bool();
+    bicubic = THEKERNEL->config->value(leveling_strategy_checksum, cart_grid_leveling_strategy_checksum, bicubic_checksum)->by_default(false)->as_bool();
+    int rows = THEKERNEL->config->value(leveling_strategy_checksum, cart_grid_leveling_strategy_checksum, cache_rows_checksum)->by_default(0)->as_number();
+    this->cache_rows = (rows <= 0) ? 0 : std::min(std::max(rows, 4), 255);
+    this->next_cache_slot = 0;
 
     this->height_limit = THEKERNEL->config->value(leveling_strategy_checksum, cart_grid_leveling_strategy_checksum, height_limit_checksum)->by_default(NAN)->as_number();
     this->dampening_start = THEKERNEL->config->value(leveling_strategy_checksum, cart_grid_leveling_strategy_checksum, dampening_start_checksum)->by_default(NAN)->as_number();
@@ -215,7 +250,17 @@ bool CartGridStrategy::handleConfig()
     std::replace(after_probe.begin(), after_probe.end(), '_', ' '); // replace _ with space
 
     // allocate in AHB0
-    grid = (float *)AHB0.alloc(configured_grid_x_size * configured_grid_y_size * sizeof(float));
+    if(cache_rows == 0) {
+        grid = (float *)AHB0.alloc(configured_grid_x_size * configured_grid_y_size * sizeof(float));
+        // a smaller grid probed with I and J can have more cells than the configured one, but never more than it has points.
+        // it is only there to save time, without the room for it the terms of each cell are worked out as it is entered
+        if(!bicubic) cells = (float *)AHB0.alloc(configured_grid_x_size * configured_grid_y_size * 4 * sizeof(float));
+
+    } else {
+        // the grid file can have any number of rows, but they can be no longer than the configured x size
+        grid = (float *)AHB0.alloc(cache_rows * configured_grid_x_size * sizeof(float));
+        cached_row = new int16_t[cache_rows];
+    }
 
     if(grid == nullptr) {
         THEKERNEL->streams->printf("Error: Not enough memory\n");
@@ -234,6 +279,12 @@ void CartGridStrategy::save_grid(StreamOutput *stream)
         return;
     }
 
+    if(cache_rows > 0) {
+        // it was written as it was probed
+        stream->printf("grid is kept in %s\n", GRIDFILE_PAGED);
+        return;
+    }
+
     if(isnan(grid[0])) {
         stream->printf("error:No grid to save\n");
         return;
@@ -244,8 +295,7 @@ void CartGridStrategy::save_grid(StreamOutput *stream)
         return;
     }
 
-    // we use a different file format depending on whether it is square or not
-    const char *filename= (this->new_file_format) ? GRIDFILE_NM : GRIDFILE;
+    const char *filename= grid_filename();
     FILE *fp = fopen(filename, "w");
     if(fp == NULL) {
         stream->printf("error:Failed to open grid file %s\n", filename);
@@ -299,10 +349,11 @@ bool CartGridStrategy::load_grid(StreamOutput *stream)
         return false;
     }
 
-    // we use a different file format depending on whether it is square or not
-    const char *filename= (this->new_file_format) ? GRIDFILE_NM : GRIDFILE;
+    const char *filename= grid_filename();
 
-    FILE *fp = fopen(filename, "r");
+    // a paged grid stays open, and is read from as it is used
+    close_grid_file();
+    FILE *fp = fopen(filename, (cache_rows > 0) ? "r+" : "r");
     if(fp == NULL) {
         stream->printf("error:Failed to open grid %s\n", filename);
         return false;
@@ -317,7 +368,15 @@ bool CartGridStrategy::load_grid(StreamOutput *stream)
         return false;
     }
 
-    if(load_grid_x_size != configured_grid_x_size) {
+    if(cache_rows > 0) {
+        // a paged grid can be any size probed with I and J that its rows fit in memory
+        if(load_grid_x_size > configured_grid_x_size || load_grid_x_size < 2) {
+            stream->printf("error:grid size x does not fit read %d - config %d\n", load_grid_x_size, configured_grid_x_size);
+            fclose(fp);
+            return false;
+        }
+
+    } else if(load_grid_x_size != configured_grid_x_size) {
         stream->printf("error:grid size x is different read %d - config %d\n", load_grid_x_size, configured_grid_x_size);
         fclose(fp);
         return false;
@@ -325,7 +384,14 @@ bool CartGridStrategy::load_grid(StreamOutput *stream)
 
     load_grid_y_size = load_grid_x_size;
 
-    if(this->new_file_format){
+    if(cache_rows > 0) {
+        if(fread(&load_grid_y_size, sizeof(uint8_t), 1, fp) != 1 || load_grid_y_size < 2) {
+            stream->printf("error:Failed to read grid size\n");
+            fclose(fp);
+            return false;
+        }
+
+    } else if(this->new_file_format){
         if(fread(&load_grid_y_size, sizeof(uint8_t), 1, fp) != 1) {
             stream->printf("error:Failed to read grid size\n");
             fclose(fp);
@@ -357,6 +423,16 @@ bool CartGridStrategy::load_grid(StreamOutput *stream)
         return false;
     }
 
+    if(cache_rows > 0) {
+        // the rows are read in as they are needed
+        grid_file = fp;
+        current_grid_x_size = load_grid_x_size;
+        current_grid_y_size = load_grid_y_size;
+        for (int i = 0; i < cache_rows; i++) cached_row[i] = -1;
+        stream->printf("grid opened, grid: (%f, %f), size: %d x %d\n", x_size, y_size, load_grid_x_size, load_grid_y_size);
+        return true;
+    }
+
     for (int y = 0; y < configured_grid_y_size; y++) {
         for (int x = 0; x < configured_grid_x_size; x++) {
             if(fread(&grid[x + (configured_grid_x_size * y)], sizeof(float), 1, fp) != 1) {
@@ -390,6 +466,11 @@ bool CartGridStrategy::handleGcode(Gcode *gcode)
 
             THEROBOT->disable_segmentation= true;
             if(!doProbe(gcode)) {
+                if(grid_file_is_new) {
+                    // throw away the unfinished paged grid, the saved one is left as it was
+                    close_grid_file();
+                    remove(GRIDFILE_PAGED_NEW);
+                }
                 gcode->stream->printf("Probe failed to complete, check the initial probe height and/or initial_height settings\n");
             } else {
                 gcode->stream->printf("Probe completed.\n");
@@ -438,8 +519,12 @@ bool CartGridStrategy::handleGcode(Gcode *gcode)
 
         } else if(gcode->m == 374) { // M374: Save grid, M374.1: delete saved grid
             if(gcode->subcode == 1) {
-                // we use a different file format depending on whether it is square or not
-                const char *filename= (this->new_file_format) ? GRIDFILE_NM : GRIDFILE;
+                const char *filename= grid_filename();
+                if(grid_file != nullptr) {
+                    // it is the grid in use
+                    setAdjustFunction(false);
+                    reset_bed_level();
+                }
                 remove(filename);
                 gcode->stream->printf("%s deleted\n", filename);
             } else {
@@ -471,7 +556,7 @@ bool CartGridStrategy::handleGcode(Gcode *gcode)
             std::tie(x, y, z) = probe_offsets;
             gcode->stream->printf(";Probe offsets:\nM565 X%1.5f Y%1.5f Z%1.5f\n", x, y, z);
             if(save) {
-                if(!isnan(grid[0])) gcode->stream->printf(";Load saved grid\nM375\n");
+                if(!isnan(grid_value(0, 0))) gcode->stream->printf(";Load saved grid\nM375\n");
                 else if(gcode->m == 503) gcode->stream->printf(";WARNING No grid to save\n");
             }
             return true;
@@ -488,13 +573,18 @@ bool CartGridStrategy::handleGcode(Gcode *gcode)
 void CartGridStrategy::setAdjustFunction(bool on)
 {
     if(on) {
+        update_cells();
+
         // set the compensationTransform in robot
         using std::placeholders::_1;
         using std::placeholders::_2;
+        using std::placeholders::_3;
         THEROBOT->compensationTransform = std::bind(&CartGridStrategy::doCompensation, this, _1, _2); // [this](float *target, bool inverse) { doCompensation(target, inverse); };
+        if(segment_at_cells && !bicubic) THEROBOT->compensationBoundary = std::bind(&CartGridStrategy::nextCellBoundary, this, _1, _2, _3);
     } else {
         // clear it
         THEROBOT->compensationTransform = nullptr;
+        THEROBOT->compensationBoundary = nullptr;
     }
 }
 
@@ -621,7 +711,19 @@ bool CartGridStrategy::doProbe(Gcode *gc)
     if(gc->has_letter('I')) current_grid_x_size = gc->get_value('I'); // override default grid x size
     if(gc->has_letter('J')) current_grid_y_size = gc->get_value('J'); // override default grid y size
 
-    if((this->current_grid_x_size * this->current_grid_y_size)  > (this->configured_grid_x_size * this->configured_grid_y_size)){
+    if(cache_rows > 0) {
+        // only the row length is limited, by the memory for the rows
+        if(this->current_grid_x_size > this->configured_grid_x_size) {
+            gc->stream->printf("Grid x size %d bigger than configured %d. Change configuration.\n", this->current_grid_x_size, this->configured_grid_x_size);
+            return false;
+        }
+        if(this->current_grid_y_size < 2) {
+            gc->stream->printf("Grid y size %d must be at least 2.\n", this->current_grid_y_size);
+            return false;
+        }
+        if(!start_grid_file(gc->stream)) return false;
+
+    } else if((this->current_grid_x_size * this->current_grid_y_size)  > (this->configured_grid_x_size * this->configured_grid_y_size)){
         gc->stream->printf("Grid size (%d x %d = %d) bigger than configured (%d x %d = %d). Change configuration.\n",
                             this->current_grid_x_size, this->current_grid_y_size, this->current_grid_x_size*this->current_grid_x_size,
                             this->configured_grid_x_size, this->configured_grid_y_size, this->configured_grid_x_size*this->configured_grid_y_size);
@@ -682,11 +784,16 @@ bool CartGridStrategy::doProbe(Gcode *gc)
 
             float measured_z = zprobe->getProbeHeight() - mm - z_reference; // this is the delta z from bed at 0,0
             gc->stream->printf("DEBUG: X%1.3f, Y%1.3f, Z%1.3f\n", xProbe, yProbe, measured_z);
-            grid[xCount + (this->current_grid_x_size * yCount)] = measured_z;
+            if(!set_grid_value(xCount, yCount, measured_z)) {
+                gc->stream->printf("error:Failed to write grid %s\n", GRIDFILE_PAGED_NEW);
+                return false;
+            }
             if(fabs(measured_z) > max_delta) max_delta= fabs(measured_z);
         }
     }
 
+    if(cache_rows > 0 && !finish_grid_file(gc->stream)) return false;
+
     print_bed_level(gc->stream);
 
     gc->stream->printf("Maximum delta: %1.3f\n", max_delta);
@@ -722,31 +829,33 @@ void CartGridStrategy::doCompensation(float *target, bool inverse)
         }
     }
 
-    // find min/maxes, and handle the case where size is negative (assuming this is possible? Legacy code supported this)
-    float min_x = std::min(this->x_start, this->x_start + this->x_size);
-    float max_x = std::max(this->x_start, this->x_start + this->x_size);
-    float min_y = std::min(this->y_start, this->y_start + this->y_size);
-    float max_y = std::max(this->y_start, this->y_start + this->y_size);
-
     // clamp the input to the bounds of the compensation grid
     // if a point is beyond the bounds of the grid, it will get the offset of the closest grid point
-    float x_target = std::min(std::max(target[X_AXIS], min_x), max_x);
-    float y_target = std::min(std::max(target[Y_AXIS], min_y), max_y);
-
-    // we need to make sure that floor_x and floor_y are always < grid_size-1
-    float grid_x = std::max(0.001F, std::min(this->current_grid_x_size - 1.001F, (x_target - this->x_start) / (this->x_size / (this->current_grid_x_size - 1))));
-    float grid_y = std::max(0.001F, std::min(this->current_grid_x_size - 1.001F, (y_target - this->y_start) / (this->y_size / (this->current_grid_y_size - 1))));
-    int floor_x = floorf(grid_x);
-    int floor_y = floorf(grid_y);
-    float ratio_x = grid_x - floor_x;
-    float ratio_y = grid_y - floor_y;
-    float z1 = grid[(floor_x) + ((floor_y) * this->current_grid_x_size)];
-    float z2 = grid[(floor_x) + ((floor_y + 1) * this->current_grid_x_size)];
-    float z3 = grid[(floor_x + 1) + ((floor_y) * this->current_grid_x_size)];
-    float z4 = grid[(floor_x + 1) + ((floor_y + 1) * this->current_grid_x_size)];
-    float left = (1 - ratio_y) * z1 + ratio_y * z2;
-    float right = (1 - ratio_y) * z3 + ratio_y * z4;
-    float offset = (1 - ratio_x) * left + ratio_x * right;
+    float x_target = std::min(std::max(target[X_AXIS], this->min_x), this->max_x);
+    float y_target = std::min(std::max(target[Y_AXIS], this->min_y), this->max_y);
+
+    // the position in cells, only look for another cell when it has moved out of the last one
+    float grid_x = (x_target - this->x_start) * this->x_cells_per_mm;
+    float grid_y = (y_target - this->y_start) * this->y_cells_per_mm;
+    float offset;
+    if(bicubic) {
+        offset = interpolate(grid_x, grid_y);
+
+    } else {
+        if(!(grid_x >= last_cell_x && grid_x <= last_cell_x + 1) || !(grid_y >= last_cell_y && grid_y <= last_cell_y + 1)) {
+            last_cell_x = std::max(0, std::min(this->current_grid_x_size - 2, (int)floorf(grid_x)));
+            last_cell_y = std::max(0, std::min(this->current_grid_y_size - 2, (int)floorf(grid_y)));
+            if(cells != nullptr) {
+                last_cell = &cells[(last_cell_x + (last_cell_y * (this->current_grid_x_size - 1))) * 4];
+            } else {
+                cell_terms(one_cell, last_cell_x, last_cell_y);
+                last_cell = one_cell;
+            }
+        }
+        float u = grid_x - last_cell_x;
+        float v = grid_y - last_cell_y;
+        offset = last_cell[0] + u * last_cell[1] + v * (last_cell[2] + u * last_cell[3]);
+    }
 
     // handle case where the grid was incomplete (should never happen)
     if(isnan(offset)) return;
@@ -756,25 +865,213 @@ void CartGridStrategy::doCompensation(float *target, bool inverse)
     } else {
         target[Z_AXIS] += offset * scale;
     }
+}
 
-#if 0
-    THEKERNEL->streams->printf("//DEBUG: TARGET: %f, %f, %f\n", target[0], target[1], target[2]);
-    THEKERNEL->streams->printf("//DEBUG: grid_x= %f\n", grid_x);
-    THEKERNEL->streams->printf("//DEBUG: grid_y= %f\n", grid_y);
-    THEKERNEL->streams->printf("//DEBUG: floor_x= %d\n", floor_x);
-    THEKERNEL->streams->printf("//DEBUG: floor_y= %d\n", floor_y);
-    THEKERNEL->streams->printf("//DEBUG: ratio_x= %f\n", ratio_x);
-    THEKERNEL->streams->printf("//DEBUG: ratio_y= %f\n", ratio_y);
-    THEKERNEL->streams->printf("//DEBUG: z1= %f\n", z1);
-    THEKERNEL->streams->printf("//DEBUG: z2= %f\n", z2);
-    THEKERNEL->streams->printf("//DEBUG: z3= %f\n", z3);
-    THEKERNEL->streams->printf("//DEBUG: z4= %f\n", z4);
-    THEKERNEL->streams->printf("//DEBUG: left= %f\n", left);
-    THEKERNEL->streams->printf("//DEBUG: right= %f\n", right);
-    THEKERNEL->streams->printf("//DEBUG: offset= %f\n", offset);
-    THEKERNEL->streams->printf("//DEBUG: scale= %f\n", scale);
-    THEKERNEL->streams->printf("//DEBUG: adjustment= %f\n", offset*scale);
-#endif
+// the fraction along the line from start to end after t where it next crosses a grid line, the grid lines are where the slope
+// of the surface changes, 1 if it does not cross another one
+float CartGridStrategy::nextCellBoundary(const float *start, const float *end, float t)
+{
+    float next = 1.0F;
+    const float per_mm[2] = {this->x_cells_per_mm, this->y_cells_per_mm};
+    const float origin[2] = {this->x_start, this->y_start};
+    const int last_line[2] = {this->current_grid_x_size - 1, this->current_grid_y_size - 1};
+
+    for (int a = X_AXIS; a <= Y_AXIS; a++) {
+        float g0 = (start[a] - origin[a]) * per_mm[a];
+        float dg = (end[a] - start[a]) * per_mm[a];
+        if(fabsf(dg) < 0.0001F) continue;
+
+        // the next grid line in the direction of travel, stepping past one that t is already on
+        float g = g0 + t * dg;
+        int line = (dg > 0) ? (int)floorf(g + 0.0001F) + 1 : (int)ceilf(g - 0.0001F) - 1;
+        if(line < 0 || line > last_line[a]) continue;
+
+        float tl = (line - g0) / dg;
+        if(tl > t && tl < next) next = tl;
+    }
+
+    return next;
+}
+
+// works out the bilinear terms of every cell of the current grid and the bounds, when the grid has changed
+void CartGridStrategy::update_cells()
+{
+    // find min/maxes, and handle the case where size is negative (assuming this is possible? Legacy code supported this)
+    this->min_x = std::min(this->x_start, this->x_start + this->x_size);
+    this->max_x = std::max(this->x_start, this->x_start + this->x_size);
+    this->min_y = std::min(this->y_start, this->y_start + this->y_size);
+    this->max_y = std::max(this->y_start, this->y_start + this->y_size);
+    this->x_cells_per_mm = (this->current_grid_x_size - 1) / this->x_size;
+    this->y_cells_per_mm = (this->current_grid_y_size - 1) / this->y_size;
+
+    if(cells == nullptr) {
+        // outside the grid so the first position works out the cell it is in
+        last_cell_x = -2;
+        last_cell_y = -2;
+        return;
+    }
+
+    for (int y = 0; y < current_grid_y_size - 1; y++) {
+        for (int x = 0; x < current_grid_x_size - 1; x++) {
+            cell_terms(&cells[(x + (y * (current_grid_x_size - 1))) * 4], x, y);
+        }
+    }
+
+    last_cell_x = 0;
+    last_cell_y = 0;
+    last_cell = cells;
+}
+
+// the bilinear terms of the cell with its lower corner at grid point x, y
+void CartGridStrategy::cell_terms(float *c, int x, int y)
+{
+    // the values are copied out of each row as reading the next one can replace it in the cache
+    const float *r = row(y);
+    float z1 = r[x], z3 = r[x + 1];
+    r = row(y + 1);
+    float z2 = r[x], z4 = r[x + 1];
+    c[0] = z1;
+    c[1] = z3 - z1;
+    c[2] = z2 - z1;
+    c[3] = z4 - z3 - z2 + z1;
+}
+
+// Catmull-Rom through p[1] and p[2], t is 0 to 1 between them
+static float cubic(const float p[4], float t)
+{
+    return p[1] + 0.5F * t * (p[2] - p[0] + t * (2.0F * p[0] - 5.0F * p[1] + 4.0F * p[2] - p[3] + t * (3.0F * (p[1] - p[2]) + p[3] - p[0])));
+}
+
+// the bicubic offset at a position in cells, worked out from the 4x4 grid points around the cell each time.
+// The points past the edges of the grid are taken as the edge ones
+float CartGridStrategy::interpolate(float grid_x, float grid_y)
+{
+    int cx = std::max(0, std::min(this->current_grid_x_size - 2, (int)floorf(grid_x)));
+    int cy = std::max(0, std::min(this->current_grid_y_size - 2, (int)floorf(grid_y)));
+    float u = grid_x - cx;
+    float v = grid_y - cy;
+
+    // the values are copied out of each row as reading the next one can replace it in the cache
+    int xs[4];
+    for (int i = 0; i < 4; i++) xs[i] = std::max(0, std::min(this->current_grid_x_size - 1, cx + i - 1));
+
+    float column[4];
+    for (int j = 0; j < 4; j++) {
+        const float *r = row(std::max(0, std::min(this->current_grid_y_size - 1, cy + j - 1)));
+        float p[4] = {r[xs[0]], r[xs[1]], r[xs[2]], r[xs[3]]};
+        column[j] = cubic(p, u);
+    }
+    return cubic(column, v);
+}
+
+// a row of the grid, when it is paged it is read into the cache if it is not there already, replacing the oldest one read
+const float *CartGridStrategy::row(int y)
+{
+    if(cache_rows == 0) return &grid[current_grid_x_size * y];
+
+    for (int i = 0; i < cache_rows; i++) {
+        if(cached_row[i] == y) return &grid[configured_grid_x_size * i];
+    }
+
+    int slot = next_cache_slot;
+    next_cache_slot = (next_cache_slot + 1) % cache_rows;
+    float *r = &grid[configured_grid_x_size * slot];
+    cached_row[slot] = y;
+
+    if(grid_file == nullptr || fseek(grid_file, GRIDFILE_PAGED_HEADER + (current_grid_x_size * y * sizeof(float)), SEEK_SET) != 0 ||
+       fread(r, sizeof(float), current_grid_x_size, grid_file) != current_grid_x_size) {
+        // no grid, or it could not be read so do not compensate with it
+        for (int x = 0; x < current_grid_x_size; x++) r[x] = NAN;
+        cached_row[slot] = -1;
+    }
+
+    return r;
+}
+
+bool CartGridStrategy::set_grid_value(int x, int y, float z)
+{
+    if(cache_rows == 0) {
+        grid[x + (current_grid_x_size * y)] = z;
+        return true;
+    }
+
+    // write it through to the file and to the cache if the row is there
+    for (int i = 0; i < cache_rows; i++) {
+        if(cached_row[i] == y) grid[x + (configured_grid_x_size * i)] = z;
+    }
+
+    return grid_file != nullptr && fseek(grid_file, GRIDFILE_PAGED_HEADER + ((x + (current_grid_x_size * y)) * sizeof(float)), SEEK_SET) == 0 &&
+           fwrite(&z, sizeof(float), 1, grid_file) == 1;
+}
+
+// starts a new paged grid file for the current grid size with every point unset, so an unfinished probe is not used.
+// it is written beside the saved grid, which is only replaced by finish_grid_file()
+bool CartGridStrategy::start_grid_file(StreamOutput *stream)
+{
+    close_grid_file();
+    grid_file = fopen(GRIDFILE_PAGED_NEW, "w+");
+    if(grid_file == nullptr) {
+        stream->printf("error:Failed to open grid file %s\n", GRIDFILE_PAGED_NEW);
+        return false;
+    }
+    grid_file_is_new = true;
+
+    uint8_t sizes[2] = {current_grid_x_size, current_grid_y_size};
+    bool ok = fwrite(sizes, sizeof(uint8_t), 2, grid_file) == 2 && fwrite(&x_size, sizeof(float), 1, grid_file) == 1 &&
+              fwrite(&y_size, sizeof(float), 1, grid_file) == 1;
+
+    // the first cache row is used to write them out a row at a time
+    for (int x = 0; x < current_grid_x_size; x++) grid[x] = NAN;
+    for (int y = 0; ok && y < current_grid_y_size; y++) {
+        ok = fwrite(grid, sizeof(float), current_grid_x_size, grid_file) == current_grid_x_size;
+    }
+
+    if(!ok) {
+        stream->printf("error:Failed to write grid file %s\n", GRIDFILE_PAGED_NEW);
+        close_grid_file();
+        remove(GRIDFILE_PAGED_NEW);
+        return false;
+    }
+
+    return true;
+}
+
+// the probe completed, so the new grid replaces the saved one and is used from there
+bool CartGridStrategy::finish_grid_file(StreamOutput *stream)
+{
+    close_grid_file();
+    remove(GRIDFILE_PAGED); // rename will not replace a file
+    if(rename(GRIDFILE_PAGED_NEW, GRIDFILE_PAGED) != 0) {
+        stream->printf("error:Failed to rename grid file %s to %s\n", GRIDFILE_PAGED_NEW, GRIDFILE_PAGED);
+        return false;
+    }
+
+    grid_file = fopen(GRIDFILE_PAGED, "r+");
+    if(grid_file == nullptr) {
+        stream->printf("error:Failed to open grid file %s\n", GRIDFILE_PAGED);
+        return false;
+    }
+
+    return true;
+}
+
+void CartGridStrategy::close_grid_file()
+{
+    if(grid_file != nullptr) {
+        fclose(grid_file);
+        grid_file = nullptr;
+    }
+    grid_file_is_new = false;
+    if(cached_row != nullptr) {
+        for (int i = 0; i < cache_rows; i++) cached_row[i] = -1;
+    }
+}
+
+// we use a different file format depending on whether it is square or not, or paged
+const char *CartGridStrategy::grid_filename() const
+{
+    if(cache_rows > 0) return GRIDFILE_PAGED;
+    return (this->new_file_format) ? GRIDFILE_NM : GRIDFILE;
 }
 
 
@@ -784,7 +1081,7 @@ void CartGridStrategy::print_bed_level(StreamOutput *stream)
     if(!human_readable){
         for (int y = 0; y < current_grid_y_size; y++) {
             for (int x = 0; x < current_grid_x_size; x++) {
-                stream->printf("%1.4f ", grid[x + (current_grid_x_size * y)]);
+                stream->printf("%1.4f ", grid_value(x, y));
             }
             stream->printf("\n");
         }
@@ -801,7 +1098,7 @@ void CartGridStrategy::print_bed_level(StreamOutput *stream)
         for (int y = yStart; y != yStop; y += yInc) {
             stream->printf("%10.4f|", y * (y_size / (current_grid_y_size - 1)));
             for (int x = xStart; x != xStop; x += xInc) {
-                stream->printf("%10.4f ",  grid[x + (current_grid_x_size * y)]);
+                stream->printf("%10.4f ",  grid_value(x, y));
             }
             stream->printf("\n");
         }
@@ -823,6 +1120,12 @@ void CartGridStrategy::print_bed_level(StreamOutput *stream)
 // Reset calibration results to zero.
 void CartGridStrategy::reset_bed_level()
 {
+    if(cache_rows > 0) {
+        // the saved grid is still there for M375
+        close_grid_file();
+        return;
+    }
+
     for (int y = 0; y < current_grid_y_size; y++) {
         for (int x = 0; x < current_grid_x_size; x++) {
             grid[x + (current_grid_x_size * y)] = NAN;
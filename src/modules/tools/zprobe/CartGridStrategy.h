@@ -3,6 +3,7 @@
 #include "LevelingStrategy.h"
 
 #include <string.h>
+#include <stdio.h>
 #include <tuple>
 
 #define cart_grid_leveling_strategy_checksum CHECKSUM("rectangular-grid")
@@ -26,6 +27,17 @@ private:
     void setAdjustFunction(bool on);
     void print_bed_level(StreamOutput *stream);
     void doCompensation(float *target, bool inverse);
+    float nextCellBoundary(const float *start, const float *end, float t);
+    void update_cells();
+    void cell_terms(float *c, int x, int y);
+    float interpolate(float grid_x, float grid_y);
+    const float *row(int y);
+    float grid_value(int x, int y) { return row(y)[x]; }
+    bool set_grid_value(int x, int y, float z);
+    bool start_grid_file(StreamOutput *stream);
+    bool finish_grid_file(StreamOutput *stream);
+    void close_grid_file();
+    const char *grid_filename() const;
     void reset_bed_level();
     void save_grid(StreamOutput *stream);
     bool load_grid(StreamOutput *stream);
@@ -38,7 +50,19 @@ private:
     float damping_interval;
     std::string before_probe, after_probe;
 
+    // all of the grid, or when it is paged from the sd card the rows of it that are held in memory
     float *grid;
+    FILE *grid_file;
+    int16_t *cached_row; // the grid row held in each of the cache_rows slots of grid, -1 if none
+    // the bilinear terms of each cell, offset = a + b*u + c*v + d*u*v where u and v are 0 to 1 across the cell,
+    // nullptr when they did not fit in memory or the grid is paged, then only those of the last cell are kept in one_cell
+    float *cells;
+    float one_cell[4];
+    float min_x, max_x, min_y, max_y;
+    float x_cells_per_mm, y_cells_per_mm;
+    // the cell the last compensated position was in, consecutive segments are usually in the same one
+    int16_t last_cell_x, last_cell_y;
+    const float *last_cell;
     std::tuple<float, float, float> probe_offsets;
     float *m_attach;
     float x_start,y_start;
@@ -49,6 +73,8 @@ private:
         uint8_t configured_grid_y_size:8;
         uint8_t current_grid_x_size:8;
         uint8_t current_grid_y_size:8;
+        uint8_t cache_rows:8; // 0 if all of the grid is in memory
+        uint8_t next_cache_slot:8;
     };
 
     struct {
@@ -58,5 +84,8 @@ private:
         bool only_by_two_corners:1;
         bool human_readable:1;
         bool new_file_format:1;
+        bool segment_at_cells:1;
+        bool bicubic:1;
+        bool grid_file_is_new:1; // grid_file is GRIDFILE_PAGED_NEW being probed
     };
 };
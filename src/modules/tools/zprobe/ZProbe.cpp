@@ -27,6 +27,7 @@
 #include "LevelingStrategy.h"
 #include "StepTicker.h"
 #include "utils.h"
+#include "InterruptIn.h" // mbed
 
 // strategies we know about
 #include "DeltaCalibrationStrategy.h"
@@ -46,6 +47,7 @@
 #define max_z_checksum           CHECKSUM("max_z")
 #define reverse_z_direction_checksum CHECKSUM("reverse_z")
 #define dwell_before_probing_checksum CHECKSUM("dwell_before_probing")
+#define probe_interrupt_checksum CHECKSUM("probe_interrupt")
 
 // from endstop section
 #define delta_homing_checksum    CHECKSUM("delta_homing")
@@ -86,6 +88,19 @@ void ZProbe::config_load()
     this->calibrate_pin.from_string( THEKERNEL->config->value(zprobe_checksum, calibrate_pin_checksum)->by_default("nc" )->as_string())->as_input();
     this->debounce_ms    = THEKERNEL->config->value(zprobe_checksum, debounce_ms_checksum)->by_default(0  )->as_number();
 
+    // the probe pin can also interrupt on either edge so the move stops without waiting for it to be polled, only pins on
+    // port 0 and 2 can do this. it is still polled every millisecond as the interrupt misses a probe that was already triggered
+    if(THEKERNEL->config->value(zprobe_checksum, probe_interrupt_checksum)->by_default(false)->as_bool()) {
+        Pin irq_pin= this->pin;
+        this->probe_irq= irq_pin.interrupt_pin();
+        if(this->probe_irq == nullptr) {
+            THEKERNEL->streams->printf("Error: ZProbe interrupt needs the probe pin on port 0 or 2, it will only be polled\n");
+        } else {
+            this->probe_irq->rise(this, &ZProbe::on_probe_edge);
+            this->probe_irq->fall(this, &ZProbe::on_probe_edge);
+        }
+    }
+
     // get strategies to load
     vector<uint16_t> modules;
     THEKERNEL->config->get_module_list( &modules, leveling_strategy_checksum);
@@ -155,7 +170,8 @@ void ZProbe::config_load()
 
 uint32_t ZProbe::read_probe(uint32_t dummy)
 {
-    if(!probing || probe_detected) return 0;
+    // the interrupt has already stopped the move, confirm_probe() debounces it
+    if(!probing || probe_detected || probe_latched) return 0;
 
     // we check all axis as it maybe a G38.2 X10 for instance, not just a probe in Z
     if(STEPPER[X_AXIS]->is_moving() || STEPPER[Y_AXIS]->is_moving() || STEPPER[Z_AXIS]->is_moving()) {
@@ -180,6 +196,30 @@ uint32_t ZProbe::read_probe(uint32_t dummy)
     return 0;
 }
 
+// called from the pin interrupt on either edge of the probe, the first trigger while probing stops all the motors
+// straight away and records where they were, the debounce is then done by confirm_probe() once they have stopped
+void ZProbe::on_probe_edge()
+{
+    if(!probing || probe_latched || probe_detected || this->pin.get() == invert_probe) return;
+
+    for (size_t i = 0; i < THEROBOT->actuators.size(); i++) {
+        latched_steps[i]= STEPPER[i]->get_current_step();
+    }
+    // we do all motors as it may be a delta
+    for(auto &a : THEROBOT->actuators) a->stop_moving();
+    probe_latched= true;
+}
+
+// the probe has to stay triggered for debounce_ms after the interrupt stopped the moves, otherwise it was noise
+bool ZProbe::confirm_probe()
+{
+    for (uint16_t i = 0; i < debounce_ms; i++) {
+        if(this->pin.get() == invert_probe) return false;
+        safe_delay_ms(1);
+    }
+    return this->pin.get() != invert_probe;
+}
+
 uint32_t ZProbe::read_calibrate(uint32_t dummy)
 {
     if (!calibrating || calibrate_detected) return 0;
@@ -213,16 +253,20 @@ bool ZProbe::run_probe(float& mm, float feedrate, float max_dist, bool reverse)
 {
     if(dwell_before_probing > .0001F) safe_delay_ms(dwell_before_probing*1000);
 
-    if(this->pin.get()) {
-        // probe already triggered so abort
-        return false;
-    }
     float maxz= max_dist < 0 ? this->max_z*2 : max_dist;
 
     probing= true;
     probe_detected= false;
+    probe_latched= false;
     debounce= 0;
 
+    // checked once probing is set so a trigger from here on is seen by the interrupt or the polling
+    if(this->pin.get()) {
+        // probe already triggered so abort
+        probing= false;
+        return false;
+    }
+
     // save current actuator position so we can report how far we moved
     float z_start_pos= THEROBOT->actuators[Z_AXIS]->get_current_position();
 
@@ -235,17 +279,22 @@ bool ZProbe::run_probe(float& mm, float feedrate, float max_dist, bool reverse)
     // wait until finished
     THECONVEYOR->wait_for_idle();
     if(THEKERNEL->is_halted()) return false;
+    if(probe_latched) probe_detected= confirm_probe();
 
-    // now see how far we moved, get delta in z we moved
+    // now see how far we moved, get delta in z we moved, to where the probe triggered if that was latched
     // NOTE this works for deltas as well as all three actuators move the same amount in Z
-    mm= z_start_pos - THEROBOT->actuators[2]->get_current_position();
+    if(probe_detected && probe_latched) {
+        mm= z_start_pos - latched_steps[Z_AXIS] / Z_STEPS_PER_MM;
+    } else {
+        mm= z_start_pos - THEROBOT->actuators[2]->get_current_position();
+    }
 
     // set the last probe position to the actuator units moved during this home
     THEROBOT->set_last_probe_position(std::make_tuple(0, 0, mm, probe_detected?1:0));
 
     probing= false;
 
-    if(probe_detected) {
+    if(probe_detected || probe_latched) {
         // if the probe stopped the move we need to correct the last_milestone as it did not reach where it thought
         THEROBOT->reset_position_from_current_actuator_position();
     }
@@ -454,16 +503,19 @@ void ZProbe::probe_XYZ(Gcode *gcode)
     // first wait for all moves to finish
     THEKERNEL->conveyor->wait_for_idle();
 
+    // enable the probe checking in the timer and the interrupt
+    probing= true;
+    probe_detected= false;
+    probe_latched= false;
+    debounce= 0;
+
+    // checked once probing is set so a trigger from here on is seen by the interrupt or the polling
     if(this->pin.get() != invert_probe) {
+        probing= false;
         gcode->stream->printf("error:ZProbe triggered before move, aborting command.\n");
         return;
     }
 
-    // enable the probe checking in the timer
-    probing= true;
-    probe_detected= false;
-    debounce= 0;
-
     // do a delta move which will stop as soon as the probe is triggered, or the distance is reached
     float delta[3]= {x, y, z};
     if(!THEROBOT->delta_move(delta, rate, 3)) {
@@ -473,6 +525,7 @@ void ZProbe::probe_XYZ(Gcode *gcode)
     }
 
     THEKERNEL->conveyor->wait_for_idle();
+    if(probe_latched) probe_detected= confirm_probe();
 
     // disable probe checking
     probing= false;
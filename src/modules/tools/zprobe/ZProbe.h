@@ -10,6 +10,7 @@
 
 #include "Module.h"
 #include "Pin.h"
+#include "ActuatorCoordinates.h"
 
 #include <vector>
 
@@ -26,7 +27,7 @@ class ZProbe: public Module
 {
 
 public:
-    ZProbe() : invert_override(false),invert_probe(false) {};
+    ZProbe() : probe_irq(nullptr), invert_override(false),invert_probe(false) {};
     virtual ~ZProbe() {};
 
     void on_module_loaded();
@@ -51,6 +52,8 @@ private:
     void calibrate_Z(Gcode *gc);
     uint32_t read_probe(uint32_t dummy);
     uint32_t read_calibrate(uint32_t dummy);
+    void on_probe_edge();
+    bool confirm_probe();
     void on_get_public_data(void* argument);
 
     float slow_feedrate;
@@ -65,6 +68,10 @@ private:
     std::vector<LevelingStrategy*> strategies;
     uint16_t debounce_ms, debounce;
 
+    // when set the probe is read by an edge interrupt, which latches where each actuator was when it triggered
+    mbed::InterruptIn *probe_irq;
+    int32_t latched_steps[k_max_actuators];
+
     volatile struct {
         bool is_delta:1;
         bool is_rdelta:1;
@@ -74,6 +81,7 @@ private:
         bool invert_override:1;
         bool invert_probe:1;
         volatile bool probe_detected:1;
+        volatile bool probe_latched:1;
         volatile bool calibrate_detected:1;
     };
 };
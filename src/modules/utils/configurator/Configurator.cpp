@@ -130,3 +130,13 @@ void Configurator::config_load_command( string parameters, StreamOutput *stream
     }
 }
 
+// Parse the config files and save them compiled so the next boot does not have to parse them
+void Configurator::config_compile_command( string parameters, StreamOutput *stream )
+{
+    int n = THEKERNEL->config->config_compile();
+    if(n < 0) {
+        stream->printf( "config could not be compiled, there must be a config file on the sd card that does not include others\r\n" );
+    } else {
+        stream->printf( "config compiled: %d values\r\n", n );
+    }
+}
@@ -22,6 +22,7 @@ public:
     void config_get_command( string parameters, StreamOutput *stream );
     void config_set_command( string parameters, StreamOutput *stream );
     void config_load_command(string parameters, StreamOutput *stream );
+    void config_compile_command(string parameters, StreamOutput *stream );
 };
 
 
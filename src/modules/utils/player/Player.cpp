@@ -31,6 +31,7 @@
 #include "ExtruderPublicAccess.h"
 #include "StepTicker.h"
 #include "Block.h"
+#include "Inflater.h"
 
 #include <cstddef>
 #include <cmath>
@@ -43,6 +44,16 @@
 #define after_suspend_gcode_checksum      CHECKSUM("after_suspend_gcode")
 #define before_resume_gcode_checksum      CHECKSUM("before_resume_gcode")
 #define leave_heaters_on_suspend_checksum CHECKSUM("leave_heaters_on_suspend")
+#define player_batch_fill_checksum        CHECKSUM("player_batch_fill")
+#define player_batch_time_ms_checksum     CHECKSUM("player_batch_time_ms")
+
+#define READ_BUFFER_SIZE 2048
+
+// the line index file, made the first time a file is played from a line other than the first
+// the magic, the size of the file it indexes, then the byte offset of the start of every LINE_INDEX_INTERVAL'th line
+#define LINE_INDEX_MAGIC "GIX1"
+#define LINE_INDEX_INTERVAL 1024
+#define LINE_INDEX_HEADER_SIZE 8
 
 extern SDFAT mounter;
 
@@ -50,6 +61,9 @@ Player::Player()
 {
     this->playing_file = false;
     this->current_file_handler = nullptr;
+    this->inflater = nullptr;
+    this->read_buffer = nullptr;
+    this->read_pos = this->read_end = 0;
     this->booted = false;
     this->elapsed_secs = 0;
     this->reply_stream = nullptr;
@@ -76,6 +90,10 @@ void Player::on_module_loaded()
     std::replace( this->after_suspend_gcode.begin(), this->after_suspend_gcode.end(), '_', ' '); // replace _ with space
     std::replace( this->before_resume_gcode.begin(), this->before_resume_gcode.end(), '_', ' '); // replace _ with space
     this->leave_heaters_on = THEKERNEL->config->value(leave_heaters_on_suspend_checksum)->by_default(false)->as_bool();
+
+    // percentage of the block queue to fill before handing back to the main loop, and the longest we can take doing it
+    this->batch_fill = std::max(0.0F, std::min(100.0F, THEKERNEL->config->value(player_batch_fill_checksum)->by_default(0)->as_number())) / 100.0F;
+    this->batch_time_us = THEKERNEL->config->value(player_batch_time_ms_checksum)->by_default(5)->as_number() * 1000;
 }
 
 void Player::on_halt(void* argument)
@@ -132,7 +150,7 @@ void Player::on_gcode_received(void *argument)
 
             if(this->current_file_handler != NULL) {
                 this->playing_file = false;
-                fclose(this->current_file_handler);
+                close_file();
             }
             this->current_file_handler = fopen( this->filename.c_str(), "r");
 
@@ -149,6 +167,7 @@ void Player::on_gcode_received(void *argument)
                     this->file_size = ftell(this->current_file_handler);
                     fseek(this->current_file_handler, 0, SEEK_SET);
                 }
+                this->inflater = Inflater::open(this->current_file_handler);
                 gcode->stream->printf("File opened:%s Size:%ld\r\n", this->filename.c_str(), this->file_size);
                 gcode->stream->printf("File selected\r\n");
             }
@@ -186,6 +205,7 @@ void Player::on_gcode_received(void *argument)
                     if(this->current_file_handler == NULL) {
                         gcode->stream->printf("file.open failed: %s\r\n", currentfn.c_str());
                     } else {
+                        this->inflater = Inflater::open(this->current_file_handler);
                         this->filename = currentfn;
                         this->file_size = old_size;
                         this->current_stream = nullptr;
@@ -205,7 +225,7 @@ void Player::on_gcode_received(void *argument)
 
             if(this->current_file_handler != NULL) {
                 this->playing_file = false;
-                fclose(this->current_file_handler);
+                close_file();
             }
 
             this->current_file_handler = fopen( this->filename.c_str(), "r");
@@ -222,6 +242,7 @@ void Player::on_gcode_received(void *argument)
                         file_size = ftell(this->current_file_handler);
                         fseek(this->current_file_handler, 0, SEEK_SET);
                 }
+                this->inflater = Inflater::open(this->current_file_handler);
             }
 
             this->played_cnt = 0;
@@ -305,7 +326,7 @@ void Player::play_command( string parameters, StreamOutput *stream )
     }
 
     if(this->current_file_handler != NULL) { // must have been a paused print
-        fclose(this->current_file_handler);
+        close_file();
     }
 
     this->current_file_handler = fopen( this->filename.c_str(), "r");
@@ -336,11 +357,45 @@ void Player::play_command( string parameters, StreamOutput *stream )
         fseek(this->current_file_handler, 0, SEEK_SET);
         stream->printf("  File size %ld\r\n", file_size);
     }
+    this->inflater = Inflater::open(this->current_file_handler);
+    if(this->inflater != nullptr) {
+        stream->printf("  File is compressed\r\n");
+    }
     this->played_cnt = 0;
     this->played_lines = 0;
     this->elapsed_secs = 0;
     this->playing_lines = 0;
 
+    // start part way through the file, -l<line> to start at a line or -o<offset> to start at the line at a byte offset
+    // as shown by progress, after a tool break or a power loss
+    size_t pos;
+    if((pos = options.find("-l")) != string::npos) {
+        unsigned long line = strtoul(options.c_str() + pos + 2, nullptr, 10);
+        if(line > 1 && !seek_line(line, stream)) {
+            if(THEKERNEL->is_halted()) stream->printf("Seek aborted by kill\r\n");
+            else stream->printf("File has less than %lu lines\r\n", line);
+            this->playing_file = false;
+            close_file();
+            return;
+        }
+
+    } else if((pos = options.find("-o")) != string::npos) {
+        unsigned long offset = strtoul(options.c_str() + pos + 2, nullptr, 10);
+        if(this->inflater != nullptr) {
+            stream->printf("  Can not start a compressed file at an offset, use -l\r\n");
+            offset = 0;
+        }
+        if(offset > 0) {
+            if(!seek_to(offset)) {
+                stream->printf("File is not %lu bytes long\r\n", offset);
+                this->playing_file = false;
+                close_file();
+                return;
+            }
+            stream->printf("  Starting at byte %lu\r\n", played_cnt);
+        }
+    }
+
     // force into absolute mode
     THEROBOT->absolute_mode = true;
     THEROBOT->e_absolute_mode = true;
@@ -380,6 +435,9 @@ void Player::progress_command( string parameters, StreamOutput *stream )
             if(est > 0) {
                 stream->printf(", est time: %02lu:%02lu:%02lu",  est / 3600, (est % 3600) / 60, est % 60);
             }
+            if(this->elapsed_secs > 0) {
+                stream->printf(", %lu lines/sec", this->played_lines / this->elapsed_secs);
+            }
             stream->printf("\r\n");
         } else {
             stream->printf("SD printing byte %lu/%lu\r\n", played_cnt, file_size);
@@ -405,8 +463,7 @@ void Player::abort_command( string parameters, StreamOutput *stream )
     this->clear_buffered_queue();
     this->filename = "";
     this->current_stream = NULL;
-    fclose(current_file_handler);
-    current_file_handler = NULL;
+    close_file();
     if(parameters.empty()) {
         // clear out the block queue, will wait until queue is empty
         // MUST be called in on_main_loop to make sure there are no blocked main loops waiting to put something on the queue
@@ -426,6 +483,9 @@ void Player::clear_buffered_queue(){
 
 void Player::on_main_loop(void *argument)
 {
+    // while a file is played the queue running dry is an underrun, once it has all been read it is the end of the job
+    THECONVEYOR->set_playing(this->playing_file);
+
     if(suspended && suspend_loops > 0) {
         // if we are suspended we need to allow main loop to cycle a few times then finish off the suspend processing
         if(--suspend_loops == 0) {
@@ -464,11 +524,12 @@ void Player::on_main_loop(void *argument)
 
         char buf[130]; // lines upto 128 characters are allowed, anything longer is discarded
         bool discard = false;
+        uint32_t start_us = us_ticker_read();
 
-        while(fgets(buf, sizeof(buf), this->current_file_handler) != NULL) {
+        while(read_line(buf, sizeof(buf)) != NULL) {
             int len = strlen(buf);
             if(len == 0) continue; // empty line? should not be possible
-            if(buf[len - 1] == '\n' || feof(this->current_file_handler)) {
+            if(is_line_end(buf, len)) {
                 if(discard) { // we are discarding a long line
                     discard = false;
                     continue;
@@ -487,8 +548,12 @@ void Player::on_main_loop(void *argument)
                 // waits for the queue to have enough room
                 THEKERNEL->call_event(ON_CONSOLE_LINE_RECEIVED, &message);
                 played_lines += 1;
-                played_cnt += len;
-                return; // we feed one line per main loop
+                // for compressed files progress is measured in bytes of the file not decompressed bytes
+                played_cnt = this->inflater != nullptr ? this->inflater->get_bytes_read() : played_cnt + len;
+
+                // we feed one line per main loop unless batching and the planner needs more
+                if(!can_batch(start_us)) return;
+                continue;
 
             } else {
                 // discard long line
@@ -497,14 +562,17 @@ void Player::on_main_loop(void *argument)
             }
         }
 
+        if(this->inflater != nullptr && this->inflater->is_error()) {
+            THEKERNEL->streams->printf("Warning: compressed file %s is corrupt, stopped playing at line %lu\r\n", this->filename.c_str(), played_lines);
+        }
+
         this->playing_file = false;
         this->filename = "";
         played_cnt = 0;
         played_lines = 0;
         playing_lines = 0;
         file_size = 0;
-        fclose(this->current_file_handler);
-        current_file_handler = NULL;
+        close_file();
         this->current_stream = NULL;
 
         if(this->reply_stream != NULL) {
@@ -515,6 +583,238 @@ void Player::on_main_loop(void *argument)
     }
 }
 
+void Player::close_file()
+{
+    delete this->inflater;
+    this->inflater = nullptr;
+    delete [] this->read_buffer;
+    this->read_buffer = nullptr;
+    this->read_pos = this->read_end = 0;
+    fclose(this->current_file_handler);
+    this->current_file_handler = NULL;
+}
+
+// read the next line of the file, decompressing it if it is a compressed file
+// plain files are read a large block at a time which is much faster from the SD card than fgets
+char *Player::read_line(char *buf, int size)
+{
+    if(this->inflater != nullptr) {
+        return this->inflater->gets(buf, size);
+    }
+
+    int n = 0;
+    while(n < size - 1) {
+        if(this->read_pos >= this->read_end && !fill_read_buffer()) break;
+
+        // copy upto and including the next newline, or as much as fits
+        const char *p = &this->read_buffer[this->read_pos];
+        int cnt = std::min(this->read_end - this->read_pos, size - 1 - n);
+        const char *nl = (const char *)memchr(p, '\n', cnt);
+        if(nl != nullptr) cnt = nl - p + 1;
+        memcpy(&buf[n], p, cnt);
+        n += cnt;
+        this->read_pos += cnt;
+        if(nl != nullptr) break;
+    }
+
+    if(n == 0) return NULL;
+    buf[n] = '\0';
+    return buf;
+}
+
+// read the next block of a plain file, false at the end of the file
+bool Player::fill_read_buffer()
+{
+    if(this->read_buffer == nullptr) {
+        this->read_buffer = new char[READ_BUFFER_SIZE];
+    }
+    this->read_pos = 0;
+    this->read_end = fread(this->read_buffer, 1, READ_BUFFER_SIZE, this->current_file_handler);
+    return this->read_end > 0;
+}
+
+// skip the next n lines, played_cnt is kept as the offset of the next line, false if the file ends first or on a halt
+// a long skip can read most of a big file, so the other modules get to run (and the watchdog gets fed) as it goes
+bool Player::skip_lines(unsigned long n)
+{
+    if(this->inflater != nullptr) {
+        char buf[130];
+        unsigned int cnt = 0;
+        while(n > 0) {
+            if((++cnt % 256) == 0) {
+                THEKERNEL->call_event(ON_IDLE, this);
+                if(THEKERNEL->is_halted()) return false;
+            }
+            if(this->inflater->gets(buf, sizeof(buf)) == nullptr) return false;
+            if(buf[strlen(buf) - 1] == '\n') --n;
+        }
+        played_cnt = this->inflater->get_bytes_read();
+        return true;
+    }
+
+    while(n > 0) {
+        if(this->read_pos >= this->read_end) {
+            if(n > 1) {
+                THEKERNEL->call_event(ON_IDLE, this);
+                if(THEKERNEL->is_halted()) return false;
+            }
+            if(!fill_read_buffer()) return false;
+        }
+        const char *p = &this->read_buffer[this->read_pos];
+        int cnt = this->read_end - this->read_pos;
+        const char *nl = (const char *)memchr(p, '\n', cnt);
+        if(nl != nullptr) {
+            cnt = nl - p + 1;
+            --n;
+        }
+        this->read_pos += cnt;
+        played_cnt += cnt;
+    }
+    return true;
+}
+
+// move a plain file to the start of the first line at or after offset, false if there is no such line
+bool Player::seek_to(unsigned long offset)
+{
+    this->read_pos = this->read_end = 0;
+    if(offset == 0) {
+        played_cnt = 0;
+        return fseek(this->current_file_handler, 0, SEEK_SET) == 0;
+    }
+    if(offset >= (unsigned long)file_size || fseek(this->current_file_handler, offset - 1, SEEK_SET) != 0) return false;
+
+    // the line starts at offset if the byte before it is a newline
+    played_cnt = offset - 1;
+    return skip_lines(1) && played_cnt < (unsigned long)file_size;
+}
+
+// move to the start of line, where 1 is the first line of the file
+// plain files use the line index to get within LINE_INDEX_INTERVAL lines of it then read the rest,
+// with fast seek enabled that is quick however big the file is, compressed files have to be read from the start
+bool Player::seek_line(unsigned long line, StreamOutput *stream)
+{
+    unsigned long at = 1;
+    if(this->inflater == nullptr && line > LINE_INDEX_INTERVAL) {
+        string index_file = this->filename + ".idx";
+        at = seek_indexed_line(index_file, line);
+        if(at == 1) {
+            // there is no index yet or it was out of date
+            stream->printf("  Building line index %s\r\n", index_file.c_str());
+            if(build_line_index(index_file)) {
+                at = seek_indexed_line(index_file, line);
+            } else if(THEKERNEL->is_halted()) {
+                return false;
+            } else {
+                stream->printf("  Could not save the line index\r\n");
+            }
+        }
+    }
+
+    if(at == 1) {
+        if(this->inflater != nullptr) {
+            // the inflater is at the start of the data already
+            played_cnt = this->inflater->get_bytes_read();
+        } else if(!seek_to(0)) {
+            return false;
+        }
+    }
+
+    if(!skip_lines(line - at)) return false;
+    played_lines = line - 1;
+    stream->printf("  Starting at line %lu, byte %lu\r\n", line, played_cnt);
+    return true;
+}
+
+// move to the last indexed line before line and return its line number, or 1 if the index is missing or out of date
+unsigned long Player::seek_indexed_line(const string& index_file, unsigned long line)
+{
+    FILE *fp = fopen(index_file.c_str(), "r");
+    if(fp == NULL) return 1;
+
+    unsigned long at = 1;
+    uint32_t offset = 0;
+    char magic[4];
+    uint32_t size;
+    if(fread(magic, 1, 4, fp) == 4 && memcmp(magic, LINE_INDEX_MAGIC, 4) == 0 &&
+       fread(&size, sizeof(size), 1, fp) == 1 && size == (uint32_t)file_size) {
+        // use the last entry if the line is past the end of the index
+        fseek(fp, 0, SEEK_END);
+        unsigned long cnt = (ftell(fp) - LINE_INDEX_HEADER_SIZE) / sizeof(offset);
+        unsigned long n = std::min((line - 1) / LINE_INDEX_INTERVAL, cnt);
+        if(n > 0 && fseek(fp, LINE_INDEX_HEADER_SIZE + (n - 1) * sizeof(offset), SEEK_SET) == 0 && fread(&offset, sizeof(offset), 1, fp) == 1) {
+            at = n * LINE_INDEX_INTERVAL + 1;
+        }
+    }
+    fclose(fp);
+
+    // an entry must be the start of a line, otherwise the file has changed since the index was made
+    if(at > 1 && !(seek_to(offset) && played_cnt == offset)) at = 1;
+    if(at == 1) remove(index_file.c_str());
+    return at;
+}
+
+// read the whole file once and save the offset of every LINE_INDEX_INTERVAL'th line, the other modules run between each
+// buffer read as it can take a while, a halt stops it and no index is saved
+bool Player::build_line_index(const string& index_file)
+{
+    FILE *fp = fopen(index_file.c_str(), "w");
+    if(fp == NULL) return false;
+
+    uint32_t size = file_size;
+    bool ok = fwrite(LINE_INDEX_MAGIC, 1, 4, fp) == 4 && fwrite(&size, sizeof(size), 1, fp) == 1;
+
+    fseek(this->current_file_handler, 0, SEEK_SET);
+    this->read_pos = this->read_end = 0;
+    unsigned long lines = 0;
+    uint32_t offset = 0;
+    while(ok && fill_read_buffer()) {
+        THEKERNEL->call_event(ON_IDLE, this);
+        if(THEKERNEL->is_halted()) {
+            ok = false;
+            break;
+        }
+
+        const char *p = this->read_buffer, *end = p + this->read_end;
+        const char *nl;
+        while((nl = (const char *)memchr(p, '\n', end - p)) != nullptr) {
+            p = nl + 1;
+            if(++lines % LINE_INDEX_INTERVAL == 0) {
+                uint32_t entry = offset + (p - this->read_buffer);
+                if(fwrite(&entry, sizeof(entry), 1, fp) != 1) {
+                    ok = false;
+                    break;
+                }
+            }
+        }
+        offset += this->read_end;
+    }
+    this->read_pos = this->read_end = 0;
+
+    fclose(fp);
+    if(!ok) remove(index_file.c_str());
+    return ok;
+}
+
+// true if buf holds a complete line, the last line of the file need not end with a newline
+bool Player::is_line_end(const char *buf, int len)
+{
+    if(buf[len - 1] == '\n') return true;
+    if(this->inflater != nullptr) return this->inflater->is_eof();
+    return this->read_pos >= this->read_end && feof(this->current_file_handler);
+}
+
+// true if another line can be fed in this main loop, when batching lines are fed until the
+// block queue is full enough or we run out of time so the other modules still get called
+bool Player::can_batch(uint32_t start_us) const
+{
+    if(this->batch_fill <= 0) return false;
+    // the line may have paused, suspended or aborted the print
+    if(!this->playing_file || this->current_file_handler == NULL || this->inner_playing || THEKERNEL->is_halted()) return false;
+    if(!this->buffered_queue.empty()) return false;
+    if(THECONVEYOR->get_queue_fill() >= this->batch_fill) return false;
+    return (us_ticker_read() - start_us) < this->batch_time_us;
+}
+
 void Player::on_get_public_data(void *argument)
 {
     PublicDataRequest *pdr = static_cast<PublicDataRequest *>(argument);
@@ -18,6 +18,7 @@
 using std::string;
 
 class StreamOutput;
+class Inflater;
 
 class Player : public Module {
     public:
@@ -41,6 +42,16 @@ class Player : public Module {
         void buffer_command( string parameters, StreamOutput* stream );
         string extract_options(string& args);
         void suspend_part2();
+        void close_file();
+        char *read_line(char *buf, int size);
+        bool fill_read_buffer();
+        bool skip_lines(unsigned long n);
+        bool seek_to(unsigned long offset);
+        bool seek_line(unsigned long line, StreamOutput *stream);
+        unsigned long seek_indexed_line(const string& index_file, unsigned long line);
+        bool build_line_index(const string& index_file);
+        bool is_line_end(const char *buf, int len);
+        bool can_batch(uint32_t start_us) const;
 
         string filename;
         string after_suspend_gcode;
@@ -53,6 +64,11 @@ class Player : public Module {
         void clear_buffered_queue();
 
         FILE* current_file_handler;
+        Inflater* inflater; // set when playing a compressed file
+        char* read_buffer;  // the file is read in large blocks into here and split into lines
+        uint16_t read_pos, read_end;
+        float batch_fill;   // lines are fed in one main loop until the block queue is this full, 0 to feed one line per main loop
+        uint32_t batch_time_us;
         long file_size;
         unsigned long played_cnt;
         unsigned long elapsed_secs;
@@ -45,6 +45,8 @@
 #include "md5.h"
 #include "utils.h"
 #include "AutoPushPop.h"
+#include "EventProfiler.h"
+#include "StepTicker.h"
 
 #include "system_LPC17xx.h"
 #include "LPC17xx.h"
@@ -63,6 +65,10 @@ extern "C" uint32_t  __end__;
 extern "C" uint32_t  __malloc_free_list;
 extern "C" uint32_t  _sbrk(int size);
 
+// uploads are written to the SD card in chunks of this many bytes, a multiple of the FatFs sector size
+#define UPLOAD_SECTOR_SIZE 512
+#define UPLOAD_BUFFER_SIZE (8 * UPLOAD_SECTOR_SIZE)
+
 
 // command lookup table
 const SimpleShell::ptentry_t SimpleShell::commands_table[] = {
@@ -82,6 +88,9 @@ const SimpleShell::ptentry_t SimpleShell::commands_table[] = {
     {"?",        SimpleShell::help_command},
     {"version",  SimpleShell::version_command},
     {"mem",      SimpleShell::mem_command},
+    {"profile",  SimpleShell::profile_command},
+    {"steptimes", SimpleShell::steptimes_command},
+    {"queuestats", SimpleShell::queuestats_command},
     {"get",      SimpleShell::get_command},
     {"set_temp", SimpleShell::set_temp_command},
     {"switch",   SimpleShell::switch_command},
@@ -286,6 +295,9 @@ void SimpleShell::on_console_line_received( void *argument )
         } else if (cmd == "config-load"){
             THEKERNEL->configurator->config_load_command(  possible_command, new_message.stream );
 
+        } else if (cmd == "config-compile"){
+            THEKERNEL->configurator->config_compile_command(  possible_command, new_message.stream );
+
         } else if (cmd == "play" || cmd == "progress" || cmd == "abort" || cmd == "suspend" || cmd == "resume" || cmd == "buffer") {
             // these are handled by Player module
 
@@ -537,6 +549,14 @@ void SimpleShell::echo_command( string parameters, StreamOutput *stream )
     THEKERNEL->streams->printf("echo: %s\r\n", parameters.c_str());
 }
 
+// write out whatever is in the upload buffer, returns false on a write error
+static bool upload_write(FILE *fd, const char *buf, size_t n, MD5 &md5)
+{
+    if(n == 0) return true;
+    md5.update(buf, n);
+    return fwrite(buf, 1, n, fd) == n;
+}
+
 void SimpleShell::upload_command( string parameters, StreamOutput *stream )
 {
     // this needs to be a hack. it needs to read direct from serial and not allow on_main_loop run until done
@@ -546,8 +566,15 @@ void SimpleShell::upload_command( string parameters, StreamOutput *stream )
         return;
     }
 
-    // open file to upload to
-    string upload_filename = absolute_from_relative( parameters );
+    // open file to upload to, optionally followed by the md5 sum the file must have. the md5 is taken off the end so
+    // the filename can have spaces in it
+    string expected_md5;
+    size_t last = parameters.find_last_of(' ');
+    if(last != string::npos && parameters.size() - last - 1 == 32 && parameters.find_first_not_of("0123456789abcdefABCDEF", last + 1) == string::npos) {
+        expected_md5 = parameters.substr(last + 1);
+        parameters = parameters.substr(0, parameters.find_last_not_of(' ', last) + 1);
+    }
+    string upload_filename = absolute_from_relative(parameters);
 
     FILE *fd = fopen(upload_filename.c_str(), "w");
     if(fd != NULL) {
@@ -557,11 +584,28 @@ void SimpleShell::upload_command( string parameters, StreamOutput *stream )
         return;
     }
 
+    // the data is collected into whole sectors so FatFs can write them straight to the card, rather than going through
+    // stdio and the FatFs sector buffer a byte at a time
+    setvbuf(fd, NULL, _IONBF, 0);
+    size_t buf_size = UPLOAD_BUFFER_SIZE;
+    char *buf = (char *)AHB0.alloc(buf_size);
+    char small_buf[UPLOAD_SECTOR_SIZE];
+    if(buf == nullptr) {
+        buf = small_buf;
+        buf_size = sizeof(small_buf);
+    }
+
+    MD5 md5;
+    size_t buf_len = 0;
     int cnt = 0;
     int recv_count;
     char* recv_buff;
+    bool ok = true;
+    char terminator = 0;
+    uint32_t start_us = us_ticker_read();
+
     THEKERNEL->set_uploading(true);
-    while (THEKERNEL->is_uploading()) {
+    while (ok && THEKERNEL->is_uploading()) {
         if (!stream->ready()) {
             // we need to kick things or they die
             THEKERNEL->call_event(ON_IDLE);
@@ -570,40 +614,59 @@ void SimpleShell::upload_command( string parameters, StreamOutput *stream )
 
         recv_count = stream->gets(&recv_buff);
 
-        for (int i = 0; i < recv_count; i ++) {
-            if (recv_buff[i] == 4 || recv_buff[i] == 26) { // ctrl-D or ctrl-Z
-                // close file
-                fclose(fd);
-                fd = NULL;
-            	THEKERNEL->set_uploading(false);
-                if (recv_buff[i] == 26) {
-                	// rm file
-                	remove(upload_filename.c_str());
-                	stream->printf("upload canceled, %d bytes transferred\n", cnt);
-                } else {
-                    stream->printf("upload finished, %d bytes transferred\n", cnt);
-                }
-                return;
-
-            } else {
-                // write character to file
-                cnt ++;
-                if (fputc(recv_buff[i], fd) != recv_buff[i]) {
-                    // error writing to file
-                	stream->printf("upload error! %d bytes transferred\n", cnt);
-                    fclose(fd);
-                    fd = NULL;
-                    THEKERNEL->set_uploading(false);
-                    return;
-                } else {
-                    if ((cnt % 1000) == 0) {
-                        // we need to kick things or they die
-                        THEKERNEL->call_event(ON_IDLE);
-                    }
-                }
+        // ctrl-D or ctrl-Z ends the upload, anything after it is ignored
+        int n = 0;
+        while (n < recv_count && recv_buff[n] != 4 && recv_buff[n] != 26) ++n;
+        if(n < recv_count) terminator = recv_buff[n];
+        cnt += n;
+
+        // a read is at most a packet, so it is collected into the buffer and written out in whole sectors
+        const char *p = recv_buff;
+        while (ok && n > 0) {
+            size_t c = std::min(buf_size - buf_len, (size_t)n);
+            memcpy(buf + buf_len, p, c);
+            buf_len += c;
+            p += c;
+            n -= c;
+            if(buf_len == buf_size) {
+                ok = upload_write(fd, buf, buf_len, md5);
+                buf_len = 0;
+                // we need to kick things or they die
+                THEKERNEL->call_event(ON_IDLE);
             }
         }
+
+        if(terminator != 0) break;
+    }
+
+    if(ok) ok = upload_write(fd, buf, buf_len, md5);
+    if(buf != small_buf) AHB0.dealloc(buf);
+    if(fclose(fd) != 0) ok = false;
+    THEKERNEL->set_uploading(false);
+
+    uint32_t ms = (us_ticker_read() - start_us) / 1000;
+    unsigned long rate = (unsigned long)cnt * 1000 / std::max(ms, (uint32_t)1);
+
+    if (!ok) {
+        stream->printf("upload error! %d bytes transferred\n", cnt);
+        return;
+    }
+
+    if (terminator == 26) {
+        // rm file
+        remove(upload_filename.c_str());
+        stream->printf("upload canceled, %d bytes transferred\n", cnt);
+        return;
     }
+
+    string digest = md5.finalize().hexdigest();
+    if(!expected_md5.empty() && strcasecmp(expected_md5.c_str(), digest.c_str()) != 0) {
+        remove(upload_filename.c_str());
+        stream->printf("upload error! md5 mismatch, expected %s got %s, %d bytes transferred\n", expected_md5.c_str(), digest.c_str(), cnt);
+        return;
+    }
+
+    stream->printf("upload finished, %d bytes transferred in %lu ms, %lu bytes/sec, md5 %s\n", cnt, (unsigned long)ms, rate, digest.c_str());
 }
 
 // loads the specified config-override file
@@ -692,6 +755,61 @@ void SimpleShell::mem_command( string parameters, StreamOutput *stream)
     stream->printf("Block size: %u bytes, Tickinfo size: %u bytes\n", sizeof(Block), sizeof(Block::tickinfo_t) * Block::n_actuators);
 }
 
+// profile the time each module takes handling each event, profile on|off|reset or just profile to show it
+void SimpleShell::profile_command( string parameters, StreamOutput *stream)
+{
+    string opt = shift_parameter(parameters);
+    if(opt == "on") {
+        if(THEKERNEL->event_profiler == nullptr) THEKERNEL->event_profiler = new EventProfiler();
+        stream->printf("event profile on\n");
+
+    } else if(opt == "off") {
+        delete THEKERNEL->event_profiler;
+        THEKERNEL->event_profiler = nullptr;
+        stream->printf("event profile off\n");
+
+    } else if(opt == "reset") {
+        if(THEKERNEL->event_profiler != nullptr) THEKERNEL->event_profiler->reset();
+
+    } else if(THEKERNEL->event_profiler == nullptr) {
+        stream->printf("event profile is off, use profile on\n");
+
+    } else {
+        THEKERNEL->event_profile_report(stream);
+    }
+}
+
+// histogram of the time taken by the step and unstep interrupts, missed step ticks and moves starved of blocks, steptimes on|off|reset
+// or just steptimes to show them, the interrupts are only timed while it is on
+void SimpleShell::steptimes_command( string parameters, StreamOutput *stream)
+{
+    string opt = shift_parameter(parameters);
+    if(opt == "on") {
+        StepTicker::getInstance()->set_timing(true);
+        stream->printf("step times on\n");
+    } else if(opt == "off") {
+        StepTicker::getInstance()->set_timing(false);
+        stream->printf("step times off\n");
+    } else if(opt == "reset") {
+        StepTicker::getInstance()->reset_timing();
+        stream->printf("step times reset\n");
+    } else {
+        StepTicker::getInstance()->report_timing(stream);
+    }
+}
+
+// block queue underruns, time spent empty and how full it was when blocks started, queuestats [reset]
+void SimpleShell::queuestats_command( string parameters, StreamOutput *stream)
+{
+    string opt = shift_parameter(parameters);
+    if(opt == "reset") {
+        THECONVEYOR->reset_queue_stats();
+        stream->printf("queue stats reset\n");
+    } else {
+        THECONVEYOR->report_queue_stats(stream);
+    }
+}
+
 static uint32_t getDeviceType()
 {
 #define IAP_LOCATION 0x1FFF1FF1
@@ -1529,6 +1647,9 @@ void SimpleShell::help_command( string parameters, StreamOutput *stream )
     stream->printf("Commands:\r\n");
     stream->printf("version\r\n");
     stream->printf("mem [-v]\r\n");
+    stream->printf("profile [on|off|reset] - time spent by each module handling each event, shown when no option is given\r\n");
+    stream->printf("steptimes [on|off|reset] - step interrupt time histogram, missed step ticks and times the queue ran dry while moving\r\n");
+    stream->printf("queuestats [reset] - block queue underruns, time empty and how full it was as blocks started\r\n");
     stream->printf("ls [-s] [-e] [folder]\r\n");
     stream->printf("cd folder\r\n");
     stream->printf("pwd\r\n");
@@ -1536,7 +1657,7 @@ void SimpleShell::help_command( string parameters, StreamOutput *stream )
     stream->printf("rm file [-e]\r\n");
     stream->printf("mv file newfile [-e]\r\n");
     stream->printf("remount\r\n");
-    stream->printf("play file [-v]\r\n");
+    stream->printf("play file [-v] [-l<line> | -o<byte offset>] - start at a line, or at the line at an offset as shown by progress\r\n");
     stream->printf("progress - shows progress of current play\r\n");
     stream->printf("abort - abort currently playing file\r\n");
     stream->printf("reset - reset smoothie\r\n");
@@ -1544,6 +1665,7 @@ void SimpleShell::help_command( string parameters, StreamOutput *stream )
     stream->printf("break - break into debugger\r\n");
     stream->printf("config-get [<configuration_source>] <configuration_setting>\r\n");
     stream->printf("config-set [<configuration_source>] <configuration_setting> <value>\r\n");
+    stream->printf("config-compile - saves the parsed config to /sd/config.bin which is used at boot while the config is unchanged\r\n");
     stream->printf("get [pos|wcs|state|status|fk|ik]\r\n");
     stream->printf("get temp [bed|hotend]\r\n");
     stream->printf("set_temp bed|hotend 185\r\n");
@@ -1553,7 +1675,7 @@ void SimpleShell::help_command( string parameters, StreamOutput *stream )
     stream->printf("diagnose\r\n");
     stream->printf("load [file] - loads a configuration override file from soecified name or config-override\r\n");
     stream->printf("save [file] - saves a configuration override file as specified filename or as config-override\r\n");
-    stream->printf("upload filename - saves a stream of text to the named file\r\n");
+    stream->printf("upload filename [md5] - saves a stream of text to the named file, optionally checking its md5 sum\r\n");
     stream->printf("calc_thermistor [-s0] T1,R1,T2,R2,T3,R3 - calculate the Steinhart Hart coefficients for a thermistor\r\n");
     stream->printf("thermistors - print out the predefined thermistors\r\n");
     stream->printf("md5sum file - prints md5 sum of the given file\r\n");
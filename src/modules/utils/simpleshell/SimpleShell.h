@@ -55,6 +55,9 @@ private:
 
     static void switch_command(string parameters, StreamOutput *stream );
     static void mem_command(string parameters, StreamOutput *stream );
+    static void profile_command(string parameters, StreamOutput *stream );
+    static void steptimes_command(string parameters, StreamOutput *stream );
+    static void queuestats_command(string parameters, StreamOutput *stream );
 
     static void net_command( string parameters, StreamOutput *stream);
     static void wlan_command( string parameters, StreamOutput *stream);
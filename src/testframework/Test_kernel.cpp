@@ -61,6 +61,8 @@ Kernel::Kernel(){
     // dummies (would be nice to refactor to not have to create a conveyor)
     this->conveyor= new Conveyor();
 
+    this->event_profiler = nullptr;
+
     // Configure UART depending on MRI config
     // Match up the SerialConsole to MRI UART. This makes it easy to use only one UART for both debug and actual commands.
     NVIC_SetPriorityGrouping(0);
@@ -68,7 +70,8 @@ Kernel::Kernel(){
 }
 
 // Add a module to Kernel. We don't actually hold a list of modules we just call its on_module_loaded
-void Kernel::add_module(Module* module){
+void Kernel::add_module(Module* module, const char *name){
+    module->set_module_name(name);
     module->on_module_loaded();
 }
 